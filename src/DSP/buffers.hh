@@ -140,6 +140,11 @@ public:
         return true;
     }
 
+    size_t size() const
+    {
+        return queued.size();
+    }
+
     void reset()
     {
         queued.clear();
@@ -18,11 +18,7 @@
 #include <complex>
 #include <cstring>
 
-#ifdef WIN32
-#include "fftw3/fftw3.h"
-#else
-#include <fftw3.h>
-#endif
+#include "fft_wisdom.h"
 
 
 typedef std::complex<float> complex;
@@ -32,11 +28,75 @@ class fast_fourier_transform
 private:
     fftwf_complex* in = nullptr;
     fftwf_complex* out_fft = nullptr;
-    fftwf_plan plan;
+    fftwf_plan plan = nullptr;
+    int len_fft = 0;
+    int generation = 0;
     unsigned int half_fft;
     fftwf_complex* out = nullptr;
 
+    // symbol transform: input read in place, symbols _distance samples apart,
+    // one plan per input alignment, for one symbol and for a batch of symbols;
+    // without a plan yet for the alignment the unaligned plan of the length
+    constexpr static int alignments = 8;
+    int len_symbol = 0;
+    int distance_symbol = 0;
+    fftwf_complex* in_symbol = nullptr;
+    fftwf_complex* out_symbol = nullptr;
+    fftwf_plan plan_symbol[alignments] = {};
+    fftwf_plan plan_batch[alignments] = {};
+    int generation_symbol[alignments] = {};
+    int generation_batch[alignments] = {};
+
+    // _all: the symbol plans too, they do not depend on the distance
+    void destroy_symbol(bool _all = true)
+    {
+        fft_wisdom &wisdom = fft_wisdom::instance();
+        for(int i = 0; i < alignments; ++i){
+            if(_all){
+                wisdom.destroy(plan_symbol[i]);
+                plan_symbol[i] = nullptr;
+            }
+            wisdom.destroy(plan_batch[i]);
+            plan_batch[i] = nullptr;
+        }
+        if(in_symbol != nullptr){
+            fftwf_free(in_symbol);
+            fftwf_free(out_symbol);
+            in_symbol = nullptr;
+            out_symbol = nullptr;
+        }
+    }
+
+    fftwf_plan plan_for(const complex* _in, int _n)
+    {
+        const int a = (fftwf_alignment_of(reinterpret_cast<float*>(const_cast<complex*>(_in))) /
+                       static_cast<int>(sizeof(complex))) % alignments;
+        fftwf_plan &p = _n == 1 ? plan_symbol[a] : plan_batch[a];
+        int &g = _n == 1 ? generation_symbol[a] : generation_batch[a];
+        fft_wisdom &wisdom = fft_wisdom::instance();
+        const int current = wisdom.generation();
+        if(p == nullptr || g != current){
+            // scratch input with the same alignment as _in
+            fftwf_complex* scratch = in_symbol;
+            while(fftwf_alignment_of(reinterpret_cast<float*>(scratch)) !=
+                  fftwf_alignment_of(reinterpret_cast<float*>(const_cast<complex*>(_in)))) ++scratch;
+            // new wisdom: re-plan when the planner is free, until then the old plan;
+            // nothing waits for the planner, without a batch plan the batch is done symbol
+            // by symbol
+            fftwf_plan new_plan = wisdom.plan(len_symbol, _n, _n == 1 ? len_symbol : distance_symbol,
+                                              scratch, out_symbol);
+            if(new_plan != nullptr){
+                wisdom.destroy(p);
+                p = new_plan;
+                g = current;
+            }
+        }
+        return p;
+    }
+
 public:
+    constexpr static int batch_max = 4;
+
     fast_fourier_transform()
     {
 
@@ -45,17 +105,21 @@ public:
     ~fast_fourier_transform()
     {
         if(in != nullptr){
-            fftwf_destroy_plan(plan);
+            fft_wisdom::instance().destroy(plan);
             fftwf_free(out);
             fftwf_free(in);
         }
+        destroy_symbol();
     }
 
     complex* init(int _len_in)
     {
         in = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * static_cast<unsigned int>(_len_in)));
         out_fft = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * static_cast<unsigned int>(_len_in)));
-        plan = fftwf_plan_dft_1d(_len_in, in, out_fft, FFTW_FORWARD, FFTW_ESTIMATE);
+        len_fft = _len_in;
+        generation = fft_wisdom::instance().generation();
+        plan = fft_wisdom::instance().plan(_len_in, 1, _len_in, in, out_fft);
+        if(plan == nullptr) generation = -1;
         out = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * static_cast<unsigned int>(_len_in)));
         half_fft = static_cast<unsigned int>(_len_in / 2);
         return reinterpret_cast<complex*>(in);
@@ -63,12 +127,69 @@ public:
 
     complex* execute()
     {
-        fftwf_execute(plan);
+        fft_wisdom &wisdom = fft_wisdom::instance();
+        if(generation != wisdom.generation()){
+            const int current = wisdom.generation();
+            fftwf_plan new_plan = wisdom.plan(len_fft, 1, len_fft, in, out_fft);
+            if(new_plan != nullptr){
+                wisdom.destroy(plan);
+                plan = new_plan;
+                generation = current;
+            }
+        }
+        if(plan != nullptr) fftwf_execute(plan);
+        else fftwf_execute_dft(wisdom.fallback(len_fft), in, out_fft);
         std::memcpy(&out[half_fft], &out_fft[0], sizeof(complex) * half_fft);
         std::memcpy(&out[0], &out_fft[half_fft], sizeof(complex) * half_fft);
         return reinterpret_cast<complex*>(out);
     }
 
+    // Symbol transform of _len samples, symbols of a batch start _distance samples apart.
+    void init_symbol(int _len, int _distance)
+    {
+        if(_len == len_symbol && _distance == distance_symbol) return;
+        destroy_symbol(_len != len_symbol);
+        len_symbol = _len;
+        distance_symbol = _distance;
+        size_t len_in = static_cast<size_t>(_distance) * (batch_max - 1) + static_cast<size_t>(_len) + alignments;
+        in_symbol = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) * len_in));
+        out_symbol = static_cast<fftwf_complex*>(fftwf_malloc(sizeof(fftwf_complex) *
+                                                              static_cast<size_t>(_len) * batch_max));
+    }
+
+    // Transform _n (1 or batch_max) symbols in place of the sample buffer. The output is in
+    // natural order, symbol j at j * _len, carrier k of the fftshifted spectrum at bin(k).
+    complex* execute_symbol(int _n, const complex* _in)
+    {
+        fftwf_plan p = plan_for(_in, _n);
+        if(p != nullptr){
+            fftwf_execute_dft(p, reinterpret_cast<fftwf_complex*>(const_cast<complex*>(_in)), out_symbol);
+        }
+        else{
+            for(int j = 0; j < _n; ++j){
+                const complex* in_j = _in + j * distance_symbol;
+                fftwf_plan p_j = plan_for(in_j, 1);
+                if(p_j == nullptr) p_j = fft_wisdom::instance().fallback(len_symbol);
+                fftwf_execute_dft(p_j, reinterpret_cast<fftwf_complex*>(const_cast<complex*>(in_j)),
+                                  out_symbol + j * len_symbol);
+            }
+        }
+        return reinterpret_cast<complex*>(out_symbol);
+    }
+
+    inline int bin(int _carrier) const
+    {
+        return (_carrier + len_symbol / 2) & (len_symbol - 1);
+    }
+
+    // fftshifted copy for display
+    void shift_symbol(const complex* _cell, complex* _out) const
+    {
+        const size_t half = static_cast<size_t>(len_symbol / 2);
+        std::memcpy(&_out[half], &_cell[0], sizeof(complex) * half);
+        std::memcpy(&_out[0], &_cell[half], sizeof(complex) * half);
+    }
+
 };
 
 #endif // FAST_FOURIER_TRANSFORM_H
@@ -0,0 +1,254 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef FFT_WISDOM_H
+#define FFT_WISDOM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include "fftw3/fftw3.h"
+#else
+#include <fftw3.h>
+#endif
+
+// Shared FFTW planner. The planner is not thread safe, so every plan is made and destroyed
+// here under one mutex. A transform gets a plan from the wisdom when it is there, otherwise
+// an FFTW_ESTIMATE plan at once, while the measured plan of the same problem is made by a
+// background thread and saved to the wisdom file. generation() grows with each new wisdom,
+// the transforms then re-plan.
+// A measured plan holds the planner up to time_limit, so plan() and destroy() never wait for
+// it: plan() then returns nullptr and the transform keeps its old plan or uses the unaligned
+// plan of the length made by prepare(), a plan to destroy is freed by the next holder.
+class fft_wisdom
+{
+private:
+    struct problem{
+        int len;
+        int howmany;
+        int distance;
+        int alignment;
+    };
+
+    std::mutex planner;
+    std::mutex mutex_queue;
+    std::condition_variable signal_queue;
+    std::deque<problem> queue;
+    std::deque<problem> measured;
+    std::thread thread;
+    std::atomic<int> wisdom_generation{0};
+    std::string file;
+    unsigned effort = FFTW_MEASURE;
+    double time_limit = 10.0;
+    std::atomic<bool> stopped{false};
+    std::vector<fftwf_plan> retired;            // under mutex_queue
+    // FFTW_ESTIMATE | FFTW_UNALIGNED plan of one transform of 2^i, any input and output
+    constexpr static int log2_len_max = 16;
+    std::atomic<fftwf_plan> unaligned[log2_len_max + 1] = {};
+
+    fft_wisdom()
+    {
+
+    }
+
+    static fftwf_plan plan_many(int _len, int _howmany, int _distance,
+                                fftwf_complex* _in, fftwf_complex* _out, unsigned _flags)
+    {
+        return fftwf_plan_many_dft(1, &_len, _howmany, _in, nullptr, 1, _distance,
+                                   _out, nullptr, 1, _len, FFTW_FORWARD, _flags | FFTW_PRESERVE_INPUT);
+    }
+
+    static int log2_len(int _len)
+    {
+        int i = 0;
+        while((1 << i) < _len && i < log2_len_max) ++i;
+        return (1 << i) == _len ? i : -1;
+    }
+
+    // with the planner held
+    void make_unaligned(int _len)
+    {
+        int i = log2_len(_len);
+        if(i < 0 || unaligned[i].load(std::memory_order_acquire) != nullptr) return;
+        fftwf_complex* in = fftwf_alloc_complex(static_cast<size_t>(_len));
+        fftwf_complex* out = fftwf_alloc_complex(static_cast<size_t>(_len));
+        unaligned[i].store(plan_many(_len, 1, _len, in, out, FFTW_ESTIMATE | FFTW_UNALIGNED),
+                           std::memory_order_release);
+        fftwf_free(out);
+        fftwf_free(in);
+    }
+
+    // with the planner held
+    void free_retired()
+    {
+        std::vector<fftwf_plan> plans;
+        {
+            std::lock_guard<std::mutex> lock(mutex_queue);
+            plans.swap(retired);
+        }
+        for(fftwf_plan p : plans) fftwf_destroy_plan(p);
+    }
+
+    static bool same(const problem &_a, const problem &_b)
+    {
+        return _a.len == _b.len && _a.howmany == _b.howmany &&
+               _a.distance == _b.distance && _a.alignment == _b.alignment;
+    }
+
+    void request(const problem &_p)
+    {
+        std::lock_guard<std::mutex> lock(mutex_queue);
+        // once per problem, even if the measured plan did not make it into the wisdom
+        for(const problem &p : queue) if(same(p, _p)) return;
+        for(const problem &p : measured) if(same(p, _p)) return;
+        if(stopped) return;
+        queue.push_back(_p);
+        if(!thread.joinable()) thread = std::thread(&fft_wisdom::measure, this);
+        signal_queue.notify_one();
+    }
+
+    void measure()
+    {
+        for(;;){
+            problem p;
+            {
+                std::unique_lock<std::mutex> lock(mutex_queue);
+                signal_queue.wait(lock, [this]{ return stopped || !queue.empty(); });
+                if(stopped) return;
+                p = queue.front();
+            }
+            size_t len_in = static_cast<size_t>(p.distance) * static_cast<size_t>(p.howmany - 1) +
+                    static_cast<size_t>(p.len) + 8;
+            fftwf_complex* in = fftwf_alloc_complex(len_in);
+            fftwf_complex* out = fftwf_alloc_complex(static_cast<size_t>(p.len) * static_cast<size_t>(p.howmany));
+            fftwf_complex* scratch = in;
+            while(fftwf_alignment_of(reinterpret_cast<float*>(scratch)) != p.alignment) ++scratch;
+            {
+                // holds the planner no longer than time_limit, nobody waits for it
+                std::lock_guard<std::mutex> lock(planner);
+                fftwf_set_timelimit(time_limit);
+                fftwf_plan plan = plan_many(p.len, p.howmany, p.distance, scratch, out, effort);
+                fftwf_set_timelimit(FFTW_NO_TIMELIMIT);
+                if(plan != nullptr) fftwf_destroy_plan(plan);
+                free_retired();
+                // stopped while measuring: the process may be exiting, no half written file
+                if(!file.empty() && !stopped) fftwf_export_wisdom_to_filename(file.c_str());
+            }
+            fftwf_free(out);
+            fftwf_free(in);
+            if(stopped) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex_queue);
+                measured.push_back(p);
+                queue.pop_front();
+            }
+            wisdom_generation.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+public:
+    static fft_wisdom& instance()
+    {
+        // never destroyed: a detached measuring thread may still use it at exit
+        static fft_wisdom* wisdom = new fft_wisdom;
+        return *wisdom;
+    }
+
+    // At exit. A measured plan can hold the planner up to time_limit, the thread is not
+    // waited for, the plans retired meanwhile are left to the process exit.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_queue);
+            stopped = true;
+        }
+        signal_queue.notify_one();
+        if(thread.joinable()) thread.detach();
+    }
+
+    // Wisdom cache file and the effort of the background planner (FFTW_MEASURE or
+    // FFTW_PATIENT), _time_limit in seconds for one measured plan.
+    bool init(const std::string &_file, unsigned _effort = FFTW_MEASURE, double _time_limit = 10.0)
+    {
+        std::lock_guard<std::mutex> lock(planner);
+        file = _file;
+        effort = _effort;
+        time_limit = _time_limit;
+        return fftwf_import_wisdom_from_filename(file.c_str()) != 0;
+    }
+
+    int generation() const
+    {
+        return wisdom_generation.load(std::memory_order_acquire);
+    }
+
+    // Unaligned plans of the power of two lengths _len_min .. _len_max, at start before any
+    // plan is measured.
+    void prepare(int _len_min, int _len_max)
+    {
+        std::lock_guard<std::mutex> lock(planner);
+        for(int len = _len_min; len <= _len_max; len *= 2) make_unaligned(len);
+    }
+
+    // One transform of _len, any alignment, nullptr when _len is not a power of two. Waits
+    // for the planner only for a length prepare() did not make.
+    fftwf_plan fallback(int _len)
+    {
+        int i = log2_len(_len);
+        if(i < 0) return nullptr;
+        fftwf_plan p = unaligned[i].load(std::memory_order_acquire);
+        if(p != nullptr) return p;
+        std::lock_guard<std::mutex> lock(planner);
+        make_unaligned(_len);
+        return unaligned[i].load(std::memory_order_acquire);
+    }
+
+    // Plan of _howmany transforms of _len, inputs _distance samples apart, outputs one
+    // after another, nullptr when the planner is busy measuring.
+    fftwf_plan plan(int _len, int _howmany, int _distance, fftwf_complex* _in, fftwf_complex* _out)
+    {
+        std::unique_lock<std::mutex> lock(planner, std::try_to_lock);
+        if(!lock.owns_lock()) return nullptr;
+        free_retired();
+        fftwf_plan p = plan_many(_len, _howmany, _distance, _in, _out, effort | FFTW_WISDOM_ONLY);
+        if(p != nullptr) return p;
+        p = plan_many(_len, _howmany, _distance, _in, _out, FFTW_ESTIMATE);
+        lock.unlock();
+        request({_len, _howmany, _distance, fftwf_alignment_of(reinterpret_cast<float*>(_in))});
+        return p;
+    }
+
+    void destroy(fftwf_plan _plan)
+    {
+        if(_plan == nullptr) return;
+        std::unique_lock<std::mutex> lock(planner, std::try_to_lock);
+        if(!lock.owns_lock()){
+            std::lock_guard<std::mutex> lock_queue(mutex_queue);
+            retired.push_back(_plan);
+
+            return;
+
+        }
+        fftwf_destroy_plan(_plan);
+    }
+
+};
+
+#endif // FFT_WISDOM_H
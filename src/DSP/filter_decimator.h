@@ -1,25 +1,19 @@
 #ifndef FILTER_DECIMATOR_H
 #define FILTER_DECIMATOR_H
 
-//#include <QDebug>
 #include <complex>
-#include <immintrin.h>
-#include <string.h>
+#include <vector>
 
 typedef std::complex<float> complex;
 
 #define DECIMATION_STEP 2
 
+// Low-pass tap designs for the decimate-by-DECIMATION_STEP stage of resampler_polyphase,
+// selectable in the UI.
 class filter_decimator
 {
 private:
-    complex* buffer;
-    unsigned int idx_buffer = 0;
-    float* h_complex;
     constexpr static int MAX_TAPS = 64;
-    int selected_fir = 0;
-    constexpr static int DEFAULT_FIR = 2;
-    unsigned len_fir_filter = 0;
     struct tap_t
     {
         const char * name;
@@ -118,42 +112,11 @@ private:
             }
         },
     };
-    constexpr static int N_FILTERS = sizeof(h_fir)/sizeof(h_fir[0]);;
-    // for 8mHz bandwidht
-    unsigned int len_filter_complex = 0;//for complex numbers
-    const static unsigned int len_buffer = MAX_TAPS * 2;        // min 2 x len_fir_filter
+    constexpr static int N_FILTERS = sizeof(h_fir)/sizeof(h_fir[0]);
 
 public:
-    filter_decimator()
-    {
-        h_complex = static_cast<float*>(_mm_malloc(MAX_TAPS * 2 * sizeof(float), 32));
-        set_filter(DEFAULT_FIR);
-        buffer = static_cast<complex*>(_mm_malloc(len_buffer * 2 * sizeof(complex), 32));
-        for (unsigned int i = 0; i < len_buffer * 2; ++i) buffer[i] = {0.0f, 0.0f};
-    }
-    //-----------------------------------------------------------------------------------------------
-    void set_filter(int n)
-    {
-        if(h_fir[selected_fir].len > MAX_TAPS){
-            printf("Filter should not have more than %d taps /n", MAX_TAPS);
-            exit(1);
-        }
-        selected_fir = n;
-        len_fir_filter = h_fir[selected_fir].len;
-        int j = 0;
-        for (unsigned int i = 0; i < len_fir_filter; ++i)
-        {
-            h_complex[j++] = (i < h_fir[selected_fir].len)?static_cast<float>(h_fir[selected_fir].taps[i]):0.f;
-            h_complex[j++] = (i < h_fir[selected_fir].len)?static_cast<float>(h_fir[selected_fir].taps[i]):0.f;
-        }
-        if(len_fir_filter & 0x0f)
-        {
-            len_fir_filter &= ~0x0f;
-            len_fir_filter ++;
-        }
-        len_filter_complex = len_fir_filter * 2;
-    }
-    //-----------------------------------------------------------------------------------------------
+    constexpr static int DEFAULT_FIR = 2;
+
     static void get_filter_names(std::vector<const char *> & out)
     {
         out.resize(N_FILTERS);
@@ -161,105 +124,9 @@ public:
             out[i]=h_fir[i].name;
     }
     //-----------------------------------------------------------------------------------------------
-    ~filter_decimator()
-    {
-        _mm_free(h_complex);
-        _mm_free(buffer);
-    }
-    //-----------------------------------------------------------------------------------------------
-    void execute(int _len_in, complex* _in, int &_len_out, complex* _out)
+    static void get_filter(int n, std::vector<double> & out)
     {
-        int len_in = _len_in;
-        float* ptr_buffer;
-        int idx_out = 0;
-        static int d = 0;
-        __m256 v0, v1, v2, v3;          // input vectors
-        __m256 h0, h1, h2, h3;          // coefficients vectors
-        __m256 m0, m1, m2, m3;
-        __m256 sum0, sum1, sumt, sum;
-        float* st = static_cast<float*>(_mm_malloc(sizeof(float) * 8, 32));
-        if(len_fir_filter == 16)
-        {
-            // load coefficients into register (aligned)
-            h0 = _mm256_load_ps(h_complex);
-            h1 = _mm256_load_ps(h_complex + 8);
-            h2 = _mm256_load_ps(h_complex + 16);
-            h3 = _mm256_load_ps(h_complex + 24);
-            for (int x = 0; x < len_in; ++x) {
-                buffer[idx_buffer] = buffer[idx_buffer + len_buffer] = _in[x];
-                idx_buffer++;
-                if(idx_buffer == len_buffer)
-                    idx_buffer = 0;
-                ptr_buffer = reinterpret_cast<float*>(buffer + idx_buffer);
-                ++d;
-                if(d == DECIMATION_STEP){
-                    d = 0;
-                    // load inputs into register (unaligned)
-                    v0 = _mm256_loadu_ps(ptr_buffer);
-                    v1 = _mm256_loadu_ps(ptr_buffer + 8);
-                    v2 = _mm256_loadu_ps(ptr_buffer + 16);
-                    v3 = _mm256_loadu_ps(ptr_buffer + 24);
-                    // compute multiplication
-                    m0 = _mm256_mul_ps(v0, h0);
-                    m1 = _mm256_mul_ps(v1, h1);
-                    m2 = _mm256_mul_ps(v2, h2);
-                    m3 = _mm256_mul_ps(v3, h3);
-                    // parallel addition
-                    sum0 = _mm256_add_ps(m0, m1);
-                    sum1 = _mm256_add_ps(m2, m3);
-                    sum = _mm256_add_ps(sum0, sum1);
-                    _mm256_store_ps(st, sum);
-                    float real_out = st[0] + st[2] + st[4] + st[6];
-                    float imag_out = st[1] + st[3] + st[5] + st[7];
-                    // set return value
-                    _out[idx_out].real(real_out);
-                    _out[idx_out].imag(imag_out);
-                    ++idx_out;
-                }
-            }
-        }else
-            for (int x = 0; x < len_in; ++x) {
-                buffer[idx_buffer] = buffer[idx_buffer + len_buffer] = _in[x];
-                idx_buffer++;
-                if(idx_buffer == len_buffer)
-                    idx_buffer = 0;
-                ptr_buffer = reinterpret_cast<float*>(buffer + idx_buffer);
-                ++d;
-                if(d == DECIMATION_STEP){
-                    d = 0;
-                    sum = _mm256_setzero_ps();
-                    for (unsigned int i = 0; i < len_filter_complex; i += 32){
-                        // load inputs into register (unaligned)
-                        v0 = _mm256_loadu_ps(ptr_buffer + i);
-                        v1 = _mm256_loadu_ps(ptr_buffer + i + 8);
-                        v2 = _mm256_loadu_ps(ptr_buffer + i + 16);
-                        v3 = _mm256_loadu_ps(ptr_buffer + i + 24);
-                        // load coefficients into register (aligned)
-                        h0 = _mm256_load_ps(h_complex + i);
-                        h1 = _mm256_load_ps(h_complex + i + 8);
-                        h2 = _mm256_load_ps(h_complex + i + 16);
-                        h3 = _mm256_load_ps(h_complex + i + 24);
-                        // compute multiplication
-                        m0 = _mm256_mul_ps(v0, h0);
-                        m1 = _mm256_mul_ps(v1, h1);
-                        m2 = _mm256_mul_ps(v2, h2);
-                        m3 = _mm256_mul_ps(v3, h3);
-                        // parallel addition
-                        sum0 = _mm256_add_ps(m0, m1);
-                        sum1 = _mm256_add_ps(m2, m3);
-                        sumt = _mm256_add_ps(sum0, sum1);
-                        sum = _mm256_add_ps(sum, sumt);
-                    }
-                    _mm256_store_ps(st, sum);
-                    float real_out = st[0] + st[2] + st[4] + st[6];
-                    float imag_out = st[1] + st[3] + st[5] + st[7];
-                    // set return value
-                    _out[idx_out].real(real_out);
-                    _out[idx_out].imag(imag_out);
-                    ++idx_out;
-                }
-            }
-        _len_out = idx_out;
+        out.assign(h_fir[n].taps, h_fir[n].taps + h_fir[n].len);
     }
 };
 
@@ -0,0 +1,209 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef RESAMPLER_POLYPHASE_HH
+#define RESAMPLER_POLYPHASE_HH
+
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "filter_decimator.h"
+
+typedef std::complex<float> complex;
+
+// Arbitrary ratio resampler from the device rate straight to the output rate, NCO derotation
+// on the way into the filter window. The kernel is the cubic Farrow interpolator to
+// DECIMATION_STEP x output rate followed by the selected decimator FIR, so it filters like the
+// two stages it replaces; it is tabulated in PHASES fractional delays, nearest phase is used.
+class resampler_polyphase
+{
+private:
+    constexpr static int PHASES = 256;
+    constexpr static int len_chunk = 2048;
+    int selected_fir = filter_decimator::DEFAULT_FIR;
+    double ratio = 1.0;             // input samples per sample at DECIMATION_STEP x output rate
+    int len_taps = 0;               // per phase, multiple of 4
+    int len_history = 0;
+    float* h_phase = nullptr;       // PHASES + 1 phases of len_taps taps, each for re and im
+    complex* buffer = nullptr;      // len_history + len_chunk derotated input samples
+    double time = 0.0;              // position of the next output in buffer
+
+    // cubic Farrow interpolator as a continuous kernel, support [-2, 2)
+    static double farrow(double _t)
+    {
+        static const double a[4][4] = {
+            // a0, a1, a2, a3 of the sample 2 before, 1 before, at and after _t
+            {-1.0 / 16.0, -1.0 / 8.0, 1.0 / 4.0, 1.0 / 2.0},
+            {9.0 / 16.0, 11.0 / 8.0, -1.0 / 4.0, -3.0 / 2.0},
+            {9.0 / 16.0, -11.0 / 8.0, -1.0 / 4.0, 3.0 / 2.0},
+            {-1.0 / 16.0, 1.0 / 8.0, 1.0 / 4.0, -1.0 / 2.0},
+        };
+        if(_t < -2.0 || _t >= 2.0) return 0.0;
+        int i = static_cast<int>(std::floor(_t)) + 2;
+        double x = _t - std::floor(_t) - 0.5;
+        return ((a[i][3] * x + a[i][2]) * x + a[i][1]) * x + a[i][0];
+    }
+
+    void generate()
+    {
+        std::vector<double> fir;
+        filter_decimator::get_filter(selected_fir, fir);
+        const int len_fir = static_cast<int>(fir.size());
+        // kernel g(t) = sum h[k] * farrow(t - k * ratio), t in [-2, (len_fir - 1) * ratio + 2)
+        int span = static_cast<int>(std::ceil((len_fir - 1) * ratio)) + 5;
+        len_taps = (span + 3) & ~3;
+        len_history = len_taps + 4;
+        _mm_free(h_phase);
+        h_phase = static_cast<float*>(_mm_malloc(sizeof(float) * 2 * len_taps * (PHASES + 1), 32));
+        for(int p = 0; p <= PHASES; ++p){
+            double mu = static_cast<double>(p) / PHASES;
+            float* h = h_phase + 2 * len_taps * p;
+            for(int r = 0; r < len_taps; ++r){
+                // tap of the sample floor(time) + 3 - len_taps + r
+                double t = mu + len_taps - 3 - r;
+                double g = 0.0;
+                for(int k = 0; k < len_fir; ++k) g += fir[k] * farrow(t - k * ratio);
+                h[2 * r] = h[2 * r + 1] = static_cast<float>(g);
+            }
+        }
+        _mm_free(buffer);
+        buffer = static_cast<complex*>(_mm_malloc(sizeof(complex) * (len_history + len_chunk), 32));
+        for(int i = 0; i < len_history + len_chunk; ++i) buffer[i] = {0.0f, 0.0f};
+        time = len_history;
+    }
+
+    static inline __m256 mul_add(__m256 _a, __m256 _b, __m256 _c)
+    {
+#ifdef __FMA__
+        return _mm256_fmadd_ps(_a, _b, _c);
+#else
+        return _mm256_add_ps(_mm256_mul_ps(_a, _b), _c);
+#endif
+    }
+
+    static inline __m256 complex_mul(__m256 _a, __m256 _b)
+    {
+        __m256 re = _mm256_moveldup_ps(_b);
+        __m256 im = _mm256_movehdup_ps(_b);
+        __m256 a_swap = _mm256_permute_ps(_a, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_addsub_ps(_mm256_mul_ps(_a, re), _mm256_mul_ps(a_swap, im));
+    }
+
+    // _len samples times the NCO into the window, the NCO advanced by _incr per sample
+    static void derotate(int _len, const complex* _in, complex &_nco, complex _incr, complex* _out)
+    {
+        int i = 0;
+        if(_len >= 4){
+            const complex incr2 = _incr * _incr;
+            const complex incr4 = incr2 * incr2;
+            alignas(32) complex nco[4] = {_nco * _incr, _nco * incr2, _nco * incr2 * _incr, _nco * incr4};
+            __m256 v_nco = _mm256_load_ps(reinterpret_cast<float*>(nco));
+            alignas(32) complex step[4] = {incr4, incr4, incr4, incr4};
+            const __m256 v_step = _mm256_load_ps(reinterpret_cast<float*>(step));
+            for(; i + 4 <= _len; i += 4){
+                __m256 v = _mm256_loadu_ps(reinterpret_cast<const float*>(_in + i));
+                _mm256_storeu_ps(reinterpret_cast<float*>(_out + i), complex_mul(v, v_nco));
+                v_nco = complex_mul(v_nco, v_step);
+            }
+            _mm256_store_ps(reinterpret_cast<float*>(nco), v_nco);
+            _nco = nco[0] / _incr;
+        }
+        for(; i < _len; ++i){
+            _nco *= _incr;
+            _out[i] = _in[i] * _nco;
+        }
+    }
+
+    // The taps are not folded as the decimator FIR alone could be: the kernel g(t) is symmetric
+    // as a whole, a phase of it at a fractional delay is not, so one output has no pair of
+    // equal taps to share a multiply.
+    inline complex dot(const complex* _in, const float* _h) const
+    {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        int r = 0;
+        for(; r + 8 <= len_taps; r += 8){
+            sum0 = mul_add(_mm256_load_ps(_h + 2 * r),
+                           _mm256_loadu_ps(reinterpret_cast<const float*>(_in + r)), sum0);
+            sum1 = mul_add(_mm256_load_ps(_h + 2 * r + 8),
+                           _mm256_loadu_ps(reinterpret_cast<const float*>(_in + r + 4)), sum1);
+        }
+        if(r < len_taps){
+            sum0 = mul_add(_mm256_load_ps(_h + 2 * r),
+                           _mm256_loadu_ps(reinterpret_cast<const float*>(_in + r)), sum0);
+        }
+        sum0 = _mm256_add_ps(sum0, sum1);
+        __m128 t = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+        t = _mm_add_ps(t, _mm_movehl_ps(t, t));
+        alignas(16) float out[4];
+        _mm_store_ps(out, t);
+        return {out[0], out[1]};
+    }
+
+public:
+    resampler_polyphase()
+    {
+
+    }
+
+    ~resampler_polyphase()
+    {
+        _mm_free(h_phase);
+        _mm_free(buffer);
+    }
+
+    // _ratio: input samples per sample at DECIMATION_STEP x output rate
+    void init(double _ratio)
+    {
+        ratio = _ratio;
+        generate();
+    }
+
+    void set_filter(int _n)
+    {
+        selected_fir = _n;
+        generate();
+    }
+
+    // Derotates by _nco advanced by _incr per input sample and resamples at _step input samples
+    // per output (DECIMATION_STEP x ratio plus the timing correction).
+    void execute(int _len_in, const complex* _in, complex &_nco, complex _incr, double _step,
+                 int &_len_out, complex* _out)
+    {
+        int idx_out = 0;
+        for(int idx_in = 0; idx_in < _len_in; idx_in += len_chunk){
+            int len = std::min(len_chunk, _len_in - idx_in);
+            derotate(len, _in + idx_in, _nco, _incr, buffer + len_history);
+            _nco /= std::abs(_nco);
+            const int len_buffer = len_history + len;
+            for(;;){
+                int base = static_cast<int>(time);
+                int p = static_cast<int>((time - base) * PHASES + 0.5);
+                if(base + 3 > len_buffer) break;
+                _out[idx_out++] = dot(buffer + base + 3 - len_taps, h_phase + 2 * len_taps * p);
+                time += _step;
+            }
+            time -= len;
+            memmove(buffer, buffer + len, sizeof(complex) * static_cast<size_t>(len_history));
+        }
+        _len_out = idx_out;
+    }
+
+};
+
+#endif // RESAMPLER_POLYPHASE_HH
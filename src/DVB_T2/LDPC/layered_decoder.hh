@@ -178,6 +178,15 @@ public:
         parity[q*j+i] = pty[M*i+j];
     return trials;
   }
+  // code in transmission order (data then parity), decoded in place
+  int decode(TYPE *code, int trials = 25, int blocks = 1)
+  {
+    reset();
+    TYPE *parity = code + K;
+    while (bad(code, parity, blocks) && --trials >= 0)
+      update(code, parity);
+    return trials;
+  }
   ~LDPCDecoder()
   {
     if (initialized) {
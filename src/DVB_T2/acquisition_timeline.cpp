@@ -0,0 +1,81 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "acquisition_timeline.h"
+
+#include <chrono>
+
+//-------------------------------------------------------------------------------------------
+acquisition_timeline::acquisition_timeline()
+{
+    for(int i = 0; i < ACQUISITION_EVENTS; ++i) time_event[i].store(-1);
+    time_start.store(now_us());
+}
+//-------------------------------------------------------------------------------------------
+acquisition_timeline& acquisition_timeline::instance()
+{
+    static acquisition_timeline timeline;
+    return timeline;
+}
+//-------------------------------------------------------------------------------------------
+int64_t acquisition_timeline::now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//-------------------------------------------------------------------------------------------
+void acquisition_timeline::start()
+{
+    for(int i = 0; i < ACQUISITION_EVENTS; ++i) time_event[i].store(-1, std::memory_order_relaxed);
+    time_start.store(now_us(), std::memory_order_release);
+}
+//-------------------------------------------------------------------------------------------
+void acquisition_timeline::mark(acquisition_event_t _event)
+{
+    std::atomic<int64_t> &event = time_event[_event];
+    if(event.load(std::memory_order_relaxed) >= 0) return;
+    int64_t t = now_us() - time_start.load(std::memory_order_acquire);
+    int64_t expected = -1;
+    event.compare_exchange_strong(expected, t < 0 ? 0 : t, std::memory_order_release);
+}
+//-------------------------------------------------------------------------------------------
+int64_t acquisition_timeline::time_us(acquisition_event_t _event) const
+{
+    return time_event[_event].load(std::memory_order_acquire);
+}
+//-------------------------------------------------------------------------------------------
+const char* acquisition_timeline::name(acquisition_event_t _event)
+{
+    switch (_event) {
+    case ACQUISITION_P1:
+        return "P1 detect";
+    case ACQUISITION_COARSE_FREQUENCY:
+        return "coarse frequency";
+    case ACQUISITION_GUARD_INTERVAL:
+        return "guard interval";
+    case ACQUISITION_L1_PRE:
+        return "L1-pre CRC";
+    case ACQUISITION_L1_POST:
+        return "L1-post CRC";
+    case ACQUISITION_DEINTERLEAVER:
+        return "time deinterleaver";
+    case ACQUISITION_LDPC:
+        return "first LDPC";
+    case ACQUISITION_TS:
+        return "first TS packet";
+    default:
+        return "";
+    }
+}
+//-------------------------------------------------------------------------------------------
@@ -0,0 +1,61 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef ACQUISITION_TIMELINE_H
+#define ACQUISITION_TIMELINE_H
+
+#include <atomic>
+#include <cstdint>
+
+enum acquisition_event_t
+{
+    ACQUISITION_P1 = 0,                 // first P1 detected
+    ACQUISITION_COARSE_FREQUENCY,       // P1 decoded inside the coarse frequency range
+    ACQUISITION_GUARD_INTERVAL,         // guard interval detected
+    ACQUISITION_L1_PRE,                 // L1-pre CRC ok
+    ACQUISITION_L1_POST,                // L1-post CRC ok
+    ACQUISITION_DEINTERLEAVER,          // time deinterleaver started
+    ACQUISITION_LDPC,                   // first LDPC codeword recovered
+    ACQUISITION_TS,                     // first TS packet out
+    ACQUISITION_EVENTS
+};
+
+// Time of the first of each acquisition event since the start of the receiver. The events
+// are marked from the threads of the chain, read from any thread.
+class acquisition_timeline
+{
+public:
+    static acquisition_timeline& instance();
+
+    // tuned: all events are timed from now on
+    void start();
+    // the first mark of the event after start() holds
+    void mark(acquisition_event_t _event);
+    // microseconds from start() to the event, -1 when not there yet
+    int64_t time_us(acquisition_event_t _event) const;
+    bool locked() const
+    {
+        return time_us(ACQUISITION_TS) >= 0;
+    }
+    static const char* name(acquisition_event_t _event);
+
+private:
+    acquisition_timeline();
+    static int64_t now_us();
+
+    std::atomic<int64_t> time_start{0};
+    std::atomic<int64_t> time_event[ACQUISITION_EVENTS];
+};
+
+#endif // ACQUISITION_TIMELINE_H
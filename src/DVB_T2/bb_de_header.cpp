@@ -20,6 +20,10 @@
 #include <qscopedpointer.h>
 #include <qudpsocket.h>
 
+#include "acquisition_timeline.h"
+#include "receiver_metrics.h"
+#include "stage_tracer.h"
+
 //#include <QDebug>
 
 #define CRC_POLY 0xAB
@@ -82,6 +86,8 @@ void bb_de_header::execute(int _plp_id, l1_postsignalling _l1_post, int _len_in,
 {
     mutex_in->lock();
     signal_in->wakeOne();
+    TRACE_SCOPE(TRACE_BB_DE_HEADER, trace_codeword / SIZEOF_SIMD);
+    ++trace_codeword;
 
 //                mutex_in->unlock();
 //                return;
@@ -103,6 +109,7 @@ void bb_de_header::execute(int _plp_id, l1_postsignalling _l1_post, int _len_in,
         break;
     default:
         info_already_set = false;
+        receiver_metrics::instance().add(METRIC_BB_HEADER_ERRORS);
         emit ts_stage("Baseband header CRC8 error.");
         mutex_in->unlock();
         return;
@@ -439,6 +446,7 @@ error_lengh:
         }
     }
     ctx.out = ctx.begin_out;
+    if(ctx.len_out >= TRANSPORT_PACKET_LENGTH) acquisition_timeline::instance().mark(ACQUISITION_TS);
 
     mutex_out->lock();
     for(const auto& device: out_devices)
@@ -460,6 +468,9 @@ error_lengh:
     }
     mutex_out->unlock();
 
+    receiver_metrics &metrics = receiver_metrics::instance();
+    metrics.ts_packets(_plp_id, static_cast<uint64_t>(ctx.len_out / TRANSPORT_PACKET_LENGTH));
+    if(errors != 0) metrics.add(METRIC_TS_CRC_ERRORS, static_cast<uint64_t>(errors));
     ctx.len_out = 0;
 
     if(errors != 0) emit ts_stage("TS error.");
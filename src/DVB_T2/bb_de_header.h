@@ -129,6 +129,7 @@ private:
     std::map<int, plp_out_device> out_devices;
 
     bool info_already_set = false;
+    int64_t trace_codeword = 0;     // SIZEOF_SIMD per FEC batch
     QString info = "";
     int next_plp_info = 0;
     void set_info(int _plp_id, l1_postsignalling &_l1_post, dvbt2_inputmode_t mode, bb_header header);
@@ -14,6 +14,10 @@
 */
 #include "bch_decoder.h"
 
+#include <cstring>
+
+#include "stage_tracer.h"
+
 //------------------------------------------------------------------------------------------
 bch_decoder::bch_decoder(QWaitCondition *_signal_in, QMutex *_mutex_in, QObject *parent) :
     QObject(parent),
@@ -49,16 +53,24 @@ void bch_decoder::init_descrambler()
       int sr = 0x4A80;
       for (int i = 0; i < 54000; i++) {
         uint8_t b = ((sr) ^ (sr >> 1)) & 1;
-        descrambler[i] = b;
+        if(i % 8 == 0) descrambler[i / 8] = 0;
+        descrambler[i / 8] |= b << (7 - i % 8);
         sr >>= 1;
         if(b) {
           sr |= 0x4000;
         }
       }
+      for (int i = 0; i < 256; i++) {
+        for (int j = 0; j < 8; j++) {
+          unpack[i][j] = (i >> (7 - j)) & 1;
+        }
+      }
     }
 //------------------------------------------------------------------------------------------
 void bch_decoder::execute(idx_plp_simd_t _idx_plp_simd, l1_postsignalling _l1_post, int _len_in, in_t _in)
 {
+    TRACE_SCOPE(TRACE_BCH_DECODER, trace_item);
+    ++trace_item;
 //        mutex_in->unlock();
 //        return;
 
@@ -129,10 +141,12 @@ void bch_decoder::execute(idx_plp_simd_t _idx_plp_simd, l1_postsignalling _l1_po
 
     // TODO BCH decode
 
+    // input is packed bits, one codeword after another; descramble 8 bits at a time
     int n = 0;
     for(int j = 0; j < len_in; j += n_bch) {
-        for (int i = 0; i < k_bch; ++i) {
-            out[i] = in[j + i] ^ descrambler[i];
+        const uint8_t* packed = in + j / 8;
+        for (int i = 0; i < k_bch / 8; ++i) {
+            memcpy(out + 8 * i, unpack[packed[i] ^ descrambler[i]], 8);
         }
         if(swap_buffer) {
             swap_buffer = false;
@@ -56,7 +56,9 @@ private:
     std::array<uint8_t, max_len> buffer_a{};
     std::array<uint8_t, max_len> buffer_b{};
     bool swap_buffer = true;
-    uint8_t descrambler[FEC_SIZE_NORMAL];
+    int64_t trace_item = 0;
+    uint8_t descrambler[FEC_SIZE_NORMAL / 8];     // packed msb first like the input
+    uint8_t unpack[256][8];                       // packed byte to one byte per bit
     void init_descrambler();
 
     unsigned int kbch;
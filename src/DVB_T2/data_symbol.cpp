@@ -16,8 +16,38 @@
 
 //#include <QDebug>
 
+#include <immintrin.h>
+
 #include "DSP/fast_math.h"
 
+//-------------------------------------------------------------------------------------------
+static inline __m256 load_cell(const complex* _cell, const int* _idx)
+{
+    __m128 lo = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(_cell + _idx[0]));
+    lo = _mm_loadh_pi(lo, reinterpret_cast<const __m64*>(_cell + _idx[1]));
+    __m128 hi = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(_cell + _idx[2]));
+    hi = _mm_loadh_pi(hi, reinterpret_cast<const __m64*>(_cell + _idx[3]));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+//-------------------------------------------------------------------------------------------
+// cell * conj(h) / |h|^2, and the channel state weight min(|h|^2 * csi_scale, 255) of each float
+static inline __m256 equalize_cell(__m256 _cell, __m256 _h, __m256 _csi_scale, __m256i &_csi)
+{
+    const __m256 signbits = _mm256_set1_ps(-0.0f);
+    __m256 t_re = _mm256_mul_ps(_cell, _mm256_moveldup_ps(_h));
+    __m256 t_im = _mm256_mul_ps(_mm256_permute_ps(_cell, 0xb1), _mm256_movehdup_ps(_h));
+    __m256 num = _mm256_addsub_ps(t_re, _mm256_xor_ps(t_im, signbits));
+    __m256 norm = _mm256_mul_ps(_h, _h);
+    norm = _mm256_add_ps(norm, _mm256_permute_ps(norm, 0xb1));
+    _csi = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_mul_ps(norm, _csi_scale), _mm256_set1_ps(255.0f)));
+    return _mm256_div_ps(num, norm);
+}
+//-------------------------------------------------------------------------------------------
+static inline uint8_t channel_state(float _norm, float _csi_scale)
+{
+    return static_cast<uint8_t>(std::min(_norm * _csi_scale, 255.0f) + 0.5f);
+}
+
 //-------------------------------------------------------------------------------------------
 data_symbol::data_symbol(QObject* parent) : QObject(parent)
 {
@@ -37,44 +67,7 @@ void data_symbol::init(dvbt2_parameters &_dvbt2, pilot_generator* _pilot,
     half_fft_size = fft_size / 2;
     pilot = _pilot;
     address = _address;
-    switch (_dvbt2.fft_mode)
-    {
-    case FFTSIZE_1K:
-    case FFTSIZE_2K:
-        amp_cp = 4.0f / 3.0f;
-        break;
-     case FFTSIZE_4K:
-        amp_cp = (4.0f * sqrtf(2)) / 3.0f;
-
-        break;
-    case FFTSIZE_8K:
-    case FFTSIZE_8K_T2GI:
-    case FFTSIZE_16K:
-    case FFTSIZE_16K_T2GI:
-    case FFTSIZE_32K:
-    case FFTSIZE_32K_T2GI:
-        amp_cp = 8.0f / 3.0f;
-        break;
-    }
     dvbt2_data_parameters_init(_dvbt2);
-    switch (_dvbt2.pilot_pattern)
-    {
-    case PP1:
-    case PP2:
-        amp_sp = 4.0f / 3.0f;
-        break;
-    case PP3:
-    case PP4:
-        amp_sp = 7.0f / 4.0f;
-        break;
-    case PP5:
-    case PP6:
-    case PP7:
-    case PP8:
-        amp_sp = 7.0f / 3.0f;
-        break;
-    }
-    cor_amp_cp = amp_sp / amp_cp;
     n_data = _dvbt2.n_data;
     c_data = _dvbt2.c_data;
     k_total = _dvbt2.k_total;
@@ -82,218 +75,362 @@ void data_symbol::init(dvbt2_parameters &_dvbt2, pilot_generator* _pilot,
     n_p2 = _dvbt2.n_p2;
     left_nulls = _dvbt2.l_nulls;
     pilot->data_generator(_dvbt2);
-    data_carrier_map = pilot->data_carrier_map;
-    data_pilot_refer = pilot->data_pilot_refer;
-    buffer_cell.resize(c_data);
-    prev_pilot.resize(k_total);
+    channel_step = pilot->dx;
+    len_grid = (k_total - 1) / channel_step + 1;
+    stride_poly = (len_grid + 3) & ~3;
+    int len_pattern = static_cast<int>(pilot->data_carrier_map.size());
+    pattern.resize(len_pattern);
+    for(int i = 0; i < len_pattern; ++i) carrier_list_generator(pilot->data_carrier_map[i], pattern[i]);
+    continual_pilot_generator();
+    for(int i = 0; i < len_pattern; ++i) fft_bin_generator(pattern[i]);
+    channel.resize(k_total);
+    channel_prev.resize(k_total);
+    float spread = static_cast<float>(fft_size) / channel_step;
+    if(_dvbt2.guard_interval_size > 0) spread = std::min(spread, 2.0f * _dvbt2.guard_interval_size);
+    wiener_generator(spread);
+    grid.assign(stride_poly + len_wiener, {1.0f, 0.0f});
+    channel_poly.assign(channel_step * stride_poly, {0.0f, 0.0f});
+    end_data_symbol = _dvbt2.len_frame - _dvbt2.l_fc;
+    // frame closing, P1 (as one symbol) and P2 symbols in between
+    frame_gap = _dvbt2.l_fc + 1 + n_p2 + 1;
+    // a dx carrier has a scattered pilot every dy symbols
+    delay = pilot->dy - 1;
+    len_history = 2 * pilot->dy;
+    history.assign(len_history * len_grid, {0.0f, 0.0f});
+    history_valid.assign(len_history * len_grid, 0);
+    history_time.assign(len_history, 0);
+    len_delayed_cell = 0;
+    for(const carrier_list &list : pattern) len_delayed_cell = std::max(len_delayed_cell, static_cast<int>(list.data.size()));
+    delayed.resize(delay + 1);
+    delayed_cell.resize((delay + 1) * len_delayed_cell);
+    reset_history();
+    last_idx_symbol = -2;
+    prev_pilot.resize(fft_size);
     address->data_address_freq_deinterleaver(_dvbt2);
     h_even_data = address->h_even_data;
     h_odd_data = address->h_odd_data;
-    est_show.resize(fft_size);
-    show_symbol.resize(fft_size);
     show_data.resize(c_data);
 
 }
 //-------------------------------------------------------------------------------------------
-void data_symbol::execute(int _idx_symbol, complex* _ofdm_cell,
-                              float &_sample_rate_offset, float &_phase_offset, std::vector<complex> &out)
+void data_symbol::carrier_list_generator(const std::vector<int8_t> &_map, carrier_list &_list)
 {
-    complex* ofdm_cell = &_ofdm_cell[left_nulls];
-    complex est_pilot;
-    float angle = 0.0f;
-    float delta_angle = 0.0f;
-    float angle_est = 0.0f;
-    float amp = 0.0f;
-    float delta_amp = 0.0f;
-    float amp_est = 0.0f;
-    float dif_angle = 0.0f;
-    float sum_angle_1 = 0.0f;
-    float sum_angle_2 = 0.0f;
-    complex sum_pilot_1 = {0.0f, 0.0f};
-    complex sum_pilot_2 = {0.0f, 0.0f};
-    int idx_symbol = _idx_symbol;
-    int idx_data_symbol = idx_symbol - n_p2;
-    int len_show = 0;
-    float* pilot_refer_idx_data_symbol = data_pilot_refer[idx_data_symbol].data();
-    float pilot_refer;
-    int* map = data_carrier_map[idx_data_symbol].data();
-    float amp_pilot = amp_sp;
-    complex cell;
-    complex derotate;
-    int idx_data = 0;
-    int d = 0;
-    int* h;
-    if(out.size()!=c_data)
-        out.resize(c_data);
-    complex* deinterleaved_cell=out.data();
-    if(idx_symbol % 2 == 0) h = h_odd_data;
-    else h = h_even_data;
-    //__for first pilot______
-    cell = ofdm_cell[0];
-    pilot_refer = pilot_refer_idx_data_symbol[0];
-    est_pilot = cell * pilot_refer;
-    sum_pilot_1 += est_pilot;
-    angle_est = atan2_approx(est_pilot.imag(), est_pilot.real());
-    amp_est = sqrt(norm(cell)) / amp_pilot;
-    //__ ... ______________
-
-    for (int i = 1; i < half_total; ++i){
-        cell = ofdm_cell[i];
-        pilot_refer = pilot_refer_idx_data_symbol[i];
-        switch (map[i]){
-        case DATA_CARRIER:
-            buffer_cell[idx_data] = cell;
-            ++idx_data;
-            break;
+    _list.pilot.clear();
+    _list.pilot_refer.clear();
+    _list.data.clear();
+    _list.data_pilot.clear();
+    _list.data_weight.clear();
+    _list.grid_pilot.clear();
+    _list.grid_index.clear();
+    _list.data_poly.clear();
+    _list.pilot_end_1 = 0;
+    for (int i = 0; i < k_total; ++i){
+        switch (_map[i]){
+        case SCATTERED_CARRIER:
+        case SCATTERED_CARRIER_INVERTED:
         case CONTINUAL_CARRIER:
-            amp_pilot = amp_cp;
-           [[clang::fallthrough]];//_to suppress compiler warnings:
-//            break;
         case CONTINUAL_CARRIER_INVERTED:
-            amp_pilot = amp_cp;
-           [[clang::fallthrough]];//_to suppress compiler warnings:
-//            break;
-        case SCATTERED_CARRIER_INVERTED:
-        case SCATTERED_CARRIER:
-            est_pilot = cell * pilot_refer;
-            sum_pilot_1 += est_pilot;
-            angle = atan2_approx(est_pilot.imag(), est_pilot.real());
-
-            dif_angle = angle - angle_est;
-            if(dif_angle > M_PIf32) dif_angle = M_PIf32 * 2.0f - dif_angle;
-            else if(dif_angle < -M_PIf32) dif_angle = M_PIf32 * 2.0f + dif_angle;
-            sum_angle_1 += (est_pilot * std::conj(prev_pilot[i])).imag();
-            prev_pilot[i] = est_pilot;
-
-            delta_angle = (dif_angle) / (idx_data + 1);
-            amp = sqrt(norm(cell)) / amp_pilot;
-            amp_pilot = amp_sp;
-            delta_amp = (amp - amp_est) / (idx_data + 1);
-            derotate = std::conj(complex(cos_lut(angle_est),sin_lut(angle_est)));
-            {
-                complex derot_delta = std::conj(complex(cos_lut(delta_angle),sin_lut(delta_angle)));
-                for(int j = 0; j < idx_data; ++j){
-                    amp_est += delta_amp;
-                    derotate *= derot_delta;
-                    deinterleaved_cell[h[d]] = buffer_cell[j] * derotate / amp_est;
-                    ++d;
-                }
+            if(i < half_total) _list.pilot_end_1 = static_cast<int>(_list.pilot.size()) + 1;
+            if(i % channel_step == 0){
+                _list.grid_pilot.push_back(static_cast<int>(_list.pilot.size()));
+                _list.grid_index.push_back(i / channel_step);
             }
-            idx_data = 0;
-            angle_est = angle;
-            amp_est = amp;
-            //Only for show
-#if 0
-            est_show[len_show].real(angle);
-            est_show[len_show].imag(amp);
-            ++len_show;
-#endif
-            // ...
+            _list.pilot.push_back(i);
+            _list.pilot_refer.push_back(pilot->prbs_bit(i) ? -pilot->data_pilot_amplitude(_map[i]) :
+                                                             pilot->data_pilot_amplitude(_map[i]));
             break;
-        case TRPAPR_CARRIER:
-            //TODO
-            //printf("TRPAPR_CARRIER\n");
+        case DATA_CARRIER:
+            _list.data.push_back(i);
+            _list.data_poly.push_back((i % channel_step) * stride_poly + i / channel_step);
             break;
         default:
+            //TRPAPR_CARRIER
             break;
         }
     }
-    //
-    cell = ofdm_cell[half_total];
-    pilot_refer = pilot_refer_idx_data_symbol[half_total];
-    switch (map[half_total]){
-    case DATA_CARRIER:
-        buffer_cell[idx_data] = cell;
-        ++idx_data;
-        break;
-    case CONTINUAL_CARRIER:
-        amp_pilot = amp_cp;
-       [[clang::fallthrough]];//_to suppress compiler warnings:
-        //            break;
-    case CONTINUAL_CARRIER_INVERTED:
-        amp_pilot = amp_cp;
-       [[clang::fallthrough]];//_to suppress compiler warnings:
-        //            break;
-    case SCATTERED_CARRIER_INVERTED:
-    case SCATTERED_CARRIER:
-        est_pilot = cell * pilot_refer;
-        amp_pilot = amp_sp;
-        //Only for show
-#if 0
-        est_show[len_show].real(atan2_approx(est_pilot.imag(), est_pilot.real()));
-        est_show[len_show].imag(sqrt(norm(cell)) / amp_pilot);
-        ++len_show;
-#endif
-        // ...
-        break;
-    case TRPAPR_CARRIER:
-        //TODO
-        //printf("TRPAPR_CARRIER\n");
-        break;
-    default:
-        break;
+    int len_pilot = static_cast<int>(_list.pilot.size());
+    _list.pilot_begin_2 = _list.pilot_end_1;
+    if(_list.pilot_begin_2 < len_pilot && _list.pilot[_list.pilot_begin_2] == half_total) ++_list.pilot_begin_2;
+    int p = 0;
+    for(int i : _list.data){
+        while(p + 1 < len_pilot && _list.pilot[p + 1] < i) ++p;
+        float weight = 0.0f;
+        if(p + 1 < len_pilot && _list.pilot[p] < i){
+            weight = static_cast<float>(i - _list.pilot[p]) /
+                     static_cast<float>(_list.pilot[p + 1] - _list.pilot[p]);
+        }
+        _list.data_pilot.push_back(p);
+        _list.data_weight.push_back(weight);
+    }
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::continual_pilot_generator()
+{
+    const int len_pattern = static_cast<int>(pattern.size());
+    std::vector<int> count(k_total, 0);
+    for(const carrier_list &list : pattern) for(int i : list.pilot) ++count[i];
+    for(carrier_list &list : pattern){
+        list.continual.clear();
+        for(int p = 0; p < static_cast<int>(list.pilot.size()); ++p){
+            if(count[list.pilot[p]] == len_pattern) list.continual.push_back(p);
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::fft_bin_generator(carrier_list &_list)
+{
+    const int bin_shift = left_nulls + fft_size / 2;
+    const int bin_mask = fft_size - 1;
+    for(int &i : _list.pilot) i = (i + bin_shift) & bin_mask;
+    for(int &i : _list.data) i = (i + bin_shift) & bin_mask;
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::wiener_generator(float _spread)
+{
+    // uniform delay profile _spread samples wide: correlation sinc(k * _spread / fft_size)
+    auto correlation = [&](double _k){
+        double x = M_PI * _k * _spread / fft_size;
+        return std::abs(x) < 1.0e-9 ? 1.0 : sin(x) / x;
+    };
+    constexpr double noise = 0.01;      // 20 dB
+    wiener.resize(channel_step * len_wiener);
+    for(int r = 0; r < channel_step; ++r){
+        double a[len_wiener][len_wiener + 1];
+        double x = static_cast<double>(r) / channel_step;
+        for(int t = 0; t < len_wiener; ++t){
+            for(int u = 0; u < len_wiener; ++u){
+                a[t][u] = correlation((t - u) * channel_step) + (t == u ? noise : 0.0);
+            }
+            a[t][len_wiener] = correlation((t - wiener_pad - x) * channel_step);
+        }
+        for(int t = 0; t < len_wiener; ++t){
+            for(int u = t + 1; u < len_wiener; ++u){
+                double f = a[u][t] / a[t][t];
+                for(int v = t; v <= len_wiener; ++v) a[u][v] -= f * a[t][v];
+            }
+        }
+        double w[len_wiener];
+        double sum = 0.0;
+        for(int t = len_wiener - 1; t >= 0; --t){
+            double b = a[t][len_wiener];
+            for(int u = t + 1; u < len_wiener; ++u) b -= a[t][u] * w[u];
+            w[t] = b / a[t][t];
+            sum += w[t];
+        }
+        // unity gain, the equalizer must not scale the constellation
+        for(int t = 0; t < len_wiener; ++t) wiener[r * len_wiener + t] = static_cast<float>(w[t] / sum);
+    }
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::reset_history()
+{
+    std::fill(history_valid.begin(), history_valid.end(), 0);
+    std::fill(grid.begin(), grid.end(), complex{1.0f, 0.0f});
+    seq_in = 0;
+    seq_out = 0;
+    time_symbol = 0;
+    common_phase = 0.0f;
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::store_history(const carrier_list &_list)
+{
+    const int row = seq_in % len_history;
+    complex* h = &history[row * len_grid];
+    uint8_t* valid = &history_valid[row * len_grid];
+    std::fill(valid, valid + len_grid, 0);
+    const complex derotate = std::polar(1.0f, -common_phase);
+    for(size_t i = 0; i < _list.grid_pilot.size(); ++i){
+        int m = _list.grid_index[i];
+        h[m] = channel[_list.grid_pilot[i]].h * derotate;
+        valid[m] = 1;
     }
+    history_time[row] = time_symbol;
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::interpolate_time(int _seq)
+{
+    // the rows of seq_in - len_history .. seq_in - 1 are held, _seq is no more than delay back,
+    // so the pilots before it go delay + 1 symbols back and the ones after it up to seq_in - 1
+    const int first = std::max(seq_in - len_history, 0);
+    const float t = static_cast<float>(history_time[_seq % len_history]);
+    const complex common = delayed[_seq % (delay + 1)].common;
+    complex* g = &grid[wiener_pad];
+    for(int m = 0; m < len_grid; ++m){
+        int before = _seq;
+        while(before >= first && !history_valid[(before % len_history) * len_grid + m]) --before;
+        if(before == _seq){
+            g[m] = history[(_seq % len_history) * len_grid + m] * common;
 
-    int c = half_total + 1;
-    for (int i = c; i < k_total; ++i){
-        cell = ofdm_cell[i];
-        pilot_refer = pilot_refer_idx_data_symbol[i];
-        switch (map[i]){
-        case DATA_CARRIER:
-            buffer_cell[idx_data] = cell;
-            ++idx_data;
-            break;
-        case CONTINUAL_CARRIER:
-            amp_pilot = amp_cp;
-           [[clang::fallthrough]];//_to suppress compiler warnings:
-//            break;
-        case CONTINUAL_CARRIER_INVERTED:
-            amp_pilot = amp_cp;
-           [[clang::fallthrough]];//_to suppress compiler warnings:
-//            break;
-        case SCATTERED_CARRIER_INVERTED:
-        case SCATTERED_CARRIER:
-            est_pilot = cell * pilot_refer;
-            sum_pilot_2 += est_pilot;
-            angle = atan2_approx(est_pilot.imag(), est_pilot.real());
+            continue;
 
-            dif_angle = angle - angle_est;
-            if(dif_angle > M_PIf32) dif_angle = M_PIf32 * 2.0f - dif_angle;
-            else if(dif_angle < -M_PIf32) dif_angle = M_PIf32 * 2.0f + dif_angle;
+        }
+        int after = _seq + 1;
+        while(after < seq_in && !history_valid[(after % len_history) * len_grid + m]) ++after;
+        complex h;
+        if(before >= first && after < seq_in){
+            const complex &h0 = history[(before % len_history) * len_grid + m];
+            const complex &h1 = history[(after % len_history) * len_grid + m];
+            const float t0 = static_cast<float>(history_time[before % len_history]);
+            const float t1 = static_cast<float>(history_time[after % len_history]);
+            h = h0 + (t - t0) / (t1 - t0) * (h1 - h0);
+        }
+        // the end of the frame: the last pilot held
+        else if(before >= first) h = history[(before % len_history) * len_grid + m];
+        // first symbols after the reset: the first pilot held back
+        else if(after < seq_in) h = history[(after % len_history) * len_grid + m];
+        // no pilot on the carrier since the reset yet
+        else continue;
+        g[m] = h * common;
+    }
+    for(int m = 0; m < wiener_pad; ++m) grid[m] = g[0];
+    for(int m = wiener_pad + len_grid; m < static_cast<int>(grid.size()); ++m) grid[m] = g[len_grid - 1];
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::interpolate_grid()
+{
+    // polyphase interpolation by channel_step, row r holds the carriers m * channel_step + r
+    for(int r = 0; r < channel_step; ++r){
+        const float* w = &wiener[r * len_wiener];
+        float* out = reinterpret_cast<float*>(&channel_poly[r * stride_poly]);
+        for(int m = 0; m < len_grid; m += 4){
+            __m256 acc = _mm256_setzero_ps();
+            for(int t = 0; t < len_wiener; ++t){
+                __m256 g = _mm256_loadu_ps(reinterpret_cast<const float*>(&grid[m + t]));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(g, _mm256_set1_ps(w[t])));
+            }
+            _mm256_storeu_ps(out + 2 * m, acc);
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::execute(int _idx_symbol, complex* _ofdm_cell,
+                              float &_sample_rate_offset, float &_phase_offset, time_deinterleaver* _deinterleaver)
+{
+    const complex* ofdm_cell = _ofdm_cell;
+    int idx_symbol = _idx_symbol;
+    int idx_data_symbol = idx_symbol - n_p2;
+    const int idx_pattern = idx_data_symbol % static_cast<int>(pattern.size());
+    const carrier_list &list = pattern[idx_pattern];
+    const float* pilot_refer = list.pilot_refer.data();
+    const float pn_sign = pilot->pn_bit(idx_symbol) ? -1.0f : 1.0f;
+    int* h;
+    if(idx_symbol % 2 == 0) h = h_odd_data;
+    else h = h_even_data;
+    const bool show_due = enabled_display && idx_symbol == n_p2 && spectrograph_buffer.due();
+    //__channel estimation on pilots______
+    complex sum_pilot_1 = {0.0f, 0.0f};
+    complex sum_pilot_2 = {0.0f, 0.0f};
+    float sum_angle_1 = 0.0f;
+    float sum_angle_2 = 0.0f;
+    float sum_norm = 0.0f;
+    const int len_pilot = static_cast<int>(list.pilot.size());
+    for(int p = 0; p < len_pilot; ++p){
+        int i = list.pilot[p];
+        float refer = pilot_refer[p] * pn_sign;
+        complex est_pilot = ofdm_cell[i] * refer;
+        if(p < list.pilot_end_1){
+            sum_pilot_1 += est_pilot;
+            sum_angle_1 += (est_pilot * std::conj(prev_pilot[i])).imag();
+            prev_pilot[i] = est_pilot;
+        }
+        else if(p >= list.pilot_begin_2){
+            sum_pilot_2 += est_pilot;
             sum_angle_2 += (est_pilot * std::conj(prev_pilot[i])).imag();
             prev_pilot[i] = est_pilot;
-
-            delta_angle = (dif_angle) / (idx_data + 1);
-            amp = sqrt(norm(cell)) / amp_pilot;
-            amp_pilot = amp_sp;
-            delta_amp = (amp - amp_est) / (idx_data + 1);
-            derotate = std::conj(complex(cos_lut(angle_est),sin_lut(angle_est)));
-            {
-                complex derot_delta = std::conj(complex(cos_lut(delta_angle),sin_lut(delta_angle)));
-                for(int j = 0; j < idx_data; ++j){
-                    amp_est += delta_amp;
-                    derotate *= derot_delta;
-                    deinterleaved_cell[h[d]] = buffer_cell[j] * derotate / amp_est;
-                    ++d;
-                }
+        }
+        channel[p].h = est_pilot / (refer * refer);
+        sum_norm += std::norm(channel[p].h);
+    }
+    for(int p = 0; p < len_pilot - 1; ++p) channel[p].dh = channel[p + 1].h - channel[p].h;
+    channel[len_pilot - 1].dh = {0.0f, 0.0f};
+    // the channel state weight is |h|^2 relative to the mean over the pilots of the symbol
+    const float csi_scale = sum_norm > 0.0f ? CSI_UNITY * len_pilot / sum_norm : 0.0f;
+    if(show_due) {
+        spectrograph_buffer.publish(_ofdm_cell, fft_size, fft_size / 2);
+        emit replace_spectrograph(&spectrograph_buffer);
+    }
+    if(enabled_channel_2d){
+        //__time/frequency interpolation, the symbol is equalized delay symbols later______
+        if(idx_symbol == last_idx_symbol + 1){
+            time_symbol += 1;
+        }
+        else if(idx_symbol == n_p2 && last_idx_symbol == end_data_symbol - 1){
+            time_symbol += frame_gap;
+        }
+        else{
+            while(seq_out < seq_in) equalize_delayed(seq_out++, _deinterleaver);
+            reset_history();
+        }
+        if(seq_in > 0){
+            // common phase change since the previous symbol
+            const carrier_list &prev = pattern[last_pattern];
+            complex cross = {0.0f, 0.0f};
+            for(size_t i = 0; i < list.continual.size(); ++i){
+                cross += channel[list.continual[i]].h * std::conj(channel_prev[prev.continual[i]].h);
             }
-            idx_data = 0;
-            angle_est = angle;
-            amp_est = amp;
-            //Only for show
-#if 0
-            est_show[len_show].real(angle);
-            est_show[len_show].imag(amp);
-            ++len_show;
-#endif
-            // ...
-            break;
-        case TRPAPR_CARRIER:
-            //TODO
-            //printf("TRPAPR_CARRIER\n");
-            break;
-        default:
-            break;
+            if(std::norm(cross) > 0.0f){
+                common_phase = std::remainder(common_phase + std::arg(cross), M_PI_X_2);
+            }
+        }
+        store_history(list);
+        const int slot = seq_in % (delay + 1);
+        delayed[slot] = {idx_symbol, idx_pattern, csi_scale, std::polar(1.0f, common_phase), show_due};
+        complex* cell = &delayed_cell[slot * len_delayed_cell];
+        const int len_data = static_cast<int>(list.data.size());
+        for(int j = 0; j < len_data; ++j) cell[j] = ofdm_cell[list.data[j]];
+        ++seq_in;
+        last_idx_symbol = idx_symbol;
+        last_pattern = idx_pattern;
+        // the last data symbol of the frame: the rest is equalized now on the last pilots held
+        const int ready = idx_symbol == end_data_symbol - 1 ? seq_in : seq_in - delay;
+        while(seq_out < ready) equalize_delayed(seq_out++, _deinterleaver);
+    }
+    else{
+        while(seq_out < seq_in) equalize_delayed(seq_out++, _deinterleaver);
+        last_idx_symbol = -2;
+        //__linear interpolation between pilots and equalization of data cells______
+        complex* show = show_due ? &show_data[0] : nullptr;
+        _deinterleaver->begin_symbol(c_data);
+        const int len_data = static_cast<int>(list.data.size());
+        const int* data = list.data.data();
+        alignas(32) complex equalized[4];
+        alignas(32) int csi[8];
+        const __m256 v_csi_scale = _mm256_set1_ps(csi_scale);
+        __m256i v_csi;
+        const int* data_pilot = list.data_pilot.data();
+        const float* data_weight = list.data_weight.data();
+        const float* est = reinterpret_cast<const float*>(channel.data());
+        int j = 0;
+        for(; j + 4 <= len_data; j += 4){
+            __m256 v_cell = load_cell(ofdm_cell, data + j);
+            __m128 e0 = _mm_loadu_ps(est + 4 * data_pilot[j]);
+            __m128 e1 = _mm_loadu_ps(est + 4 * data_pilot[j + 1]);
+            __m128 e2 = _mm_loadu_ps(est + 4 * data_pilot[j + 2]);
+            __m128 e3 = _mm_loadu_ps(est + 4 * data_pilot[j + 3]);
+            __m256 v_h = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_movelh_ps(e0, e1)), _mm_movelh_ps(e2, e3), 1);
+            __m256 v_dh = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_movehl_ps(e1, e0)), _mm_movehl_ps(e3, e2), 1);
+            __m128 w = _mm_loadu_ps(data_weight + j);
+            __m256 v_w = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_unpacklo_ps(w, w)), _mm_unpackhi_ps(w, w), 1);
+            v_h = _mm256_add_ps(v_h, _mm256_mul_ps(v_w, v_dh));
+            _mm256_store_ps(reinterpret_cast<float*>(equalized), equalize_cell(v_cell, v_h, v_csi_scale, v_csi));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(csi), v_csi);
+            for(int n = 0; n < 4; ++n){
+                _deinterleaver->write_cell(h[j + n], equalized[n], static_cast<uint8_t>(csi[2 * n]));
+                if(show) show[j + n] = equalized[n];
+            }
+        }
+        for(; j < len_data; ++j){
+            const channel_t &e = channel[data_pilot[j]];
+            complex est_cell = e.h + data_weight[j] * e.dh;
+            float norm = std::norm(est_cell);
+            complex cell = ofdm_cell[data[j]] * std::conj(est_cell) / norm;
+            _deinterleaver->write_cell(h[j], cell, channel_state(norm, csi_scale));
+            if(show) show[j] = cell;
+        }
+        _deinterleaver->end_symbol();
+        if(show) {
+            constelation_buffer.publish(show, c_data);
+            emit replace_constelation(&constelation_buffer);
         }
     }
 
@@ -302,18 +439,53 @@ void data_symbol::execute(int _idx_symbol, complex* _ofdm_cell,
 
     _phase_offset = (ph_2 + ph_1);
 
-    _sample_rate_offset = (sum_angle_2 - sum_angle_1)/(n_data*amp_est*amp_est);
+    _sample_rate_offset = (sum_angle_2 - sum_angle_1)/(n_data * std::norm(channel[len_pilot - 1].h));
+    std::swap(channel, channel_prev);
 
-    if(idx_symbol == n_p2) {
-        int len = c_data;
-        if(enabled_display)
-        {
-            memcpy(&show_symbol[0], _ofdm_cell, sizeof(complex) * static_cast<unsigned long>(fft_size));
-            memcpy(&show_data[0], deinterleaved_cell, sizeof(complex) * static_cast<unsigned long>(len));
-            emit replace_spectrograph(fft_size, &show_symbol[0]);
-            emit replace_constelation(len, &show_data[0]);
+}
+//-------------------------------------------------------------------------------------------
+void data_symbol::equalize_delayed(int _seq, time_deinterleaver* _deinterleaver)
+{
+    const int slot = _seq % (delay + 1);
+    const delayed_symbol &d = delayed[slot];
+    const carrier_list &list = pattern[d.idx_pattern];
+    const complex* cell = &delayed_cell[slot * len_delayed_cell];
+    int* h;
+    if(d.idx_symbol % 2 == 0) h = h_odd_data;
+    else h = h_even_data;
+    complex* show = d.show ? &show_data[0] : nullptr;
+    interpolate_time(_seq);
+    interpolate_grid();
+    _deinterleaver->begin_symbol(c_data);
+    const int len_data = static_cast<int>(list.data.size());
+    const int* data_poly = list.data_poly.data();
+    const complex* est = channel_poly.data();
+    alignas(32) complex equalized[4];
+    alignas(32) int csi[8];
+    const __m256 v_csi_scale = _mm256_set1_ps(d.csi_scale);
+    __m256i v_csi;
+    int j = 0;
+    for(; j + 4 <= len_data; j += 4){
+        __m256 v_cell = _mm256_loadu_ps(reinterpret_cast<const float*>(cell + j));
+        __m256 v_h = load_cell(est, data_poly + j);
+        _mm256_store_ps(reinterpret_cast<float*>(equalized), equalize_cell(v_cell, v_h, v_csi_scale, v_csi));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(csi), v_csi);
+        for(int n = 0; n < 4; ++n){
+            _deinterleaver->write_cell(h[j + n], equalized[n], static_cast<uint8_t>(csi[2 * n]));
+            if(show) show[j + n] = equalized[n];
         }
     }
-
+    for(; j < len_data; ++j){
+        const complex &est_cell = est[data_poly[j]];
+        float norm = std::norm(est_cell);
+        complex c = cell[j] * std::conj(est_cell) / norm;
+        _deinterleaver->write_cell(h[j], c, channel_state(norm, d.csi_scale));
+        if(show) show[j] = c;
+    }
+    _deinterleaver->end_symbol();
+    if(show) {
+        constelation_buffer.publish(show, c_data);
+        emit replace_constelation(&constelation_buffer);
+    }
 }
 //-------------------------------------------------------------------------------------------
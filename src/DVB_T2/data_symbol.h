@@ -19,8 +19,10 @@
 #include <vector>
 
 #include "dvbt2_definition.h"
+#include "display_buffer.h"
 #include "pilot_generator.h"
 #include "address_freq_deinterleaver.h"
+#include "time_deinterleaver.h"
 
 class data_symbol : public QObject
 {
@@ -30,18 +32,22 @@ public:
     ~data_symbol();
 
     void execute(int _idx_symbol, complex* _ofdm_cell,
-                     float &_sample_rate_offset, float &_phase_offset, std::vector<complex> &out);
+                     float &_sample_rate_offset, float &_phase_offset, time_deinterleaver* _deinterleaver);
     void init(dvbt2_parameters &_dvbt2, pilot_generator* _pilot,
               address_freq_deinterleaver* _address);
     void enable_display(bool mode)
     {
         enabled_display = mode;
     }
+    void enable_channel_2d(bool mode)
+    {
+        enabled_channel_2d = mode;
+    }
 
 signals:
-    void replace_spectrograph(const int _len_data, complex* _data);
-    void replace_constelation(const int _len_data, complex* _data);
-    void replace_oscilloscope(const int _len_data, complex* _data);
+    void replace_spectrograph(display_buffer* _buffer);
+    void replace_constelation(display_buffer* _buffer);
+    void replace_oscilloscope(display_buffer* _buffer);
 
 private:
     pilot_generator* pilot;
@@ -54,19 +60,80 @@ private:
     int half_total;
     int n_p2;
     int left_nulls;
-    std::vector<std::vector<int>> data_carrier_map;
-    std::vector<std::vector<float>> data_pilot_refer;
-    float amp_cp;
-    float amp_sp;
-    float cor_amp_cp;
+    // carriers of one symbol of the scattered pilot pattern, in ascending order;
+    // pilot and data end up as bins of the spectrum in natural (not fftshifted) order
+    struct carrier_list{
+        std::vector<int> pilot;
+        std::vector<float> pilot_refer;     // reference without the pn sign of the symbol
+        int pilot_end_1;                    // pilots below the centre carrier
+        int pilot_begin_2;                  // first pilot above the centre carrier
+        std::vector<int> data;
+        std::vector<int> data_pilot;        // nearest pilot on the left of the data carrier
+        std::vector<float> data_weight;     // distance to it over the distance between pilots
+        std::vector<int> grid_pilot;        // pilots on the dx carrier grid
+        std::vector<int> grid_index;        // and their grid points
+        std::vector<int> continual;         // pilots in every symbol, same carriers in every list
+        std::vector<int> data_poly;         // data carrier in channel_poly
+    };
+    std::vector<carrier_list> pattern{};
+    // channel at a pilot and the step to the next one
+    struct channel_t{
+        complex h;
+        complex dh;
+    };
+    std::vector<channel_t> channel{};
+    std::vector<channel_t> channel_prev{};
+    void carrier_list_generator(const std::vector<int8_t> &_map, carrier_list &_list);
+    void continual_pilot_generator();
+    void fft_bin_generator(carrier_list &_list);
+    // time/frequency estimation: the pilots of every dx carrier interpolated linearly in time
+    // between the symbols that carry them, then a Wiener interpolator over len_wiener grid
+    // points in frequency. A symbol is equalized delay symbols after it is received, the rest
+    // of the frame at its last data symbol; the pilot history goes on from frame to frame.
+    bool enabled_channel_2d = false;
+    int last_idx_symbol = -2;
+    int last_pattern = 0;
+    int end_data_symbol;                        // after the last data symbol of the frame
+    int frame_gap;                              // symbols from it to the first of the next frame
+    int channel_step;
+    int len_grid;
+    int stride_poly;
+    constexpr static int len_wiener = 4;
+    constexpr static int wiener_pad = 1;
+    std::vector<float> wiener{};
+    std::vector<complex> grid{};
+    std::vector<complex> channel_poly{};        // channel_step rows of the carriers m * dx + row
+    int delay;                                  // dy - 1
+    int len_history;                            // rows, 2 * dy
+    std::vector<complex> history{};             // grid pilots of a symbol, the common phase removed
+    std::vector<uint8_t> history_valid{};
+    std::vector<int> history_time{};            // in symbols
+    struct delayed_symbol{
+        int idx_symbol;
+        int idx_pattern;
+        float csi_scale;
+        complex common;                         // common phase rotation of the symbol
+        bool show;
+    };
+    std::vector<delayed_symbol> delayed{};      // delay + 1 slots
+    std::vector<complex> delayed_cell{};        // their data cells, len_delayed_cell each
+    int len_delayed_cell;
+    int seq_in = 0;                             // symbols stored since the reset
+    int seq_out = 0;                            // and equalized
+    int time_symbol = 0;
+    float common_phase = 0.0f;
+    void wiener_generator(float _spread);
+    void reset_history();
+    void store_history(const carrier_list &_list);
+    void interpolate_time(int _seq);
+    void interpolate_grid();
+    void equalize_delayed(int _seq, time_deinterleaver* _deinterleaver);
     int* h_even_data;
     int* h_odd_data;
-    std::vector<complex> buffer_cell{};        // max(dx) x max(dy) x 2 for scaterred pilot pattern
     std::vector<complex> prev_pilot{};
-    bool swap_buffer = false;
-    std::vector<complex> est_show{};
-    std::vector<complex> show_symbol{};
     std::vector<complex> show_data{};
+    display_buffer spectrograph_buffer{display_buffer::spectrum_len, display_buffer::peak};
+    display_buffer constelation_buffer{display_buffer::constelation_len};
     bool enabled_display = false;
 };
 
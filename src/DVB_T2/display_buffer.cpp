@@ -0,0 +1,109 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "display_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+std::atomic<int> display_buffer::frame_rate{25};
+
+//-------------------------------------------------------------------------------------------
+display_buffer::display_buffer(int _max_len, decimation _mode) :
+    max_len(_max_len),
+    mode(_mode)
+{
+
+}
+//-------------------------------------------------------------------------------------------
+display_buffer::~display_buffer()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+void display_buffer::set_fps(int _fps)
+{
+    frame_rate.store(std::max(_fps, 1), std::memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------
+int display_buffer::fps()
+{
+    return frame_rate.load(std::memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------
+bool display_buffer::due()
+{
+    const int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    if(now < time_due) return false;
+
+    const int64_t period = 1000000 / fps();
+    // a late frame does not make the next one early
+    time_due = std::max(time_due + period, now);
+
+    return true;
+
+}
+//-------------------------------------------------------------------------------------------
+void display_buffer::publish(const complex* _data, int _len, int _shift)
+{
+    const int step = max_len > 0 && _len > max_len ? (_len + max_len - 1) / max_len : 1;
+    const int n = _len / step;
+    std::vector<complex> &out = buffer[back];
+    if(out.size() < static_cast<size_t>(n)) out.resize(static_cast<size_t>(n));
+    int idx = _shift % std::max(_len, 1);
+    if(step == 1) {
+        const int n_first = _len - idx;
+        std::copy(_data + idx, _data + _len, out.begin());
+        std::copy(_data, _data + idx, out.begin() + n_first);
+    }
+    else if(mode == peak) {
+        for(int i = 0; i < n; ++i) {
+            complex max = _data[idx];
+            float norm_max = std::norm(max);
+            for(int k = 0; k < step; ++k) {
+                const float nrm = std::norm(_data[idx]);
+                if(nrm > norm_max) {
+                    norm_max = nrm;
+                    max = _data[idx];
+                }
+                if(++idx == _len) idx = 0;
+            }
+            out[static_cast<size_t>(i)] = max;
+        }
+    }
+    else {
+        for(int i = 0; i < n; ++i) {
+            out[static_cast<size_t>(i)] = _data[idx];
+            idx += step;
+            if(idx >= _len) idx -= _len;
+        }
+    }
+    len[back] = n;
+    len_source[back] = _len;
+    back = middle.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+}
+//-------------------------------------------------------------------------------------------
+const complex* display_buffer::acquire(int &_len, int &_len_source)
+{
+    if(!(middle.load(std::memory_order_relaxed) & fresh)) return nullptr;
+
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+    _len = len[front];
+    _len_source = len_source[front];
+
+    return buffer[front].data();
+
+}
+//-------------------------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef DISPLAY_BUFFER_H
+#define DISPLAY_BUFFER_H
+
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+typedef std::complex<float> complex;
+
+// Snapshot of a display from one producer thread to the GUI. A triple buffer: the producer
+// fills its back buffer and swaps it with the middle one, the GUI swaps its front buffer
+// with the middle one when there is a newer snapshot. No one waits and no buffer is read
+// while written. The producer asks due() first and copies nothing between frames.
+class display_buffer
+{
+public:
+    enum decimation{
+        stride = 0,     // every n-th point: constellations, curves
+        peak,           // strongest of every n points: spectra
+    };
+    constexpr static int spectrum_len = 4096;
+    constexpr static int constelation_len = 8192;
+    constexpr static int curve_len = 4096;
+    // _max_len: points of a snapshot at most, 0 keeps all
+    explicit display_buffer(int _max_len = 0, decimation _mode = stride);
+    ~display_buffer();
+
+    // producer: true once per frame of the display rate
+    bool due();
+    // producer: snapshot of _data rotated by _shift, out[i] = _data[(i + _shift) % _len]
+    void publish(const complex* _data, int _len, int _shift = 0);
+    // GUI: the newest snapshot, nullptr when there is none since the last one taken.
+    // _len_source: length of the data before the decimation
+    const complex* acquire(int &_len, int &_len_source);
+
+    // frames per second of all displays
+    static void set_fps(int _fps);
+    static int fps();
+
+private:
+    constexpr static int fresh = 4;
+    std::vector<complex> buffer[3];
+    int len[3] = {0, 0, 0};
+    int len_source[3] = {0, 0, 0};
+    int back = 0;
+    int front = 1;
+    std::atomic<int> middle{2};
+    int max_len;
+    decimation mode;
+    int64_t time_due = 0;
+
+    static std::atomic<int> frame_rate;
+};
+
+#endif // DISPLAY_BUFFER_H
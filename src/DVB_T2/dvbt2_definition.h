@@ -45,6 +45,8 @@ const int SIZEOF_SIMD = 16;
 #define SYMBOL_TYPE_P2      1
 #define SYMBOL_TYPE_DATA    2
 #define SYMBOL_TYPE_FC      3
+#define SYMBOL_TYPE_GI      4                           //symbols after the first P1 buffered
+                                                        //for the guard interval detection
 
 #define CHIPS               2624
 #define MAX_ACTIVE_CARRIERS 27841
@@ -57,6 +59,7 @@ const int SIZEOF_SIMD = 16;
 #define NORM_FACTOR_QAM16   0.316227766f
 #define NORM_FACTOR_QAM64   0.15430335f
 #define NORM_FACTOR_QAM256  0.076696499f
+#define CSI_UNITY           64                          // channel state weight of a cell at the mean channel power
 // LDPC Code
 #define FEC_SIZE_NORMAL 64800
 #define FEC_SIZE_SHORT  16200
@@ -348,8 +351,10 @@ struct l1_postsignalling{
     l1_postsignalling_dynamic dyn;
     l1_postsignalling_dynamic dyn_next;
 };
+Q_DECLARE_METATYPE(l1_presignalling)
 Q_DECLARE_METATYPE(l1_postsignalling)
-typedef std::array<int8_t,FEC_SIZE_NORMAL * SIZEOF_SIMD> fec_frame;
+// soft bits of SIZEOF_SIMD FEC blocks interleaved by lane: bit i of block k at i * SIZEOF_SIMD + k
+struct alignas(SIZEOF_SIMD) fec_frame : std::array<int8_t,FEC_SIZE_NORMAL * SIZEOF_SIMD>{};
 typedef std::array<int,SIZEOF_SIMD> idx_plp_simd_t;
 
 Q_DECLARE_METATYPE(fec_frame)
@@ -18,6 +18,9 @@
 #include <immintrin.h>
 
 #include "DSP/fast_math.h"
+#include "acquisition_timeline.h"
+#include "receiver_metrics.h"
+#include "stage_tracer.h"
 
 #define EN_DUMP 0
 
@@ -59,28 +62,14 @@ dvbt2_demodulator::dvbt2_demodulator(id_device_t _id_device, float _sample_rate,
     min_resample = resample - resample * 1.0e-4;// for 100ppm
     uint len_max = (max_len_symbol + P1_LEN) * max_resample * upsample;
 
-    out_interpolator = static_cast<complex*>(_mm_malloc(sizeof(complex) * len_max * upsample * (1.+1e-4), 32));
-    out_decimator.resize(len_max);
-    out_derotate_sample.resize(len_max);
+    out_resampler.resize(len_max);
+    resampler.init(resample);
     buffer_sym.resize(max_len_symbol);
     for(uint i = 0; i < max_len_symbol; ++i) {
         buffer_sym[i] = {0.0f, 0.0f};
     }
-    //time deinterleaver and removal of cyclic Q-delay
-    mutex_out = new QMutex;
-    signal_out = new QWaitCondition;
-    deinterleaver = new time_deinterleaver(signal_out, mutex_out);
-    thread = new QThread;
-    thread->setObjectName("time_deint");
-    deinterleaver->moveToThread(thread);
-    connect(this, &dvbt2_demodulator::data, deinterleaver, &time_deinterleaver::execute);
-    connect(this, &dvbt2_demodulator::l1_dyn_execute, deinterleaver, &time_deinterleaver::l1_dyn_execute);
-    connect(this, &dvbt2_demodulator::stop_deinterleaver, deinterleaver, &time_deinterleaver::stop);
-    connect(deinterleaver, &time_deinterleaver::finished, deinterleaver, &time_deinterleaver::deleteLater);
-    connect(deinterleaver, &time_deinterleaver::finished, thread, &QThread::quit, Qt::DirectConnection);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-//    thread->start(QThread::TimeCriticalPriority);
-    thread->start();
+    //time deinterleaver and removal of cyclic Q-delay, driven from this thread
+    deinterleaver = new time_deinterleaver(this);
     
     #if EN_DUMP
     dump0 = new file_sink(698000000,SAMPLE_RATE);
@@ -88,7 +77,7 @@ dvbt2_demodulator::dvbt2_demodulator(id_device_t _id_device, float _sample_rate,
     thread2->setObjectName("dump0");
     dump0->moveToThread(thread2);
     connect(this, &dvbt2_demodulator::dump, dump0, &file_sink::execute);
-    connect(this, &dvbt2_demodulator::stop_deinterleaver, dump0, &file_sink::stop);
+    connect(this, &dvbt2_demodulator::stop_dump, dump0, &file_sink::stop);
     connect(dump0, &file_sink::finished, dump0, &file_sink::deleteLater);
     connect(dump0, &file_sink::finished, thread2, &QThread::quit, Qt::DirectConnection);
     connect(thread2, &QThread::finished, thread2, &QThread::deleteLater);
@@ -99,11 +88,11 @@ dvbt2_demodulator::dvbt2_demodulator(id_device_t _id_device, float _sample_rate,
 }
 //-------------------------------------------------------------------------------------------
 dvbt2_demodulator::~dvbt2_demodulator()
-{   
-    deinterleaver->fifo.reset();
-    emit stop_deinterleaver();
-    if(thread->isRunning()) thread->wait(1000);
-    _mm_free (out_interpolator);
+{
+    // the time deinterleaver is a child, deleted with the demodulator
+#if EN_DUMP
+    emit stop_dump();
+#endif
 }
 //-------------------------------------------------------------------------------------------
 void dvbt2_demodulator::reset()
@@ -117,7 +106,9 @@ void dvbt2_demodulator::reset()
     p2_init = false;
     demodulator_init = false;
     next_symbol_type = SYMBOL_TYPE_P1;
-    deinterleaver->fifo.reset();
+    guard_interval_found = false;
+    batch_left = 0;
+    l1_bad = 0;
     qDebug() << "dvbt2_demodulator reset";
 }
 //-------------------------------------------------------------------------------------------
@@ -126,7 +117,6 @@ void dvbt2_demodulator::init_dvbt2()
     dvbt2.bandwidth = BANDWIDTH_8_0_MHZ;
     dvbt2.miso_group = MISO_TX1;//?
     dvbt2_p2_parameters_init(dvbt2);
-    in_fft = fft.init(dvbt2.fft_size);
     fq_deinterleaver.init(dvbt2);
     p2_demodulator.init(dvbt2, &pilot, &fq_deinterleaver);
     // for start;
@@ -140,6 +130,8 @@ void dvbt2_demodulator::init_dvbt2()
 void dvbt2_demodulator::execute(int _len_in, complex* _in, float _level_estimate, signal_estimate *signal_)
 {
     mutex->lock();
+    TRACE_SCOPE(TRACE_DEMODULATOR, trace_item);
+    ++trace_item;
 
     int len_in = _len_in;
     int idx_in = 0;
@@ -162,31 +154,20 @@ void dvbt2_demodulator::execute(int _len_in, complex* _in, float _level_estimate
         remain = len_in - idx_in;
         if(chunk > remain) chunk = remain;
 
+        //___phase, frequency and timing synchronization___
         loc_nco *= std::polar(1.f,-phase_est_filtered);
         const complex incr = std::polar(1.f,-(frequency_est_filtered + frequency_est_coarse));
-        for(int i = 0; i < chunk; ++i) {
-            //___phase and frequency synchronization___
-            loc_nco *= incr;
-            out_derotate_sample[i]=_in[i+idx_in]*loc_nco;
-            //_____________________________
-        }  
-
-        loc_nco /= std::abs(loc_nco);
+        int len_out_resampler;
+        resampler.execute(chunk, &_in[idx_in], loc_nco, incr, arbitrary_resample * upsample,
+                          len_out_resampler, &out_resampler[0]);
 
         idx_in += chunk;
-
-        //___timing synchronization___
-        int len_out_interpolator;
-        interpolator(chunk, &out_derotate_sample[0], arbitrary_resample,
-                     len_out_interpolator, &out_interpolator[0]);
-        int len_out_decimator;
-        decimator.execute(len_out_interpolator, &out_interpolator[0], len_out_decimator, &out_decimator[0]);
 #if EN_DUMP
         if(deint_start)
-        emit dump(out_decimator,len_out_decimator);
+        emit dump(out_resampler,len_out_resampler);
 #endif
         //___demodulations and get offset synchronization__
-        symbol_acquisition(len_out_decimator, &out_decimator[0], signal_);
+        symbol_acquisition(len_out_resampler, &out_resampler[0], signal_);
 
     }
     nco = loc_nco;
@@ -214,12 +195,21 @@ void dvbt2_demodulator::symbol_acquisition(int _len_in, complex* _in, signal_est
                                  &buffer_sym[0], idx_buffer_sym, dvbt2, signal_->coarse_freq_offset,
                                  p1_decoded, signal_->p1_reset)) {
                 if(p2_init){
-                    next_symbol_type = SYMBOL_TYPE_P2;
+                    if(demodulator_init || guard_interval_found) {
+                        next_symbol_type = SYMBOL_TYPE_P2;
+                    }
+                    else {
+                        next_symbol_type = SYMBOL_TYPE_GI;
+                        gi_detector.init(dvbt2, idx_buffer_sym, &buffer_sym[0]);
+                        idx_buffer_sym = 0;
+                        est_chunk = gi_detector.remain();
+                    }
                 }
                 else{
                     resample -= signal_->correct_resample * resample;
                     if(std::abs(signal_->coarse_freq_offset) < 10.0f){
                         if(p1_decoded){
+                            acquisition_timeline::instance().mark(ACQUISITION_COARSE_FREQUENCY);
                             if(!signal_->p1_reset){
                                 init_dvbt2();
                             }
@@ -240,50 +230,82 @@ void dvbt2_demodulator::symbol_acquisition(int _len_in, complex* _in, signal_est
             continue;
 
         }
-        //__Fast Fourier Transform_________________________________
-        uint len_in_sym = len_in - consume;
-        uint len_out_sym = symbol_size - idx_buffer_sym;
-        uint len_cpy_sym = len_out_sym > len_in_sym ? len_in_sym : len_out_sym;
-        memcpy(&buffer_sym[idx_buffer_sym], in + consume, sizeof(complex) * len_cpy_sym);
-        consume += len_cpy_sym;
-        idx_buffer_sym += len_cpy_sym;
-        if(idx_buffer_sym == symbol_size) {
-            idx_buffer_sym = 0;
-            if(crc32_l1_pre) {
-                complex* cp = &buffer_sym[dvbt2.fft_size];
-                complex sum = {0.0f, 0.0f};
-                for (int i = 4; i < dvbt2.guard_interval_size - 4; ++i){
-                    sum += (cp[i] * conj(buffer_sym[i]));
-                }
-                frequency_est = atan2_approx(sum.imag(), sum.real()) / (dvbt2.fft_size << 1);
-                float max_integral = 1.0f / dvbt2.fft_size;
-                frequency_est_filtered += loop_filter_frequency_offset(frequency_est, max_integral);
+        if(next_symbol_type == SYMBOL_TYPE_GI) {
+            if(!gi_detector.execute(len_in, in, consume, dvbt2)) {
+                est_chunk = gi_detector.remain();
+
+                continue;
+
             }
+            set_guard_interval();
+            guard_interval_found = true;
+            acquisition_timeline::instance().mark(ACQUISITION_GUARD_INTERVAL);
+            next_symbol_type = SYMBOL_TYPE_P2;
+            // from the P2 on, the buffered symbols as if just received
+            symbol_acquisition(gi_detector.size(), gi_detector.data(), signal_);
 
-            memcpy(in_fft, &buffer_sym[dvbt2.guard_interval_size],
-                   sizeof(complex) * static_cast<uint>(dvbt2.fft_size));
-            ofdm_cell = fft.execute();
+            continue;
 
-            est_chunk = 0;
+        }
+        //__Fast Fourier Transform_________________________________
+        // The symbol is transformed where it lies: in the input when it is there whole,
+        // several symbols at once when the rest of the frame is there too.
+        const complex* sym;
+        if(batch_left > 0) {
+            sym = in + consume;
+            consume += symbol_size;
+            --batch_left;
+            ofdm_cell += dvbt2.fft_size;
+        }
+        else if(idx_buffer_sym == 0 && len_in - consume >= symbol_size) {
+            int n = 1;
+            if(next_symbol_type == SYMBOL_TYPE_DATA) {
+                int left = end_data_symbol - idx_symbol + (frame_closing_symbol ? 1 : 0);
+                if(left >= fast_fourier_transform::batch_max &&
+                   len_in - consume >= symbol_size * fast_fourier_transform::batch_max) {
+                    n = fast_fourier_transform::batch_max;
+                }
+            }
+            sym = in + consume;
+            consume += symbol_size;
+            batch_left = n - 1;
+            fft.init_symbol(dvbt2.fft_size, symbol_size);
+            ofdm_cell = fft.execute_symbol(n, sym + dvbt2.guard_interval_size);
         }
         else {
-            est_chunk = symbol_size - idx_buffer_sym;
+            uint len_in_sym = len_in - consume;
+            uint len_out_sym = symbol_size - idx_buffer_sym;
+            uint len_cpy_sym = len_out_sym > len_in_sym ? len_in_sym : len_out_sym;
+            memcpy(&buffer_sym[idx_buffer_sym], in + consume, sizeof(complex) * len_cpy_sym);
+            consume += len_cpy_sym;
+            idx_buffer_sym += len_cpy_sym;
+            if(idx_buffer_sym < symbol_size) {
+                est_chunk = symbol_size - idx_buffer_sym;
 
-            continue;
+                continue;
 
+            }
+            idx_buffer_sym = 0;
+            sym = &buffer_sym[0];
+            fft.init_symbol(dvbt2.fft_size, symbol_size);
+            ofdm_cell = fft.execute_symbol(1, sym + dvbt2.guard_interval_size);
         }
+        receiver_metrics::instance().add(METRIC_SYMBOLS);
+        if(crc32_l1_pre) {
+            const complex* cp = &sym[dvbt2.fft_size];
+            complex sum = {0.0f, 0.0f};
+            for (int i = 4; i < dvbt2.guard_interval_size - 4; ++i){
+                sum += (cp[i] * conj(sym[i]));
+            }
+            frequency_est = atan2_approx(sum.imag(), sum.real()) / (dvbt2.fft_size << 1);
+            float max_integral = 1.0f / dvbt2.fft_size;
+            frequency_est_filtered += loop_filter_frequency_offset(frequency_est, max_integral);
+        }
+        est_chunk = 0;
         //________________________________________________________
         if(next_symbol_type == SYMBOL_TYPE_DATA) {
             if(deint_start) {
-                mutex_out->lock();
-                std::vector<complex> tmp;
-                deinterleaver->fifo.take(tmp);
-                mutex_out->unlock();
-                data_demodulator.execute(idx_symbol, ofdm_cell, sample_rate_est, phase_est,tmp);
-                mutex_out->lock();
-                deinterleaver->fifo.push(tmp);
-                mutex_out->unlock();
-                emit data();
+                data_demodulator.execute(idx_symbol, ofdm_cell, sample_rate_est, phase_est, deinterleaver);
 
                 phase_est_filtered = loop_filter_phase_offset(phase_est * 0.5f, M_PIf32 * 2);
                 constexpr double sr_est_bw = 1.0e-10;
@@ -294,60 +316,53 @@ void dvbt2_demodulator::symbol_acquisition(int _len_in, complex* _in, signal_est
             }
             ++idx_symbol;
             if(idx_symbol == end_data_symbol) {
-                if(frame_closing_symbol) next_symbol_type = SYMBOL_TYPE_FC;
-                else next_symbol_type = SYMBOL_TYPE_P1;
+                if(frame_closing_symbol) {
+                    next_symbol_type = SYMBOL_TYPE_FC;
+                }
+                else {
+                    next_symbol_type = SYMBOL_TYPE_P1;
+                    p1_demodulator.set_expected();
+                }
             }
         }
         else if(next_symbol_type == SYMBOL_TYPE_FC) {
             if(deint_start) {
-                mutex_out->lock();
-                std::vector<complex> tmp;
-                deinterleaver->fifo.take(tmp);
-                mutex_out->unlock();
-                fc_demod.execute(ofdm_cell, sample_rate_est, phase_est,tmp);
-                mutex_out->lock();
-                deinterleaver->fifo.push(tmp);
-                mutex_out->unlock();
-                emit data();
+                fc_demod.execute(ofdm_cell, sample_rate_est, phase_est, deinterleaver);
             }
             next_symbol_type = SYMBOL_TYPE_P1;
+            p1_demodulator.set_expected();
         }
         else if(next_symbol_type == SYMBOL_TYPE_P2) {
             idx_symbol = 0;
             bool crc32_l1_post = false;
-            mutex_out->lock();
-            std::vector<complex> tmp;
-            deinterleaver->fifo.take(tmp);
-            mutex_out->unlock();
             p2_demodulator.execute(dvbt2, demodulator_init, idx_symbol, ofdm_cell,
                                                             l1_pre, l1_post, crc32_l1_pre, crc32_l1_post,
-                                                            sample_rate_est, phase_est, tmp);
+                                                            sample_rate_est, phase_est, p2_cell);
+            receiver_metrics &metrics = receiver_metrics::instance();
+            metrics.add(METRIC_T2_FRAMES);
+            if(!crc32_l1_pre || !crc32_l1_post) metrics.add(METRIC_L1_ERRORS);
+            if(crc32_l1_pre && crc32_l1_post) {
+                l1_bad = 0;
+            }
+            else if(deint_start && demodulator_init && l1_bad < l1_bad_max) {
+                // the configuration rarely changes: keep the data flowing on the last good L1
+                ++l1_bad;
+                predict_l1_dynamic();
+                crc32_l1_pre = true;
+                crc32_l1_post = true;
+            }
             if(crc32_l1_pre) {
                 if(demodulator_init) {
                     if(crc32_l1_post) {
                         if(deint_start) {
-                            mutex_out->lock();
-                            deinterleaver->fifo.push(tmp);
-                            mutex_out->unlock();
-                            emit l1_dyn_execute(l1_post);
+                            deinterleaver->l1_dyn_execute(l1_post, static_cast<int>(p2_cell.size()), p2_cell.data());
                         }
                         else {
                             deinterleaver->start(dvbt2, l1_pre, l1_post);
                             deint_start = true;
-                            mutex_out->lock();
-                            deinterleaver->fifo.push(tmp);
-                            mutex_out->unlock();
-                            emit l1_dyn_execute(l1_post);
+                            deinterleaver->l1_dyn_execute(l1_post, static_cast<int>(p2_cell.size()), p2_cell.data());
                             emit amount_plp(l1_post.num_plp);
                         }
-//                        mutex_out->lock();
-//                        emit l1_dyn_execute(l1_post, dvbt2.c_p2, deinterleaved_cell);
-//                        signal_out->wait(mutex_out);
-//                        mutex_out->unlock();
-                    }else{
-                        mutex_out->lock();
-                        deinterleaver->fifo.release(tmp);
-                        mutex_out->unlock();
                     }
                     ++idx_symbol;
                     next_symbol_type = SYMBOL_TYPE_DATA;
@@ -365,20 +380,16 @@ void dvbt2_demodulator::symbol_acquisition(int _len_in, complex* _in, signal_est
                     }
                     demodulator_init = true;
                     next_symbol_type = SYMBOL_TYPE_P1;
-                    mutex_out->lock();
-                    deinterleaver->fifo.release(tmp);
-                    mutex_out->unlock();
 
                     continue;
 
                 }
             }
             else {
-                mutex_out->lock();
-                deinterleaver->fifo.release(tmp);
-                mutex_out->unlock();
                 if(!demodulator_init) {
-                    set_guard_interval_by_brute_force();
+                    // detect again in the next frame
+                    guard_interval_found = false;
+                    frequency_est_filtered = 0.0f;
                     next_symbol_type = SYMBOL_TYPE_P1;
 
                     continue;
@@ -407,6 +418,15 @@ void dvbt2_demodulator::symbol_acquisition(int _len_in, complex* _in, signal_est
 
 }
 //----------------------------------------------------------------------------------------------
+// The dynamic L1 of the frame after the last good one: the next frame index, the PLPs
+// where they were.
+void dvbt2_demodulator::predict_l1_dynamic()
+{
+    l1_postsignalling_dynamic &dyn = l1_post.dyn;
+    ++dyn.frame_idx;
+    if(dyn.frame_idx >= l1_pre.num_t2_frames) dyn.frame_idx = 0;
+}
+//----------------------------------------------------------------------------------------------
 void dvbt2_demodulator::set_guard_interval()
 {
     switch (dvbt2.guard_interval_mode) {
@@ -438,71 +458,6 @@ void dvbt2_demodulator::set_guard_interval()
     est_chunk = symbol_size;
 }
 //-------------------------------------------------------------------------------------------
-void dvbt2_demodulator::set_guard_interval_by_brute_force ()
-{
-    static int idx = 0;
-    static int c = 0;
-    int num = 5;
-    if(c == 0) {
-        frequency_est_filtered = 0.0f;
-    }
-    switch (idx) {
-    case 0:
-        dvbt2.guard_interval_size = dvbt2.fft_size / 32;
-        if(c++ > num){
-            ++idx;
-            c = 0;
-        }
-        break;
-    case 1:
-        dvbt2.guard_interval_size = dvbt2.fft_size / 16;
-        if(c++ > num){
-            ++idx;
-            c = 0;
-        }
-        break;
-    case 2:
-        dvbt2.guard_interval_size = dvbt2.fft_size / 8;
-        if(c++ > num){
-            ++idx;
-            c = 0;
-        }
-        break;
-    case 3:
-        dvbt2.guard_interval_size = dvbt2.fft_size / 4;
-        if(c++ > num){
-            ++idx;
-            c = 0;
-        }
-        break;
-    case 4:
-        dvbt2.guard_interval_size = dvbt2.fft_size / 128;
-        if(c++ > num){
-            ++idx;
-            c = 0;
-        }
-        break;
-    case 5:
-        dvbt2.guard_interval_size = (dvbt2.fft_size / 128) * 19;
-        if(c++ > num){
-            ++idx;
-            c = 0;
-        }
-        break;
-    case 6:
-        dvbt2.guard_interval_size = (dvbt2.fft_size / 256) * 19;
-        if(c++ > num){
-            idx = 0;
-            c = 0;
-        }
-        break;
-    default:
-        break;
-    }
-    symbol_size = dvbt2.fft_size + dvbt2.guard_interval_size;
-    est_chunk = symbol_size;
-}
-//-------------------------------------------------------------------------------------------
 void dvbt2_demodulator::stop()
 {
     emit finished();
@@ -510,6 +465,21 @@ void dvbt2_demodulator::stop()
 //-------------------------------------------------------------------------------------------
 void dvbt2_demodulator::set_fir(int idx)
 {
-    decimator.set_filter(idx);
+    resampler.set_filter(idx);
+}
+//-------------------------------------------------------------------------------------------
+void dvbt2_demodulator::set_channel_2d(bool mode)
+{
+    data_demodulator.enable_channel_2d(mode);
+}
+//-------------------------------------------------------------------------------------------
+void dvbt2_demodulator::set_p1_search(int _khz)
+{
+    p1_demodulator.set_carrier_search(_khz * 1.0e+3f);
+}
+//-------------------------------------------------------------------------------------------
+void dvbt2_demodulator::set_l1_tolerance(int _frames)
+{
+    l1_bad_max = _frames < 0 ? 0 : _frames;
 }
 //-------------------------------------------------------------------------------------------
@@ -21,12 +21,12 @@
 #include <QMetaType>
 #include <vector>
 
-#include "DSP/interpolator_farrow.hh"
-#include "DSP/filter_decimator.h"
+#include "DSP/resampler_polyphase.hh"
 #include "DSP/fast_fourier_transform.h"
 #include "DSP/loop_filters.hh"
 #include "dvbt2_definition.h"
 #include "p1_symbol.h"
+#include "guard_interval_detector.h"
 #include "pilot_generator.h"
 #include "address_freq_deinterleaver.h"
 #include "p2_symbol.h"
@@ -56,6 +56,9 @@ struct signal_estimate{
     bool agc = false;
 };
 
+// Conversion of the device samples to complex, DC offset, spur and IQ imbalance removal.
+// Blocks of len_block samples: the estimators are held within a block and updated after it
+// as the per sample recurrences would (to first order in their small ratios).
 template<typename T> struct convert_iq
 {
     void init(int _convert_input, float _scale, float _max, float _min)
@@ -67,30 +70,12 @@ template<typename T> struct convert_iq
     }
     void execute(int idx_in, int _len_in, T* _i_in, T* _q_in, complex * out, float & level_detect, signal_estimate & signal_)
     {
-
-        int j = 0;
-        for(int i = 0; i < _len_in; ++i) {
-            j = (i + idx_in) * convert_input;
-            complex tmp;
-            if(std::is_same<T, float>())
-                tmp = complex(_i_in[j], _q_in[j]);
-            else
-                tmp = complex(_i_in[j] * short_to_float, _q_in[j] * short_to_float);
-            //___DC offset remove____________
-            tmp -= exp_avg_dc(tmp);
-            // remove spurs if any
-            if(anti_spur_en)
-            {
-                anti_spur *= anti_spur_inc;
-                anti_spur += (tmp - anti_spur) * anti_spur_alfa;
-                tmp -= anti_spur;
-            }
-            //___IQ imbalance remove_________
-            est_1_bit_quantization(tmp.real(), tmp.imag());
-            float real = tmp.real() * c2;
-            tmp = complex(real, tmp.imag() + c1 * real);
-            out[i]=tmp;
-            //_____________________________
+        const T* i_in = _i_in + idx_in * convert_input;
+        const T* q_in = _q_in + idx_in * convert_input;
+        for(int i = 0; i < _len_in; i += len_block) {
+            int len = std::min(len_block, _len_in - i);
+            load(len, i_in + i * convert_input, q_in + i * convert_input, out + i);
+            condition(len, out + i);
         }
         //___IQ imbalance estimations___
         c1 = -theta1 / theta2;
@@ -115,7 +100,7 @@ template<typename T> struct convert_iq
     }
     void reset()
     {
-        exp_avg_dc.reset();
+        dc = 0.0f;
     }
     void set_anti_spur(complex incr)
     {
@@ -129,8 +114,9 @@ template<typename T> struct convert_iq
 private:
     int convert_input = 1;
     float short_to_float = 1.0f/32768.0f;
+    static constexpr int len_block = 256;
     static constexpr float dc_ratio = 1.0e-6f;//1.0e-5f
-    exponential_averager<complex, float, dc_ratio> exp_avg_dc;
+    complex dc{};
     complex anti_spur{};
     complex anti_spur_inc{};
     static constexpr float anti_spur_alfa = 1.e-5f;
@@ -142,14 +128,157 @@ private:
     float level_min=0.2f;
     float theta1 = 0.0f, theta2 = 0.0f, theta3 = 0.0f;
     static constexpr float theta_alfa = dc_ratio * 25.;
-    inline void est_1_bit_quantization(float _real, float _imag)
+
+    // 8 interleaved I/Q values to float
+    inline __m256 to_float(__m128i _v) const
+    {
+        __m128i lo, hi;
+        if constexpr (std::is_same<T, int8_t>::value) {
+            lo = _mm_cvtepi8_epi32(_v);
+            hi = _mm_cvtepi8_epi32(_mm_srli_si128(_v, 4));
+        }
+        else {
+            lo = _mm_cvtepi16_epi32(_v);
+            hi = _mm_cvtepi16_epi32(_mm_srli_si128(_v, 8));
+        }
+        __m256 f = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+        return _mm256_mul_ps(f, _mm256_set1_ps(short_to_float));
+    }
+    // 4 samples, I and Q one after another in _i
+    inline __m256 load_interleaved(const T* _i) const
+    {
+        if constexpr (std::is_same<T, float>::value)
+            return _mm256_loadu_ps(_i);
+        else if constexpr (std::is_same<T, int8_t>::value)
+            return to_float(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(_i)));
+        else
+            return to_float(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_i)));
+    }
+    // 4 samples, I in _i and Q in _q
+    inline __m256 load_split(const T* _i, const T* _q) const
+    {
+        if constexpr (std::is_same<T, float>::value) {
+            __m128 i = _mm_loadu_ps(_i);
+            __m128 q = _mm_loadu_ps(_q);
+            return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_unpacklo_ps(i, q)), _mm_unpackhi_ps(i, q), 1);
+        }
+        else if constexpr (std::is_same<T, int8_t>::value) {
+            int i, q;
+            memcpy(&i, _i, sizeof(int));
+            memcpy(&q, _q, sizeof(int));
+            return to_float(_mm_unpacklo_epi8(_mm_cvtsi32_si128(i), _mm_cvtsi32_si128(q)));
+        }
+        else {
+            __m128i i = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(_i));
+            __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(_q));
+            return to_float(_mm_unpacklo_epi16(i, q));
+        }
+    }
+    void load(int _len, const T* _i_in, const T* _q_in, complex* _out) const
     {
-        float sgn;
-        sgn = _real < 0 ? -1.0f : 1.0f;
-        theta1 += (_imag * sgn - theta1)*theta_alfa;
-        theta2 += (_real * sgn - theta2)*theta_alfa;
-        sgn = _imag < 0 ? -1.0f : 1.0f;
-        theta3 += (_imag * sgn -theta3)*theta_alfa;
+        float* out = reinterpret_cast<float*>(_out);
+        int i = 0;
+        if(convert_input == 2 && _q_in == _i_in + 1) {
+            for(; i + 4 <= _len; i += 4) _mm256_storeu_ps(out + 2 * i, load_interleaved(_i_in + 2 * i));
+        }
+        else if(convert_input == 1) {
+            for(; i + 4 <= _len; i += 4) _mm256_storeu_ps(out + 2 * i, load_split(_i_in + i, _q_in + i));
+        }
+        for(; i < _len; ++i) {
+            int j = i * convert_input;
+            if(std::is_same<T, float>())
+                _out[i] = complex(_i_in[j], _q_in[j]);
+            else
+                _out[i] = complex(_i_in[j] * short_to_float, _q_in[j] * short_to_float);
+        }
+    }
+    static inline __m256 complex_mul(__m256 _a, __m256 _b)
+    {
+        __m256 a_swap = _mm256_permute_ps(_a, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_addsub_ps(_mm256_mul_ps(_a, _mm256_moveldup_ps(_b)),
+                                _mm256_mul_ps(a_swap, _mm256_movehdup_ps(_b)));
+    }
+    static inline complex sum(__m256 _v)
+    {
+        __m128 t = _mm_add_ps(_mm256_castps256_ps128(_v), _mm256_extractf128_ps(_v, 1));
+        t = _mm_add_ps(t, _mm_movehl_ps(t, t));
+        alignas(16) float f[4];
+        _mm_store_ps(f, t);
+        return {f[0], f[1]};
+    }
+    // in place
+    void condition(int _len, complex* _io)
+    {
+        float* io = reinterpret_cast<float*>(_io);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        const __m256 v_dc = _mm256_setr_ps(dc.real(), dc.imag(), dc.real(), dc.imag(),
+                                           dc.real(), dc.imag(), dc.real(), dc.imag());
+        const __m256 v_c2 = _mm256_setr_ps(c2, 1.0f, c2, 1.0f, c2, 1.0f, c2, 1.0f);
+        const __m256 v_c1 = _mm256_setr_ps(0.0f, c1, 0.0f, c1, 0.0f, c1, 0.0f, c1);
+        // spur of the block start rotated by anti_spur_inc per sample
+        const complex inc2 = anti_spur_inc * anti_spur_inc;
+        alignas(32) complex rotate[4] = {anti_spur_inc, inc2, inc2 * anti_spur_inc, inc2 * inc2};
+        __m256 v_rotate = _mm256_load_ps(reinterpret_cast<float*>(rotate));
+        const __m256 v_inc4 = _mm256_setr_ps(rotate[3].real(), rotate[3].imag(), rotate[3].real(), rotate[3].imag(),
+                                             rotate[3].real(), rotate[3].imag(), rotate[3].real(), rotate[3].imag());
+        const __m256 v_spur = _mm256_setr_ps(anti_spur.real(), anti_spur.imag(), anti_spur.real(), anti_spur.imag(),
+                                             anti_spur.real(), anti_spur.imag(), anti_spur.real(), anti_spur.imag());
+        __m256 sum_in = _mm256_setzero_ps();
+        __m256 sum_spur = _mm256_setzero_ps();
+        __m256 sum_abs = _mm256_setzero_ps();
+        __m256 sum_cross = _mm256_setzero_ps();
+        int i = 0;
+        for(; i + 4 <= _len; i += 4) {
+            __m256 x = _mm256_loadu_ps(io + 2 * i);
+            sum_in = _mm256_add_ps(sum_in, x);
+            //___DC offset remove____________
+            x = _mm256_sub_ps(x, v_dc);
+            // remove spurs if any
+            if(anti_spur_en) {
+                x = _mm256_sub_ps(x, complex_mul(v_spur, v_rotate));
+                // residual derotated to the block start
+                __m256 conj = _mm256_xor_ps(v_rotate, _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f));
+                sum_spur = _mm256_add_ps(sum_spur, complex_mul(x, conj));
+                v_rotate = complex_mul(v_rotate, v_inc4);
+            }
+            //___IQ imbalance remove_________
+            __m256 re = _mm256_moveldup_ps(x);
+            sum_abs = _mm256_add_ps(sum_abs, _mm256_andnot_ps(sign, x));
+            sum_cross = _mm256_add_ps(sum_cross, _mm256_xor_ps(x, _mm256_and_ps(re, sign)));
+            x = _mm256_add_ps(_mm256_mul_ps(x, v_c2), _mm256_mul_ps(re, v_c1));
+            _mm256_storeu_ps(io + 2 * i, x);
+        }
+        complex s_in = sum(sum_in);
+        complex s_spur = sum(sum_spur);
+        complex s_abs = sum(sum_abs);
+        complex s_cross = sum(sum_cross);
+        _mm256_store_ps(reinterpret_cast<float*>(rotate), v_rotate);
+        complex r = anti_spur_en && i > 0 ? rotate[0] / anti_spur_inc : complex(1.0f, 0.0f);
+        for(; i < _len; ++i) {
+            complex tmp = _io[i];
+            s_in += tmp;
+            tmp -= dc;
+            if(anti_spur_en) {
+                r *= anti_spur_inc;
+                tmp -= anti_spur * r;
+                s_spur += tmp * std::conj(r);
+            }
+            float sgn = tmp.real() < 0 ? -1.0f : 1.0f;
+            s_abs += complex(tmp.real() * sgn, std::abs(tmp.imag()));
+            s_cross += complex(0.0f, tmp.imag() * sgn);
+            float real = tmp.real() * c2;
+            _io[i] = complex(real, tmp.imag() + c1 * real);
+        }
+        //___estimators after the block___
+        float len = static_cast<float>(_len);
+        float k_dc = static_cast<float>(1.0 - std::pow(1.0 - dc_ratio, _len));
+        float k_theta = static_cast<float>(1.0 - std::pow(1.0 - theta_alfa, _len));
+        dc += (s_in / len - dc) * k_dc;
+        // r = anti_spur_inc^_len
+        if(anti_spur_en) anti_spur = (anti_spur + s_spur * anti_spur_alfa) * r;
+        theta1 += (s_cross.imag() / len - theta1) * k_theta;
+        theta2 += (s_abs.real() / len - theta2) * k_theta;
+        theta3 += (s_abs.imag() / len - theta3) * k_theta;
     }
 
 };
@@ -231,10 +360,8 @@ public:
 
 signals:
     void replace_null_indicator(const float _b1, const float _b2, const float _b3);
-    void l1_dyn_execute(l1_postsignalling _l1_post);
     void amount_plp(int _num_plp);
-    void data();
-    void stop_deinterleaver();
+    void stop_dump();
     void finished();
     void dump(file_sink_buf buf, int len);
 
@@ -242,11 +369,11 @@ public slots:
     void execute(int _len_in, complex* _q_in, float _level_estimate, signal_estimate* signal_);
     void stop();
     void set_fir(int idx);
+    void set_channel_2d(bool mode);
+    void set_p1_search(int _khz);
+    void set_l1_tolerance(int _frames);
 
 private:
-    QThread* thread = nullptr;
-    QMutex* mutex_out;
-    QWaitCondition* signal_out;
     QThread* thread2 = nullptr;
     file_sink* dump0 = nullptr;
 
@@ -273,16 +400,13 @@ private:
 
     double sample_rate_est_filtered = 0.0;
 
-    std::vector<complex> out_derotate_sample;
     constexpr static uint upsample = DECIMATION_STEP;
     float sample_rate;
     double resample;
     double max_resample, min_resample;
 
-    complex* out_interpolator{};
-    std::vector<complex> out_decimator{};
-    interpolator_farrow<complex, float> interpolator{};
-    filter_decimator decimator{};
+    std::vector<complex> out_resampler{};
+    resampler_polyphase resampler{};
 
     dvbt2_parameters dvbt2;
     bool p2_init = false;
@@ -293,7 +417,7 @@ private:
     int idx_buffer_sym = 0;
     std::vector<complex> buffer_sym{};
     fast_fourier_transform fft{};
-    complex* in_fft = nullptr;
+    int batch_left = 0;                 // symbols of the last batch still to demodulate
     complex* ofdm_cell;
     complex nco = 1.f;
 
@@ -301,11 +425,18 @@ private:
     address_freq_deinterleaver fq_deinterleaver{};
     int next_symbol_type = SYMBOL_TYPE_P1;
     bool demodulator_init = false;
+    guard_interval_detector gi_detector{};
+    bool guard_interval_found = false;
     bool deint_start = false;
     int idx_symbol = 0;
+    std::vector<complex> p2_cell{};
     bool crc32_l1_pre = false;
-    l1_presignalling l1_pre;
+    l1_presignalling l1_pre;            // the last good ones
     l1_postsignalling l1_post;
+    // bad P2 in a row ridden through on the last good L1 before the receiver is reset
+    int l1_bad_max = 4;
+    int l1_bad = 0;
+    void predict_l1_dynamic();
 
     bool frame_closing_symbol = false;
     int end_data_symbol = 1;
@@ -316,10 +447,10 @@ private:
     bool change_gain = false;
     int gain_offset = 0;
     bool enabled_display = false;
+    int64_t trace_item = 0;
 
     void symbol_acquisition(int _len_in, complex* _in, signal_estimate *signal_);
     void set_guard_interval();
-    void set_guard_interval_by_brute_force ();
     float level_detect = std::numeric_limits<float>::max();
 
 };
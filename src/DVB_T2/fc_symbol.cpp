@@ -67,15 +67,14 @@ void fc_symbol::init(dvbt2_parameters _dvbt2, pilot_generator* _pilot,
 #if 0
     est_show.resize(fft_size);
 #endif
-    show_symbol.resize(fft_size);
     show_data.resize(n_fc);
-
-    show_est_data.resize(k_total);
 }
 //-------------------------------------------------------------------------------------------
-void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &_phase_offset, std::vector<complex> &out)
+void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &_phase_offset, time_deinterleaver* _deinterleaver)
 {
-    complex* ofdm_cell = &_ofdm_cell[left_nulls];
+    // the spectrum is in natural order, active carrier i is in bin (left_nulls + i + fft_size / 2) mod fft_size
+    const int bin_shift = left_nulls + fft_size / 2;
+    const int bin_mask = fft_size - 1;
     complex est_pilot;
     float angle = 0.0f;
     float delta_angle = 0.0f;
@@ -100,13 +99,12 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
     int* h;
     if(idx_symbol % 2 == 0) h = h_odd_fc;
     else h = h_even_fc;
-
-    if(out.size()!=n_fc)
-        out.resize(n_fc);
-    complex* deinterleaved_cell=out.data();
+    complex* show = nullptr;
+    if(enabled_display && spectrograph_buffer.due()) show = &show_data[0];
+    _deinterleaver->begin_symbol(n_fc);
 
     //__for first pilot______
-    cell = ofdm_cell[0];
+    cell = _ofdm_cell[bin_shift & bin_mask];
     pilot_refer = fc_pilot_refer[0];
     if(pilot_refer < 0) {
         cell = -cell;
@@ -119,7 +117,7 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
     //__ ... ______________
 
     for (int i = 1; i < half_total; ++i){
-        cell = ofdm_cell[i];
+        cell = _ofdm_cell[(i + bin_shift) & bin_mask];
         pilot_refer = fc_pilot_refer[i];
         switch (fc_carrier_map[i]){
         case DATA_CARRIER:
@@ -146,7 +144,9 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
                 for(int j = 0; j < idx_data; ++j){
                     amp_est += delta_amp;
                     derotate *= derot_delta;
-                    deinterleaved_cell[h[d]] = buffer_cell[j] * derotate / amp_est;
+                    complex equalized = buffer_cell[j] * derotate / amp_est;
+                    _deinterleaver->write_cell(h[d], equalized);
+                    if(show) show[d] = equalized;
                     ++d;
                 }
             }
@@ -170,7 +170,7 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
         }
     }
 
-    cell = ofdm_cell[half_total];
+    cell = _ofdm_cell[(half_total + bin_shift) & bin_mask];
     pilot_refer = fc_pilot_refer[half_total];
     switch (fc_carrier_map[half_total]){
     case DATA_CARRIER:
@@ -199,7 +199,7 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
     }
 
     for (int i = half_total + 1; i < k_total; ++i){
-        cell = ofdm_cell[i];
+        cell = _ofdm_cell[(i + bin_shift) & bin_mask];
         pilot_refer = fc_pilot_refer[i];
         switch (fc_carrier_map[i]){
         case DATA_CARRIER:
@@ -226,7 +226,9 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
                 for(int j = 0; j < idx_data; ++j){
                     amp_est += delta_amp;
                     derotate *= derot_delta;
-                    deinterleaved_cell[h[d]] = buffer_cell[j] * derotate / amp_est;
+                    complex equalized = buffer_cell[j] * derotate / amp_est;
+                    _deinterleaver->write_cell(h[d], equalized);
+                    if(show) show[d] = equalized;
                     ++d;
                 }
             }
@@ -256,13 +258,14 @@ void fc_symbol::execute(complex* _ofdm_cell, float &_sample_rate_offset, float &
 
     _sample_rate_offset = (sum_angle_2 - sum_angle_1)/* / k_total*/;
 
-    int len = n_fc;
-    if(enabled_display)
+    _deinterleaver->end_symbol();
+
+    if(show)
     {
-        memcpy(&show_symbol[0], _ofdm_cell, sizeof(complex) * static_cast<unsigned int>(fft_size));
-        memcpy(&show_data[0], deinterleaved_cell, sizeof(complex) * static_cast<unsigned int>(len));
-        emit replace_spectrograph(fft_size, &show_symbol[0]);
-        emit replace_constelation(len, &show_data[0]);
+        spectrograph_buffer.publish(_ofdm_cell, fft_size, fft_size / 2);
+        constelation_buffer.publish(show, n_fc);
+        emit replace_spectrograph(&spectrograph_buffer);
+        emit replace_constelation(&constelation_buffer);
     }
 }
 //-------------------------------------------------------------------------------------------
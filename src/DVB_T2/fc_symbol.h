@@ -19,8 +19,10 @@
 #include <vector>
 
 #include "dvbt2_definition.h"
+#include "display_buffer.h"
 #include "pilot_generator.h"
 #include "address_freq_deinterleaver.h"
+#include "time_deinterleaver.h"
 
 class fc_symbol : public QObject
 {
@@ -29,7 +31,7 @@ public:
     explicit fc_symbol(QObject* parent = nullptr);
     ~fc_symbol();
 
-    void execute(complex* _ofdm_cell, float &_sample_rate_offset, float &_phase_offset, std::vector<complex> &out);
+    void execute(complex* _ofdm_cell, float &_sample_rate_offset, float &_phase_offset, time_deinterleaver* _deinterleaver);
     void init(dvbt2_parameters _dvbt2, pilot_generator *_pilot,
               address_freq_deinterleaver *_address);
     void enable_display(bool mode)
@@ -38,9 +40,9 @@ public:
     }
 
 signals:
-    void replace_spectrograph(const int _len_data, complex* _data);
-    void replace_constelation(const int _len_data, complex* _data);
-    void replace_oscilloscope(const int _len_data, complex* _data);
+    void replace_spectrograph(display_buffer* _buffer);
+    void replace_constelation(display_buffer* _buffer);
+    void replace_oscilloscope(display_buffer* _buffer);
 
 private:
     pilot_generator* pilot;
@@ -61,9 +63,9 @@ private:
     int* h_even_fc;
     int* h_odd_fc;
     std::vector<complex> est_show{};
-    std::vector<complex> show_symbol{};
     std::vector<complex> show_data{};
-    std::vector<complex> show_est_data{};
+    display_buffer spectrograph_buffer{display_buffer::spectrum_len, display_buffer::peak};
+    display_buffer constelation_buffer{display_buffer::constelation_len};
     bool enabled_display = false;
 };
 
@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "guard_interval_detector.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+//-------------------------------------------------------------------------------------------
+// sum of _a * conj(_b) and of |_a|^2 + |_b|^2 over _len samples
+static void correlate(int _len, const complex* _a, const complex* _b, complex &_cor, float &_energy)
+{
+    const __m256 signbits = _mm256_set_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f);
+    __m256 sum_re = _mm256_setzero_ps();
+    __m256 sum_im = _mm256_setzero_ps();
+    __m256 sum_e = _mm256_setzero_ps();
+    int i = 0;
+    for(; i + 4 <= _len; i += 4) {
+        __m256 a = _mm256_loadu_ps(reinterpret_cast<const float*>(_a + i));
+        __m256 b = _mm256_loadu_ps(reinterpret_cast<const float*>(_b + i));
+        // re: a.re * b.re + a.im * b.im, im: a.im * b.re - a.re * b.im
+        sum_re = _mm256_add_ps(sum_re, _mm256_mul_ps(a, b));
+        sum_im = _mm256_add_ps(sum_im, _mm256_xor_ps(_mm256_mul_ps(_mm256_permute_ps(a, 0xb1), b), signbits));
+        sum_e = _mm256_add_ps(sum_e, _mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)));
+    }
+    alignas(32) float re[8], im[8], e[8];
+    _mm256_store_ps(re, sum_re);
+    _mm256_store_ps(im, sum_im);
+    _mm256_store_ps(e, sum_e);
+    // every lane of sum_re adds to the real part, of sum_im to the imaginary
+    float cor_re = 0.0f;
+    float cor_im = 0.0f;
+    float energy = 0.0f;
+    for(int j = 0; j < 8; ++j) {
+        cor_re += re[j];
+        cor_im += im[j];
+        energy += e[j];
+    }
+    complex cor = {cor_re, cor_im};
+    for(; i < _len; ++i) {
+        cor += _a[i] * std::conj(_b[i]);
+        energy += std::norm(_a[i]) + std::norm(_b[i]);
+    }
+    _cor = cor;
+    _energy = energy;
+}
+//-------------------------------------------------------------------------------------------
+guard_interval_detector::guard_interval_detector()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+guard_interval_detector::~guard_interval_detector()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+void guard_interval_detector::init(dvbt2_parameters &_dvbt2, int _len_in, const complex* _in)
+{
+    fft_size = _dvbt2.fft_size;
+    fft_mode = _dvbt2.fft_mode;
+    // whole symbols of the longest guard interval
+    len_buffer = num_symbols * (fft_size + fft_size / 4);
+    if(static_cast<int>(buffer.size()) < len_buffer) buffer.resize(static_cast<size_t>(len_buffer));
+    idx_buffer = std::min(_len_in, len_buffer);
+    memcpy(buffer.data(), _in, sizeof(complex) * static_cast<unsigned int>(idx_buffer));
+}
+//-------------------------------------------------------------------------------------------
+bool guard_interval_detector::execute(const int _len_in, const complex* _in, int &_consume,
+                                      dvbt2_parameters &_dvbt2)
+{
+    int len = std::min(_len_in - _consume, len_buffer - idx_buffer);
+    memcpy(&buffer[idx_buffer], _in + _consume, sizeof(complex) * static_cast<unsigned int>(len));
+    _consume += len;
+    idx_buffer += len;
+    if(idx_buffer < len_buffer) return false;
+
+    _dvbt2.guard_interval_mode = detect();
+
+    return true;
+
+}
+//-------------------------------------------------------------------------------------------
+bool guard_interval_detector::allowed(int _gi) const
+{
+    switch (fft_mode) {
+    case FFTSIZE_1K:
+    case FFTSIZE_2K:
+    case FFTSIZE_4K:
+        return _gi != GI_1_128 && _gi != GI_19_128 && _gi != GI_19_256;
+    case FFTSIZE_32K:
+    case FFTSIZE_32K_T2GI:
+        return _gi != GI_1_4;
+    default:
+        return true;
+    }
+}
+//-------------------------------------------------------------------------------------------
+// For each guard interval the prefix correlation of the symbols after the first, normalized
+// by their energy: near 1 when the guard interval is right, falling symbol by symbol as the
+// windows of a wrong one slide off the prefixes.
+int guard_interval_detector::detect()
+{
+    int gi_max = GI_1_32;
+    float metric_max = -1.0f;
+    for(int gi = 0; gi < num_gi; ++gi) {
+        if(!allowed(gi)) continue;
+        const int len_gi = fft_size * gi_256[gi] / 256;
+        const int symbol_size = fft_size + len_gi;
+        float sum_cor = 0.0f;
+        float sum_energy = 0.0f;
+        for(int s = symbol_size; s + symbol_size <= len_buffer; s += symbol_size) {
+            complex cor;
+            float energy;
+            correlate(len_gi, &buffer[s], &buffer[s + fft_size], cor, energy);
+            sum_cor += std::abs(cor);
+            sum_energy += energy;
+        }
+        float metric = sum_energy > 0.0f ? 2.0f * sum_cor / sum_energy : 0.0f;
+        if(metric > metric_max) {
+            metric_max = metric;
+            gi_max = gi;
+        }
+    }
+
+    return gi_max;
+
+}
+//-------------------------------------------------------------------------------------------
@@ -0,0 +1,61 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef GUARD_INTERVAL_DETECTOR_H
+#define GUARD_INTERVAL_DETECTOR_H
+
+#include <vector>
+
+#include "dvbt2_definition.h"
+
+// Guard interval of the first frame from the cyclic prefix: the symbols after the P1 are
+// buffered and the prefix correlation of every guard interval allowed for the FFT size is
+// evaluated on them, the one correlating best wins. The buffer is then demodulated as if
+// just received, so the P2 of the same frame is not lost.
+class guard_interval_detector
+{
+public:
+    explicit guard_interval_detector();
+    ~guard_interval_detector();
+    // _len_in samples already received after the P1
+    void init(dvbt2_parameters &_dvbt2, int _len_in, const complex* _in);
+    bool execute(const int _len_in, const complex* _in, int &_consume, dvbt2_parameters &_dvbt2);
+    int remain() const
+    {
+        return len_buffer - idx_buffer;
+    }
+    int size() const
+    {
+        return len_buffer;
+    }
+    complex* data()
+    {
+        return buffer.data();
+    }
+
+private:
+    constexpr static int num_symbols = 5;   // the first one is not used, common to all
+    constexpr static int num_gi = 7;
+    // guard interval of GI_1_32 ... GI_19_256 in 1/256 of the FFT size
+    const int gi_256[num_gi] = {8, 16, 32, 64, 2, 38, 19};
+    std::vector<complex> buffer{};
+    int len_buffer = 0;
+    int idx_buffer = 0;
+    int fft_size = 0;
+    int fft_mode = 0;
+    bool allowed(int _gi) const;
+    int detect();
+};
+
+#endif // GUARD_INTERVAL_DETECTOR_H
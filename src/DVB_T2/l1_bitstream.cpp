@@ -0,0 +1,76 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "l1_bitstream.h"
+
+//-------------------------------------------------------------------------------------------
+l1_bitstream::l1_bitstream()
+{
+    init_crc32_table();
+}
+//-------------------------------------------------------------------------------------------
+l1_bitstream::~l1_bitstream()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+void l1_bitstream::init_crc32_table()
+{
+    for(uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i << 24;
+        for(int j = 0; j < 8; ++j) {
+            if(crc & 0x80000000) crc = (crc << 1) ^ crc_poly;
+            else crc <<= 1;
+        }
+        crc_table[i] = crc;
+    }
+}
+//-------------------------------------------------------------------------------------------
+void l1_bitstream::pack(const unsigned char* _bit, int _len)
+{
+    // eight zero bytes behind the last one let read() always take a whole word
+    byte.assign(static_cast<size_t>((_len + 7) / 8 + 8), 0);
+    len_bit = _len;
+    const int n_byte = _len / 8;
+    for(int i = 0; i < n_byte; ++i) {
+        const unsigned char* b = _bit + i * 8;
+        byte[static_cast<size_t>(i)] = static_cast<unsigned char>(b[0] << 7 | b[1] << 6 | b[2] << 5 | b[3] << 4 |
+                                                                 b[4] << 3 | b[5] << 2 | b[6] << 1 | b[7]);
+    }
+    for(int i = n_byte * 8; i < _len; ++i) {
+        byte[static_cast<size_t>(i >> 3)] |= static_cast<unsigned char>(_bit[i] << (7 - (i & 7)));
+    }
+}
+//-------------------------------------------------------------------------------------------
+bool l1_bitstream::check_crc32(int _len) const
+{
+    if(_len < 0 || _len + 32 > len_bit) return false;
+
+    uint32_t crc = 0xffffffff;
+    const int n_byte = _len / 8;
+    for(int i = 0; i < n_byte; ++i) {
+        crc = (crc << 8) ^ crc_table[((crc >> 24) ^ byte[static_cast<size_t>(i)]) & 0xff];
+    }
+    // the L1-post need not end on a byte
+    for(int i = n_byte * 8; i < _len; ++i) {
+        const uint32_t b = ((byte[static_cast<size_t>(i >> 3)] >> (7 - (i & 7))) ^ (crc >> 31)) & 0x01;
+        crc <<= 1;
+        if(b) crc ^= crc_poly;
+    }
+    int idx = _len;
+
+    return crc == static_cast<uint32_t>(read(idx, 32));
+
+}
+//-------------------------------------------------------------------------------------------
@@ -0,0 +1,55 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef L1_BITSTREAM_H
+#define L1_BITSTREAM_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// The L1 signalling packed MSB first, eight bits to a byte, checked by a byte-wise CRC-32
+// and parsed a field at a time.
+class l1_bitstream
+{
+public:
+    explicit l1_bitstream();
+    ~l1_bitstream();
+    // _bit: one bit per byte
+    void pack(const unsigned char* _bit, int _len);
+    // CRC-32 of the first _len bits against the 32 bits that follow them
+    bool check_crc32(int _len) const;
+    // up to 56 bits from _idx on, _idx moves past them, out of the stream reads 0
+    uint64_t read(int &_idx, int _n) const
+    {
+        const int idx = _idx;
+        _idx += _n;
+        if(idx < 0 || _idx > len_bit) return 0;
+        const unsigned char* p = &byte[static_cast<size_t>(idx >> 3)];
+        uint64_t w = 0;
+        for(int i = 0; i < 8; ++i) w = (w << 8) | p[i];
+
+        return (w << (idx & 7)) >> (64 - _n);
+
+    }
+
+private:
+    constexpr static uint32_t crc_poly = 0x04C11DB7;
+    std::vector<unsigned char> byte{};
+    int len_bit = 0;
+    uint32_t crc_table[256];
+    void init_crc32_table();
+};
+
+#endif // L1_BITSTREAM_H
@@ -0,0 +1,240 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "l1_fec_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+// EN 302 755 7.3.1: permutation order of the shortened BCH information groups
+static const int l1_pre_shortening[9] =
+{
+    7, 4, 5, 8, 3, 2, 6, 1, 0
+};
+static const int l1_post_shortening[20] =
+{
+    18, 17, 16, 15, 14, 13, 12, 11, 4, 10, 9, 8, 3, 2, 7, 6, 5, 1, 19, 0
+};
+// and of the punctured LDPC parity groups
+static const int l1_pre_puncturing[36] =
+{
+    27, 13, 29, 32, 5, 0, 11, 21, 33, 20, 25, 28, 18, 35, 8, 3, 9, 31,
+    22, 24, 7, 14, 17, 4, 2, 26, 16, 34, 19, 10, 12, 23, 1, 6, 30, 15
+};
+static const int l1_post_puncturing[25] =
+{
+    6, 4, 13, 9, 18, 8, 15, 20, 5, 17, 2, 22, 24, 7, 12, 1, 16, 23, 14, 0, 21, 10, 19, 11, 3
+};
+//-------------------------------------------------------------------------------------------
+l1_fec_decoder::l1_fec_decoder()
+{
+    decode_pre_1_4.init(LDPC<DVB_T2_TABLE_SHORT_C1_4>());
+    decode_post_1_2.init(LDPC<DVB_T2_TABLE_SHORT_C1_2>());
+    code.resize(n_ldpc);
+    padded.resize(n_ldpc);
+    bch_in.resize(NBCH_1_2);
+    init_gf();
+}
+//-------------------------------------------------------------------------------------------
+l1_fec_decoder::~l1_fec_decoder()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+bool l1_fec_decoder::decode_pre(const int8_t* _llr, unsigned char* _bit)
+{
+    return decode(decode_pre_1_4, 1, KBCH_1_4, NBCH_1_4, KSIG_PRE, L1_PRE_CELL,
+                  l1_pre_shortening, l1_pre_puncturing, _llr, _bit);
+}
+//-------------------------------------------------------------------------------------------
+bool l1_fec_decoder::decode_post(int _n_fec_block, int _k_sig, int _n_post, const int8_t* _llr,
+                                 unsigned char* _bit)
+{
+    return decode(decode_post_1_2, _n_fec_block, KBCH_1_2, NBCH_1_2, _k_sig, _n_post,
+                  l1_post_shortening, l1_post_puncturing, _llr, _bit);
+}
+//-------------------------------------------------------------------------------------------
+// The zero padded information bits: whole groups in the shortening order, then the last
+// part of the next group. The punctured parity bits: whole groups P_j = {p_k, k mod Q = j}
+// in the puncturing order, then the first part of the next group. What is left is sent
+// in codeword order.
+bool l1_fec_decoder::build_map(int _k_bch, int _k_ldpc, int _k_sig, int _n_tx, const int* _shortening,
+                               const int* _puncturing)
+{
+    const int n_group = (_k_bch + group_size - 1) / group_size;
+    const int q = (n_ldpc - _k_ldpc) / group_size;
+    map_k_bch = -1;
+    std::fill(padded.begin(), padded.end(), false);
+    if(_k_sig <= 0 || _k_sig > _k_bch) return false;
+
+    int n_pad = _k_bch - _k_sig;
+    for(int j = 0; j < n_group && n_pad > 0; ++j) {
+        const int begin = _shortening[j] * group_size;
+        const int end = std::min(begin + group_size, _k_bch);
+        const int len = std::min(end - begin, n_pad);
+        for(int k = end - len; k < end; ++k) padded[static_cast<size_t>(k)] = true;
+        n_pad -= len;
+    }
+    int n_punc = _k_sig + n_ldpc - _k_bch - _n_tx;
+    if(n_punc < 0 || n_punc > n_ldpc - _k_ldpc) return false;
+
+    std::vector<bool> punctured(static_cast<size_t>(n_ldpc - _k_ldpc), false);
+    for(int j = 0; j < q && n_punc > 0; ++j) {
+        const int len = std::min(group_size, n_punc);
+        for(int m = 0; m < len; ++m) punctured[static_cast<size_t>(_puncturing[j] + q * m)] = true;
+        n_punc -= len;
+    }
+    tx_map.clear();
+    for(int k = 0; k < _k_bch; ++k) {
+        if(!padded[static_cast<size_t>(k)]) tx_map.push_back(k);
+    }
+    for(int k = _k_bch; k < _k_ldpc; ++k) tx_map.push_back(k);
+    for(int k = 0; k < n_ldpc - _k_ldpc; ++k) {
+        if(!punctured[static_cast<size_t>(k)]) tx_map.push_back(_k_ldpc + k);
+    }
+    if(static_cast<int>(tx_map.size()) != _n_tx) return false;
+
+    map_k_bch = _k_bch;
+    map_k_sig = _k_sig;
+    map_n_tx = _n_tx;
+
+    return true;
+
+}
+//-------------------------------------------------------------------------------------------
+bool l1_fec_decoder::decode(LDPCDecoder<simd_type, algorithm_type> &_ldpc, int _n_fec_block, int _k_bch,
+                            int _k_ldpc, int _k_sig, int _n_tx, const int* _shortening,
+                            const int* _puncturing, const int8_t* _llr, unsigned char* _bit)
+{
+    if(map_k_bch != _k_bch || map_k_sig != _k_sig || map_n_tx != _n_tx) {
+        if(!build_map(_k_bch, _k_ldpc, _k_sig, _n_tx, _shortening, _puncturing)) return false;
+    }
+    int8_t* lane = reinterpret_cast<int8_t*>(code.data());
+    bool ok = true;
+    for(int b0 = 0; b0 < _n_fec_block; b0 += SIMD_WIDTH) {
+        const int blocks = std::min(SIMD_WIDTH, _n_fec_block - b0);
+        // the padded bits are known zeros, the punctured ones are erasures
+        memset(lane, 0, sizeof(simd_type) * n_ldpc);
+        for(int k = 0; k < _k_bch; ++k) {
+            if(padded[static_cast<size_t>(k)]) memset(lane + k * SIMD_WIDTH, known_zero, SIMD_WIDTH);
+        }
+        for(int b = 0; b < blocks; ++b) {
+            const int8_t* llr = _llr + (b0 + b) * _n_tx;
+            for(int i = 0; i < _n_tx; ++i) lane[tx_map[static_cast<size_t>(i)] * SIMD_WIDTH + b] = llr[i];
+        }
+        // near the threshold the weakest punctured bits keep the checks from clearing while the
+        // information is already right, so the BCH has the last word
+        _ldpc(code.data(), code.data() + _k_ldpc, max_trials, blocks);
+        for(int b = 0; b < blocks; ++b) {
+            for(int k = 0; k < _k_ldpc; ++k) bch_in[static_cast<size_t>(k)] = lane[k * SIMD_WIDTH + b] < 0 ? 1 : 0;
+            if(!bch_decode(_k_ldpc, bch_in.data())) ok = false;
+            unsigned char* bit = _bit + (b0 + b) * _k_sig;
+            for(int k = 0; k < _k_bch; ++k) {
+                if(!padded[static_cast<size_t>(k)]) *bit++ = bch_in[static_cast<size_t>(k)];
+            }
+        }
+    }
+
+    return ok;
+
+}
+//-------------------------------------------------------------------------------------------
+void l1_fec_decoder::init_gf()
+{
+    // GF(2^14) of the 16K BCH codes, primitive polynomial x^14 + x^5 + x^3 + x + 1
+    const int poly = 0x402b;
+    gf_exp.resize(2 * gf_n);
+    gf_log.resize(gf_n + 1);
+    int x = 1;
+    for(int i = 0; i < gf_n; ++i) {
+        gf_exp[static_cast<size_t>(i)] = gf_exp[static_cast<size_t>(i + gf_n)] = x;
+        gf_log[static_cast<size_t>(x)] = i;
+        x <<= 1;
+        if(x & (1 << gf_m)) x ^= poly;
+    }
+    gf_log[0] = -1;
+}
+//-------------------------------------------------------------------------------------------
+// Syndromes, Berlekamp-Massey and Chien search of the shortened code, the first bit is the
+// coefficient of x^(n - 1). Corrects in place up to bch_t errors.
+bool l1_fec_decoder::bch_decode(int _n_bch, unsigned char* _bit)
+{
+    const int* alpha_to = gf_exp.data();
+    const int* index_of = gf_log.data();
+    int s[2 * bch_t + 1];
+    bool error = false;
+    for(int i = 1; i <= 2 * bch_t; ++i) {
+        int sum = 0;
+        for(int k = 0; k < _n_bch; ++k) {
+            if(sum) sum = alpha_to[index_of[sum] + i];
+            sum ^= _bit[k];
+        }
+        s[i] = sum;
+        if(sum) error = true;
+    }
+    if(!error) return true;
+
+    int lambda[2 * bch_t + 2] = {1};
+    int b[2 * bch_t + 2] = {1};
+    int t[2 * bch_t + 2];
+    int l = 0;
+    int m = 1;
+    int d_b = 1;
+    for(int r = 1; r <= 2 * bch_t; ++r) {
+        int d = s[r];
+        for(int i = 1; i <= l; ++i) {
+            if(lambda[i] && s[r - i]) d ^= alpha_to[index_of[lambda[i]] + index_of[s[r - i]]];
+        }
+        if(d == 0) {
+            ++m;
+            continue;
+        }
+        const int coef = index_of[d] - index_of[d_b] + gf_n;
+        memcpy(t, lambda, sizeof(lambda));
+        for(int i = 0; i + m < 2 * bch_t + 2; ++i) {
+            if(b[i]) lambda[i + m] ^= alpha_to[(coef + index_of[b[i]]) % gf_n];
+        }
+        if(2 * l <= r - 1) {
+            l = r - l;
+            memcpy(b, t, sizeof(b));
+            d_b = d;
+            m = 1;
+        }
+        else {
+            ++m;
+        }
+    }
+    if(l > bch_t) return false;
+
+    int position[bch_t];
+    int found = 0;
+    for(int e = 0; e < _n_bch; ++e) {
+        int sum = 0;
+        const int x = (gf_n - e) % gf_n;
+        for(int j = 0; j <= l; ++j) {
+            if(lambda[j]) sum ^= alpha_to[(index_of[lambda[j]] + x * j) % gf_n];
+        }
+        if(sum == 0) {
+            if(found == l) return false;
+            position[found++] = _n_bch - 1 - e;
+        }
+    }
+    if(found != l) return false;
+
+    for(int i = 0; i < found; ++i) _bit[position[i]] ^= 1;
+
+    return true;
+
+}
+//-------------------------------------------------------------------------------------------
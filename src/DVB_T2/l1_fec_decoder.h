@@ -0,0 +1,76 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef L1_FEC_DECODER_H
+#define L1_FEC_DECODER_H
+
+#include <vector>
+
+#include "ldpc_decoder.h"
+
+#define KBCH_1_4 3072
+#define NBCH_1_4 3240
+#define KBCH_1_2 7032
+#define NBCH_1_2 7200
+#define KSIG_PRE 200
+#define KSIG_POST 350
+#define NBCH_PARITY 168
+
+// Soft decision FEC of the L1 signalling: the shortened and punctured 16K LDPC codewords
+// (1/4 for L1-pre, 1/2 for L1-post) are rebuilt around the received LLRs, decoded by the
+// layered decoder, one L1-post FEC block per lane, and the BCH (t = 12) corrects what is
+// left. The LLRs come in transmission order after the bit deinterleaver, positive for 0.
+class l1_fec_decoder
+{
+public:
+    explicit l1_fec_decoder();
+    ~l1_fec_decoder();
+    // true when the BCH syndromes of every block clear, the CRC-32 of the caller decides
+    // _llr: L1_PRE_CELL soft bits, _bit: KSIG_PRE bits out
+    bool decode_pre(const int8_t* _llr, unsigned char* _bit);
+    // _llr: _n_fec_block blocks of _n_post soft bits, _bit: _n_fec_block blocks of _k_sig bits out
+    bool decode_post(int _n_fec_block, int _k_sig, int _n_post, const int8_t* _llr, unsigned char* _bit);
+
+private:
+    constexpr static int group_size = 360;
+    constexpr static int n_ldpc = 16200;
+    constexpr static int known_zero = 127;
+    constexpr static int max_trials = 25;    // once per frame, affords more iterations than the PLPs
+
+    LDPCDecoder<simd_type, algorithm_type> decode_pre_1_4;
+    LDPCDecoder<simd_type, algorithm_type> decode_post_1_2;
+    std::vector<simd_type> code{};
+    std::vector<int> tx_map{};          // codeword position of each transmitted bit
+    std::vector<bool> padded{};
+    std::vector<unsigned char> bch_in{};
+    int map_k_bch = -1;
+    int map_k_sig = -1;
+    int map_n_tx = -1;
+
+    bool build_map(int _k_bch, int _k_ldpc, int _k_sig, int _n_tx, const int* _shortening,
+                   const int* _puncturing);
+    bool decode(LDPCDecoder<simd_type, algorithm_type> &_ldpc, int _n_fec_block, int _k_bch, int _k_ldpc,
+                int _k_sig, int _n_tx, const int* _shortening, const int* _puncturing,
+                const int8_t* _llr, unsigned char* _bit);
+
+    constexpr static int gf_m = 14;
+    constexpr static int gf_n = (1 << gf_m) - 1;
+    constexpr static int bch_t = 12;
+    std::vector<int> gf_exp{};
+    std::vector<int> gf_log{};
+    void init_gf();
+    bool bch_decode(int _n_bch, unsigned char* _bit);
+};
+
+#endif // L1_FEC_DECODER_H
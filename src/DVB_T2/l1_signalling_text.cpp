@@ -0,0 +1,175 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "l1_signalling_text.h"
+
+//-------------------------------------------------------------------------------------------
+QString l1_presignalling_text(const l1_presignalling &_l1_pre)
+{
+    return "TYPE\t\t  " + QString::number(_l1_pre.type) + "\n"
+           + "BWT_EXT\t\t  " + QString::number(_l1_pre.bwt_ext) +  "\n"
+           + "S1\t\t  " + QString::number(_l1_pre.s1) +  "\n"
+           + "S2_FIELD1\t\t  " + QString::number(_l1_pre.s2_field1) +  "\n"
+           + "S2_FIELD2\t\t  " + QString::number(_l1_pre.s2_field2) +  "\n"
+           + "L1_REPETITION_FLAG  " + QString::number(_l1_pre.l1_repetition_flag) +  "\n"
+           + "GUARD_INTERVAL\t  " + QString::number(_l1_pre.guard_interval) +  "\n"
+           + "PAPR\t\t  " + QString::number(_l1_pre.papr) +  "\n"
+           + "L1_POST_MOD\t  " + QString::number(_l1_pre.l1_post_mod) +  "\n"
+           + "L1_COD\t\t " + QString::number(_l1_pre.l1_cod) +  "\n"
+           + "L1_FEC_TYPE\t " + QString::number(_l1_pre.l1_fec_type) +  "\n"
+           + "L1_POST_SIZE\t " + QString::number(_l1_pre.l1_post_size) +  "\n"
+           + "L1_POST_INFO_SIZE   " + QString::number(_l1_pre.l1_post_info_size) +  "\n"
+           + "PILOT_PATTERN\t " + QString::number(_l1_pre.pilot_pattern) +  "\n"
+           + "TX_ID_AVAILABILITY   " + QString::number(_l1_pre.tx_id_availability) +  "\n"
+           + "CELL_ID\t\t " + QString::number(_l1_pre.cell_id) +  "\n"
+           + "NETWORK_ID\t " + QString::number(_l1_pre.network_id) +  "\n"
+           + "T2_SYSTEM_ID\t " + QString::number(_l1_pre.t2_system_id) +  "\n"
+           + "NUM_T2_FRAMES\t " + QString::number(_l1_pre.num_t2_frames) +  "\n"
+           + "NUM_DATA_SYMBOLS " + QString::number(_l1_pre.num_data_symbols) +  "\n"
+           + "REGEN_FLAG\t " + QString::number(_l1_pre.regen_flag) +  "\n"
+           + "L1_POST_EXTENSION " + QString::number(_l1_pre.l1_post_extension) +  "\n"
+           + "NUM_RF\t\t " + QString::number(_l1_pre.num_rf) +  "\n"
+           + "CURRENT_RF_IDX\t " + QString::number(_l1_pre.current_rf_index) +  "\n"
+           + "T2_VERSION\t " + QString::number(_l1_pre.t2_version) +  "\n"
+           + "L1_POST_SCRAMBLED " + QString::number(_l1_pre.l1_post_scrambled) +  "\n"
+           + "T2_BASE_LITE\t " + QString::number(_l1_pre.t2_base_lite) +  "\n"
+           + "RESERVED\t\t " + QString::number(_l1_pre.reserved) +  "\n";
+}
+//-------------------------------------------------------------------------------------------
+QString l1_postsignalling_text(const l1_postsignalling &_l1_post)
+{
+    QString text = "";
+    text += "SUB_SLISER_PER_FRAME  " +
+            QString::number(_l1_post.sub_slices_per_frame) + "\n";
+    text += "NUM_PLP\t\t" + QString::number(_l1_post.num_plp) + "\n";
+    for(int i = 0; i < static_cast<int>(_l1_post.plp.size()); ++i){
+        text += QString::number(i) +
+              "  PLP_ID\t\t" + QString::number(_l1_post.plp[i].id) + "\n"
+              + QString::number(i) +
+              "  PLP_TYPE\t" + QString::number(_l1_post.plp[i].plp_type) + "\n"
+              + QString::number(i) +
+              "  PLP_PAYLOAD_TYPE  " + QString::number(_l1_post.plp[i].plp_payload_type) + "\n"
+              + QString::number(i) +
+              "  FF_FLAG\t\t" + QString::number(_l1_post.plp[i].ff_flag) + "\n"
+              + QString::number(i) +
+              "  FIRST_RF_IDX\t" + QString::number(_l1_post.plp[i].first_rf_idx) + "\n"
+              + QString::number(i) +
+              "  FIRST_FRAME_IDX\t" + QString::number(_l1_post.plp[i].first_frame_idx) + "\n"
+              + QString::number(i) +
+              "  PLP_GROUP_ID\t" + QString::number(_l1_post.plp[i].plp_group_id) + "\n"
+              + QString::number(i) +
+              "  PLP_COD\t" + QString::number(_l1_post.plp[i].plp_cod) + "\n"
+              + QString::number(i) +
+              "  PLP_MOD\t" + QString::number(_l1_post.plp[i].plp_mod) + "\n"
+              + QString::number(i) +
+              "  PLP_POTATION\t" + QString::number(_l1_post.plp[i].plp_rotation) + "\n"
+              + QString::number(i) +
+              "  PLP_FEC_TYPE\t" + QString::number(_l1_post.plp[i].plp_fec_type) + "\n"
+              + QString::number(i) +
+              "  PLP_NUM_BLOCKS_MAX " + QString::number(_l1_post.plp[i].plp_num_blocks_max) + "\n"
+              + QString::number(i) +
+              "  FRAME_INTERVAL\t" + QString::number(_l1_post.plp[i].frame_interval) + "\n"
+              + QString::number(i) +
+              "  TIME_IL_LENGTH\t" + QString::number(_l1_post.plp[i].time_il_length) + "\n"
+              + QString::number(i) +
+              "  TIME_IL_TYPE\t" + QString::number(_l1_post.plp[i].time_il_type) + "\n"
+              + QString::number(i) +
+              "  IN_BAND_A_FLAG\t" + QString::number(_l1_post.plp[i].in_band_a_flag) + "\n"
+              + QString::number(i) +
+              "  IN_BAND_B_FLAG\t" + QString::number(_l1_post.plp[i].in_band_b_flag) + "\n"
+              + QString::number(i) +
+              "  RESERVED_1\t" + QString::number(_l1_post.plp[i].reserved_1) + "\n"
+              + QString::number(i) +
+              "  PLP_MODE\t" + QString::number(_l1_post.plp[i].plp_mode) + "\n"
+              + QString::number(i) +
+              "  STATIC_FLAG\t" + QString::number(_l1_post.plp[i].static_flag) + "\n"
+              + QString::number(i) +
+              "  STATIC_PADDING_FLAG " + QString::number(_l1_post.plp[i].static_padding_flag) + "\n";
+    }
+    for(int i = 0; i < static_cast<int>(_l1_post.rf.size()); ++i){
+        text += QString::number(i) +
+              "  RF_IDX\t\t" + QString::number(_l1_post.rf[i].rf_idx) + "\n"
+              + QString::number(i) +
+              "  FREQUENCY\t" + QString::number(_l1_post.rf[i].frequency) + "\n";
+    }
+    text += "FEF_TYPE\t\t" + QString::number(_l1_post.fef_type) + "\n"
+          + "FEF_LENGHT\t" + QString::number(_l1_post.fef_length) + "\n"
+          + "FEF_INTERVAL\t" + QString::number(_l1_post.fef_interval) + "\n"
+          + "FEF_LENGHT_MSB\t" + QString::number(_l1_post.fef_length_msb) + "\n"
+          + "RESERVED_2\t" + QString::number(_l1_post.reserved_2) + "\n";
+    text += "NUM_AUX\t\t" + QString::number(_l1_post.num_aux) + "\n"
+          + "AUX_CONFIG_RFU\t" + QString::number(_l1_post.aux_config_rfu) + "\n";
+    for(int i = 0; i < static_cast<int>(_l1_post.aux.size()); ++i){
+        text += QString::number(i) +
+              "  AUX_STREAM_TYPE  " + QString::number(_l1_post.aux[i].aux_stream_type) + "\n"
+              + QString::number(i) +
+              "  AUX_PRIVATE_CONFIG " + QString::number(_l1_post.aux[i].aux_private_config) + "\n";
+    }
+
+    return text;
+
+}
+//-------------------------------------------------------------------------------------------
+QString l1_dynamic_text(const l1_postsignalling &_l1_post, bool _next)
+{
+    QString text = "";
+    text += "DYN_FRAME_IDX\t" + QString::number(_l1_post.dyn.frame_idx) + "\n"
+          + "DYN_SUBSLICE_INTERVAL " + QString::number(_l1_post.dyn.sub_slice_interval) + "\n"
+          + "DYN_TYPE_2_START\t" + QString::number(_l1_post.dyn.type_2_start) + "\n"
+          + "DYN_L1_CHANGE_COUNTER " + QString::number(_l1_post.dyn.l1_change_counter) + "\n"
+          + "DYN_START_RF_IDX\t" + QString::number(_l1_post.dyn.start_rf_idx) + "\n"
+          + "DYN_RESERVED_1\t" + QString::number(_l1_post.dyn.reserved_1) + "\n";
+    for(int i = 0; i < static_cast<int>(_l1_post.dyn.plp.size()); ++i){
+        text += QString::number(i) +
+              "  DYN_PLP_ID\t" + QString::number(_l1_post.dyn.plp[i].id) + "\n"
+              + QString::number(i) +
+              "  DYN_PLP_START\t" + QString::number(_l1_post.dyn.plp[i].start) + "\n"
+              + QString::number(i) +
+              "  DYN_PLP_NUM_BLOCKS " + QString::number(_l1_post.dyn.plp[i].num_blocks) + "\n"
+              + QString::number(i) +
+              "  DYN_RESERVED_2\t" + QString::number(_l1_post.dyn.plp[i].reserved_2) + "\n";
+    }
+    for(int i = 0; i < static_cast<int>(_l1_post.dyn.aux_private_dyn.size()); ++i){
+        text += QString::number(i) +
+              "  DYN_AUX_PRIVATE_DYN " + QString::number(_l1_post.dyn.aux_private_dyn[i]) + "\n";
+    }
+    text += "DYN_RESERVED_3\t" + QString::number(_l1_post.dyn.reserved_3) + "\n";
+    if(!_next) return text;
+
+    text += "DYN_NEXT_FRAME_IDX  " + QString::number(_l1_post.dyn_next.frame_idx) + "\n"
+          + "DYN_NEXT_SUBSLICE_INTERVAL " + QString::number(_l1_post.dyn_next.sub_slice_interval) + "\n"
+          + "DYN_NEXT_TYPE_2_START " + QString::number(_l1_post.dyn_next.type_2_start) + "\n"
+          + "DYN_NEXT_L1_CHANGE_COUNTER " + QString::number(_l1_post.dyn_next.l1_change_counter) + "\n"
+          + "DYN_NEXT_START_RF_IDX " + QString::number(_l1_post.dyn_next.start_rf_idx) + "\n"
+          + "DYN_NEXT_RESERVED_1 " + QString::number(_l1_post.dyn_next.reserved_1) + "\n";
+    for(int i = 0; i < static_cast<int>(_l1_post.dyn_next.plp.size()); ++i){
+        text += QString::number(i) +
+              "  DYN_NEXT_PLP_ID\t" + QString::number(_l1_post.dyn_next.plp[i].id) + "\n"
+              + QString::number(i) +
+              "  DYN_NEXT_PLP_START " + QString::number(_l1_post.dyn_next.plp[i].start) + "\n"
+              + QString::number(i) +
+              "  DYN_NEXT_PLP_NUM_BLOCKS " + QString::number(_l1_post.dyn_next.plp[i].num_blocks) + "\n"
+              + QString::number(i) +
+              "  DYN_NEXT_RESERVED_2 " + QString::number(_l1_post.dyn_next.plp[i].reserved_2) + "\n";
+    }
+    for(int i = 0; i < static_cast<int>(_l1_post.dyn_next.aux_private_dyn.size()); ++i){
+        text += QString::number(i) +
+              "  DYN_NEXT_AUX_PRIVATE_DYN " + QString::number(_l1_post.dyn_next.aux_private_dyn[i]) + "\n";
+    }
+    text += "DYN_NEXT_RESERVED_3 " + QString::number(_l1_post.dyn_next.reserved_3) + "\n";
+
+    return text;
+
+}
+//-------------------------------------------------------------------------------------------
@@ -0,0 +1,29 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef L1_SIGNALLING_TEXT_H
+#define L1_SIGNALLING_TEXT_H
+
+#include <QString>
+
+#include "dvbt2_definition.h"
+
+// Human readable L1 signalling, made on the GUI side from the parsed fields so the
+// demodulator thread never formats text.
+QString l1_presignalling_text(const l1_presignalling &_l1_pre);
+QString l1_postsignalling_text(const l1_postsignalling &_l1_post);
+// _next: the L1 repetition flag, the dynamic part of the next frame follows
+QString l1_dynamic_text(const l1_postsignalling &_l1_post, bool _next);
+
+#endif // L1_SIGNALLING_TEXT_H
@@ -13,7 +13,11 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "ldpc_decoder.h"
+#include "acquisition_timeline.h"
+#include "receiver_metrics.h"
+#include "stage_tracer.h"
 
+#include <immintrin.h>
 // #include <iostream>
 
 
@@ -97,12 +101,7 @@ ldpc_decoder::ldpc_decoder(QWaitCondition* _signal_in, QMutex *_mutex_in, QObjec
     decode_short_cod_4_5.init(LDPC<DVB_T2_TABLE_SHORT_C4_5>());
     decode_short_cod_5_6.init(LDPC<DVB_T2_TABLE_SHORT_C5_6>());
 
-//    aligned_buffer = aligned_alloc(sizeof(simd_type), sizeof(simd_type) * FEC_SIZE_NORMAL);
-//    simd = reinterpret_cast<simd_type*>(aligned_buffer);
-
-    simd = new(std::align_val_t(sizeof(simd_type)))simd_type[sizeof(simd_type) * FEC_SIZE_NORMAL];
-
-    const unsigned int len_buffer = 54000 * SIZEOF_SIMD;    // for ldpc code 5/6
+    const unsigned int len_buffer = 54000 * SIZEOF_SIMD / 8;    // for ldpc code 5/6, packed bits
     buffer.resize(len_buffer);
     bch_fec = buffer.data();
     display.resize(TRIALS+2);
@@ -130,12 +129,13 @@ ldpc_decoder::~ldpc_decoder()
 void ldpc_decoder::bch_frame_finished()
 {
     --nqueued_frames;
-    if(nqueued_frames>nqueued_max/2)
-        printf("ldpc_decoder::nqueued_frames=%d\n",nqueued_frames);
+    receiver_metrics::instance().set(METRIC_LDPC_QUEUE, nqueued_frames);
 }
 //------------------------------------------------------------------------------------------
 void ldpc_decoder::execute(idx_plp_simd_t _idx_plp_simd, l1_postsignalling _l1_post, int _len_in, fec_frame _in)
 {
+    TRACE_SCOPE(TRACE_LDPC_DECODER, trace_item);
+    ++trace_item;
 
 //    if(_idx_plp_simd[0]==0){
 //        mutex_in->unlock();
@@ -144,148 +144,153 @@ void ldpc_decoder::execute(idx_plp_simd_t _idx_plp_simd, l1_postsignalling _l1_p
 
     int* plp_id = &_idx_plp_simd[0];
     l1_postsignalling &l1_post = _l1_post;
-    int8_t* in = &_in[0];
-    int len_in = _len_in;
+    // soft bits arrive interleaved by lane from the demapper, decode them in place
+    simd_type* simd = reinterpret_cast<simd_type*>(_in.data());
     int k_ldpc=0;
-    int q_ldpc=0;
     dvbt2_fectype_t fec_type = static_cast<dvbt2_fectype_t>(l1_post.plp[plp_id[0]].plp_fec_type);
     dvbt2_code_rate_t code_rate = static_cast<dvbt2_code_rate_t>(l1_post.plp[plp_id[0]].plp_cod);
-    int fec_size;
 
     if (fec_type == FEC_FRAME_NORMAL) {
-        fec_size = FEC_SIZE_NORMAL;
       switch (code_rate) {
         case C1_2:
           p_decode = &decode_normal_cod_1_2;
           k_ldpc = 32400;
-          q_ldpc = 90;
           break;
         case C3_5:
           p_decode = &decode_normal_cod_3_5;
           k_ldpc = 38880;
-          q_ldpc = 72;
           break;
         case C2_3:
           p_decode = &decode_normal_cod_2_3;
           k_ldpc = 43200;
-          q_ldpc = 60;
           break;
         case C3_4:
           p_decode = &decode_normal_cod_3_4;
           k_ldpc = 48600;
-          q_ldpc = 45;
           break;
         case C4_5:
           p_decode = &decode_normal_cod_4_5;
           k_ldpc = 51840;
-          q_ldpc = 36;
           break;
         case C5_6:
           p_decode = &decode_normal_cod_5_6;
           k_ldpc = 54000;
-          q_ldpc = 30;
           break;
       }
     }
     else{
-        fec_size = FEC_SIZE_SHORT;
       switch (code_rate) {
         case C1_2:
           p_decode = &decode_short_cod_1_2;
           k_ldpc = 7200;
-          q_ldpc = 25;
           break;
         case C3_5:
           p_decode = &decode_short_cod_3_5;
           k_ldpc = 9720;
-          q_ldpc = 18;
           break;
         case C2_3:
           p_decode = &decode_short_cod_2_3;
           k_ldpc = 10800;
-          q_ldpc = 15;
           break;
         case C3_4:
           p_decode = &decode_short_cod_3_4;
           k_ldpc = 11880;
-          q_ldpc = 12;
           break;
         case C4_5:
           p_decode = &decode_short_cod_4_5;
           k_ldpc = 12600;
-          q_ldpc = 10;
           break;
         case C5_6:
           p_decode = &decode_short_cod_5_6;
           k_ldpc = 13320;
-          q_ldpc = 8;
           break;
       }
     }
 
-    int k = 0;
-    for(int j = 0; j < len_in; j += fec_size) {
-        for (int i = 0; i < k_ldpc; ++i) {
-            reinterpret_cast<code_type*>(simd + i)[k] = in[j + i];
-        }
-        for (int t = 0; t < q_ldpc; ++t) {
-            for (int s = 0; s < 360; ++s) {
-                reinterpret_cast<code_type*>(simd + k_ldpc + q_ldpc * s + t)[k] =
-                        in[j + k_ldpc + 360 * t + s];
-            }
-        }
-        ++k;
-    }
-
     int trials = TRIALS;
-    int count = (*p_decode)(simd, simd + k_ldpc, trials, SIZEOF_SIMD);
+    int count = p_decode->decode(simd, trials, SIZEOF_SIMD);
+    receiver_metrics &metrics = receiver_metrics::instance();
+    metrics.add(METRIC_LDPC_BATCHES);
     if (count < 0) {
         fprintf(stderr, "LDPC decoder could not recover the codeword! %d\n", count);
         n_failed ++;
-        n_failed_tot ++;
-    }else
+        metrics.add(METRIC_LDPC_FAILURES);
+    }else {
         n_trials[count]++;
+        metrics.ldpc_iterations(TRIALS - count);
+        acquisition_timeline::instance().mark(ACQUISITION_LDPC);
+    }
     n_frames++;
-    if(!(n_frames & 0x0f))
+    if(!(n_frames & 0x0f) && oscilloscope_buffer.due())
     {
         for(int j=0;j<=TRIALS;j++)
             display[TRIALS-j]=complex(float(n_trials[j])*100.f/float(n_frames));
         display[TRIALS+1]=complex(float(n_failed)*100.f/float(n_frames));
-        emit replace_oscilloscope(TRIALS+2, &display[0]);
+        oscilloscope_buffer.publish(&display[0], TRIALS+2);
+        emit replace_oscilloscope(&oscilloscope_buffer);
     }
+    // the oscilloscope shows the recent iterations, the totals are in the metrics
     if(!(n_frames & 0x0ff))
     {
         int N = 0;
         for(int j=0;j<=TRIALS;j++)
         {
-            if(n_trials[j])
-                printf("%u:%1.3f ",TRIALS-j,double(n_trials[j])*100./double(n_frames));
             n_trials[j]>>=1;
             N += n_trials[j];
         }
-        printf(" x:%u\n",n_failed_tot);
         n_failed >>= 1;
         N += n_failed;
         n_frames = N;
     }
-    int8_t *s;
-    for(int j = 0; j < SIZEOF_SIMD; ++j) {
-        for (int i = 0; i < k_ldpc; ++i) {
-            s = reinterpret_cast<code_type*>(simd + i);
-            if(s[j] < 0) *bch_fec++ = 1;
-            else         *bch_fec++ = 0;
-        }
-    }
-
-    bch_fec = buffer.data();
-
+    hard_decision(k_ldpc, simd, bch_fec);
 
     int len_out = k_ldpc * SIZEOF_SIMD;
     ++nqueued_frames;
+    metrics.set(METRIC_LDPC_QUEUE, nqueued_frames);
     emit bit_bch(_idx_plp_simd, l1_post, len_out, buffer);
     emit frame_finished();
 }
 //------------------------------------------------------------------------------------------
+static inline uint32_t sign_mask(const int8_t* _in)
+{
+#ifdef __AVX2__
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(_in))));
+#else
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(_in))));
+#endif
+}
+//------------------------------------------------------------------------------------------
+// 8x8 bit matrix transpose: bit c of byte r goes to bit r of byte c
+static inline uint64_t transpose_8x8_bit(uint64_t _x)
+{
+    uint64_t t;
+    t = (_x ^ (_x >> 7)) & 0x00aa00aa00aa00aaULL;
+    _x ^= t ^ (t << 7);
+    t = (_x ^ (_x >> 14)) & 0x0000cccc0000ccccULL;
+    _x ^= t ^ (t << 14);
+    t = (_x ^ (_x >> 28)) & 0x00000000f0f0f0f0ULL;
+    _x ^= t ^ (t << 28);
+    return _x;
+}
+//------------------------------------------------------------------------------------------
+// Sign bits of the first _len words, packed msb first, one codeword after another.
+void ldpc_decoder::hard_decision(int _len, const simd_type* _in, uint8_t* _out)
+{
+    const int8_t* in = reinterpret_cast<const int8_t*>(_in);
+    const int len_lane = _len / 8;
+    uint32_t sign[8];
+    for(int i = 0; i < _len; i += 8) {
+        for(int r = 0; r < 8; ++r) sign[r] = sign_mask(in + (i + r) * SIZEOF_SIMD);
+        for(int b = 0; b < SIZEOF_SIMD; b += 8) {
+            uint64_t x = 0;
+            for(int r = 0; r < 8; ++r) x |= static_cast<uint64_t>((sign[r] >> b) & 0xff) << (8 * (7 - r));
+            x = transpose_8x8_bit(x);
+            uint8_t* out = _out + b * len_lane + i / 8;
+            for(int c = 0; c < 8; ++c) out[c * len_lane] = static_cast<uint8_t>(x >> (8 * c));
+        }
+    }
+}
+//------------------------------------------------------------------------------------------
 void ldpc_decoder::stop()
 {
     emit finished();
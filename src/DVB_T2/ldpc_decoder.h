@@ -23,6 +23,7 @@
 #include <QMetaType>
 
 #include "dvbt2_definition.h"
+#include "display_buffer.h"
 #include "bch_decoder.h"
 #include "LDPC/dvb_t2_tables.hh"
 #include "LDPC/algorithms.hh"
@@ -82,7 +83,7 @@ signals:
     void stop_decoder();
     void finished();
     void frame_finished();
-    void replace_oscilloscope(const int _len_data, complex* _data);
+    void replace_oscilloscope(display_buffer* _buffer);
 
 public slots:
     void execute(idx_plp_simd_t _idx_plp_simd, l1_postsignalling _l1_post, int _len_in, fec_frame _in);
@@ -101,8 +102,8 @@ private:
     constexpr static int nqueued_max{64};
     unsigned n_trials[TRIALS + 1]{0};
     unsigned n_failed{0};
-    unsigned n_failed_tot{0};
     unsigned n_frames{0};
+    int64_t trace_item{0};
 
     LDPCDecoder<simd_type, algorithm_type> decode_normal_cod_1_2;
     LDPCDecoder<simd_type, algorithm_type> decode_normal_cod_3_4;
@@ -119,10 +120,10 @@ private:
     LDPCDecoder<simd_type, algorithm_type> decode_short_cod_5_6;
 
     LDPCDecoder<simd_type, algorithm_type>* p_decode;
+    void hard_decision(int _len, const simd_type* _in, uint8_t* _out);
 
-    void* aligned_buffer;
-    simd_type *simd;
     std::vector<complex> display{};
+    display_buffer oscilloscope_buffer;
 
 };
 
@@ -16,6 +16,8 @@
 
 //#include <QDebug>
 #include <immintrin.h>
+#include <algorithm>
+#include <limits>
 
 #if defined(_MSC_VER)
 #define ALIGNED_(x) __declspec(align(x))
@@ -25,6 +27,8 @@
 #endif
 #endif
 #include "aligned_ptr.h"
+#include "receiver_metrics.h"
+#include "stage_tracer.h"
 
 //------------------------------------------------------------------------------------------
 llr_demapper::llr_demapper(QWaitCondition *_signal_in, QMutex* _mutex, QObject* parent) :
@@ -41,29 +45,38 @@ llr_demapper::llr_demapper(QWaitCondition *_signal_in, QMutex* _mutex, QObject*
     derotate_qam256.real(cos(-ROT_QAM256));
     derotate_qam256.imag(sin(-ROT_QAM256));
 
-    //address column twist deinterleaved and demultiplexer
+    //column twist deinterleaver and demultiplexer
     int column, row;
     column = 2025;
     row = 8;
-    address_generator(column, row, address_qam16_fecshort.data(), tc_qam16_short, demux_16);
+    twist_generator(column, row, tc_qam16_short, demux_16, twist_qam16_fecshort);
     column = 8100;
-    address_generator(column, row, address_qam16_fecnormal.data(), tc_qam16_normal, demux_16);
-    address_generator(column, row, address_qam16_fecnormal_3_5.data(), tc_qam16_normal, demux_16_fec_size_normal_code_3_5);
+    twist_generator(column, row, tc_qam16_normal, demux_16, twist_qam16_fecnormal);
+    twist_generator(column, row, tc_qam16_normal, demux_16_fec_size_normal_code_3_5, twist_qam16_fecnormal_3_5);
     column = 1350;
     row = 12;
-    address_generator(column, row, address_qam64_fecshort.data(), tc_qam64_short, demux_64);
+    twist_generator(column, row, tc_qam64_short, demux_64, twist_qam64_fecshort);
     column = 5400;
-    address_generator(column, row, address_qam64_fecnormal.data(), tc_qam64_normal, demux_64);
-    address_generator(column, row, address_qam64_fecnormal_3_5.data(), tc_qam64_normal, demux_64_fec_size_normal_code_3_5);
+    twist_generator(column, row, tc_qam64_normal, demux_64, twist_qam64_fecnormal);
+    twist_generator(column, row, tc_qam64_normal, demux_64_fec_size_normal_code_3_5, twist_qam64_fecnormal_3_5);
     column = 2025;
     row = 8;
-    address_generator(column, row, address_qam256_fecshort.data(), tc_qam256_short, demux_256_fec_size_short);
+    twist_generator(column, row, tc_qam256_short, demux_256_fec_size_short, twist_qam256_fecshort);
     column = 4050;
     row = 16;
-    address_generator(column, row, address_qam256_fecnormal.data(), tc_qam256_normal, demux_256_fec_size_normal);
-    address_generator(column, row, address_qam256_fecnormal_3_5.data(), tc_qam256_normal, demux_256_fec_size_normal_3_5);
-    address_generator(column, row, address_qam256_fecnormal_2_3.data(), tc_qam256_normal, demux_256_fec_size_normal_2_3);
-
+    twist_generator(column, row, tc_qam256_normal, demux_256_fec_size_normal, twist_qam256_fecnormal);
+    twist_generator(column, row, tc_qam256_normal, demux_256_fec_size_normal_3_5, twist_qam256_fecnormal_3_5);
+    twist_generator(column, row, tc_qam256_normal, demux_256_fec_size_normal_2_3, twist_qam256_fecnormal_2_3);
+    //byte shuffles interleaving the three LLR pairs of 64QAM cells
+    for(int p = 0; p < 48; ++p){
+        int j = p / 16;
+        int b = p % 16;
+        int cell = p / 6;
+        int k = (p % 6) / 2;
+        for(int n = 0; n < 3; ++n){
+            shuffle_qam64[j][n][b] = n == k ? static_cast<int8_t>(cell * 2 + p % 2) : -128;
+        }
+    }
 
     mutex_out = new QMutex;
     signal_out = new QWaitCondition;
@@ -89,29 +102,473 @@ llr_demapper::~llr_demapper()
 void llr_demapper::ldpc_frame_finished()
 {
     --nqueued_frames;
-    if(nqueued_frames>nqueued_max/2)
-        printf("llr_demapper::nqueued_frames=%d\n",nqueued_frames);
+    receiver_metrics::instance().set(METRIC_DEMAPPER_QUEUE, nqueued_frames);
+}
+//------------------------------------------------------------------------------------------
+void llr_demapper::twist_generator(int _column, int _row, const int* _tc, const int* _demux,
+                                   twist_t &_twist)
+{
+    _twist.column = _column;
+    _twist.row = _row;
+    for(int n = 0; n < _row; ++n){
+        int r = _demux[n];
+        _twist.dst[n] = _column * r;
+        _twist.start[n] = (_column - _tc[r]) % _column;
+    }
+}
+//------------------------------------------------------------------------------------------
+static inline void transpose_8x8_epi16(__m128i* _a)
+{
+    __m128i b0 = _mm_unpacklo_epi16(_a[0], _a[1]);
+    __m128i b1 = _mm_unpackhi_epi16(_a[0], _a[1]);
+    __m128i b2 = _mm_unpacklo_epi16(_a[2], _a[3]);
+    __m128i b3 = _mm_unpackhi_epi16(_a[2], _a[3]);
+    __m128i b4 = _mm_unpacklo_epi16(_a[4], _a[5]);
+    __m128i b5 = _mm_unpackhi_epi16(_a[4], _a[5]);
+    __m128i b6 = _mm_unpacklo_epi16(_a[6], _a[7]);
+    __m128i b7 = _mm_unpackhi_epi16(_a[6], _a[7]);
+    __m128i c0 = _mm_unpacklo_epi32(b0, b2);
+    __m128i c1 = _mm_unpackhi_epi32(b0, b2);
+    __m128i c2 = _mm_unpacklo_epi32(b1, b3);
+    __m128i c3 = _mm_unpackhi_epi32(b1, b3);
+    __m128i c4 = _mm_unpacklo_epi32(b4, b6);
+    __m128i c5 = _mm_unpackhi_epi32(b4, b6);
+    __m128i c6 = _mm_unpacklo_epi32(b5, b7);
+    __m128i c7 = _mm_unpackhi_epi32(b5, b7);
+    _a[0] = _mm_unpacklo_epi64(c0, c4);
+    _a[1] = _mm_unpackhi_epi64(c0, c4);
+    _a[2] = _mm_unpacklo_epi64(c1, c5);
+    _a[3] = _mm_unpackhi_epi64(c1, c5);
+    _a[4] = _mm_unpacklo_epi64(c2, c6);
+    _a[5] = _mm_unpackhi_epi64(c2, c6);
+    _a[6] = _mm_unpacklo_epi64(c3, c7);
+    _a[7] = _mm_unpackhi_epi64(c3, c7);
+}
+//------------------------------------------------------------------------------------------
+void llr_demapper::bit_deinterleave(const twist_t &_twist, const int8_t* _in, int8_t* _out)
+{
+    const int column = _twist.column;
+    const int row = _twist.row;
+    int g = 0;
+    if(row == 8 || row == 16){
+        // 16 cell groups at once: transpose bytes in registers, store 16 bytes per column
+        const __m128i pair = _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+        __m128i lo[8], hi[8];
+        for(; g + 16 <= column; g += 16){
+            const int8_t* src = _in + g * row;
+            if(row == 8){
+                for(int v = 0; v < 8; ++v){
+                    lo[v] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * v)), pair);
+                }
+            }
+            else{
+                for(int v = 0; v < 8; ++v){
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32 * v));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32 * v + 16));
+                    lo[v] = _mm_unpacklo_epi8(a, b);
+                    hi[v] = _mm_unpackhi_epi8(a, b);
+                }
+                transpose_8x8_epi16(hi);
+            }
+            transpose_8x8_epi16(lo);
+            for(int n = 0; n < row; ++n){
+                __m128i v = n < 8 ? lo[n] : hi[n - 8];
+                int p = g + _twist.start[n];
+                if(p >= column) p -= column;
+                int8_t* dst = _out + _twist.dst[n];
+                if(p + 16 <= column){
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + p), v);
+                }
+                else{
+                    int8_t ALIGNED_(16) tmp[16];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(tmp), v);
+                    for(int j = 0; j < 16; ++j){
+                        dst[p] = tmp[j];
+                        if(++p == column) p = 0;
+                    }
+                }
+            }
+        }
+    }
+    // strided copy in tiles that stay in L1, contiguous writes per column
+    for(int g0 = g; g0 < column; g0 += twist_tile){
+        int len = std::min(twist_tile, column - g0);
+        for(int n = 0; n < row; ++n){
+            const int8_t* src = _in + g0 * row + n;
+            int8_t* dst = _out + _twist.dst[n];
+            int p = g0 + _twist.start[n];
+            if(p >= column) p -= column;
+            int len_1 = std::min(len, column - p);
+            for(int j = 0; j < len_1; ++j) dst[p + j] = src[j * row];
+            src += len_1 * row;
+            for(int j = 0; j < len - len_1; ++j) dst[j] = src[j * row];
+        }
+    }
+}
+//------------------------------------------------------------------------------------------
+void llr_demapper::derotate_cell(int _len, complex* _cell, complex _derotate)
+{
+    const __m256 v_cos = _mm256_set1_ps(_derotate.real());
+    const __m256 v_sin = _mm256_set1_ps(_derotate.imag());
+    float* cell = reinterpret_cast<float*>(_cell);
+    int i = 0;
+    for(; i + 4 <= _len; i += 4){
+        __m256 v = _mm256_loadu_ps(cell + 2 * i);
+        __m256 v_swap = _mm256_permute_ps(v, 0xb1);
+        v = _mm256_addsub_ps(_mm256_mul_ps(v, v_cos), _mm256_mul_ps(v_swap, v_sin));
+        _mm256_storeu_ps(cell + 2 * i, v);
+    }
+    for(; i < _len; ++i) _cell[i] *= _derotate;
+}
+//------------------------------------------------------------------------------------------
+// Eight channel state weights, one per float of four cells.
+static inline __m256 csi_to_ps(__m128i _csi)
+{
+    __m128i lo = _mm_cvtepu8_epi32(_csi);
+    __m128i hi = _mm_cvtepu8_epi32(_mm_srli_si128(_csi, 4));
+    return _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+}
+//------------------------------------------------------------------------------------------
+void llr_demapper::hard_demap(int _len, const complex* _cell, const uint8_t* _csi, float _norm, float _level_max,
+                              float &_sum_s, float &_sum_e)
+{
+    // nearest level of each axis: min(2 * floor(|x| / 2norm) + 1, level_max) * norm,
+    // the error is weighted by the channel state to give the noise at the mean channel power
+    const __m256 signbits = _mm256_set1_ps(-0.0f);
+    const __m256 v_half_norm = _mm256_set1_ps(0.5f / _norm);
+    const __m256 v_norm = _mm256_set1_ps(_norm);
+    const __m256 v_level_max = _mm256_set1_ps(_level_max);
+    const __m256 v_one = _mm256_set1_ps(1.0f);
+    __m256 v_sum_s = _mm256_setzero_ps();
+    __m256 v_sum_e = _mm256_setzero_ps();
+    const float* cell = reinterpret_cast<const float*>(_cell);
+    int i = 0;
+    for(; i + 4 <= _len; i += 4){
+        __m256 v_abs = _mm256_andnot_ps(signbits, _mm256_loadu_ps(cell + 2 * i));
+        __m256 v_level = _mm256_floor_ps(_mm256_mul_ps(v_abs, v_half_norm));
+        v_level = _mm256_min_ps(_mm256_add_ps(_mm256_add_ps(v_level, v_level), v_one), v_level_max);
+        __m256 v_s = _mm256_mul_ps(v_level, v_norm);
+        __m256 v_e = _mm256_sub_ps(v_abs, v_s);
+        __m256 v_w = csi_to_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(_csi + 2 * i)));
+        v_sum_s = _mm256_add_ps(v_sum_s, _mm256_mul_ps(v_s, v_s));
+        v_sum_e = _mm256_add_ps(v_sum_e, _mm256_mul_ps(_mm256_mul_ps(v_e, v_e), v_w));
+    }
+    float ALIGNED_(32) sum_s[8];
+    float ALIGNED_(32) sum_e[8];
+    _mm256_store_ps(sum_s, v_sum_s);
+    _mm256_store_ps(sum_e, v_sum_e);
+    _sum_s = 0.0f;
+    _sum_e = 0.0f;
+    for(int j = 0; j < 8; ++j){
+        _sum_s += sum_s[j];
+        _sum_e += sum_e[j];
+    }
+    for(i *= 2; i < _len * 2; ++i){
+        float abs = std::abs(cell[i]);
+        float s = std::min(2.0f * std::floor(abs * 0.5f / _norm) + 1.0f, _level_max) * _norm;
+        _sum_s += s * s;
+        _sum_e += (abs - s) * (abs - s) * _csi[i];
+    }
+    _sum_e *= 1.0f / CSI_UNITY;
+}
+//------------------------------------------------------------------------------------------
+// LLRs of eight cells (I, Q, I, Q, ...) saturated to int8_t
+static inline __m128i pack_llr(__m256 _a, __m256 _b)
+{
+    const __m256 v_max = _mm256_set1_ps(127.0f);
+    const __m256 v_min = _mm256_set1_ps(-128.0f);
+    __m256i v_int_a = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_a, v_min), v_max));
+    __m256i v_int_b = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_b, v_min), v_max));
+    __m128i v_short_a = _mm_packs_epi32(_mm256_castsi256_si128(v_int_a), _mm256_extractf128_si256(v_int_a, 1));
+    __m128i v_short_b = _mm_packs_epi32(_mm256_castsi256_si128(v_int_b), _mm256_extractf128_si256(v_int_b, 1));
+    return _mm_packs_epi16(v_short_a, v_short_b);
+}
+//------------------------------------------------------------------------------------------
+// Interleave the per level LLRs of eight cells into cell order.
+template<int LEVELS>
+inline void llr_demapper::store_llr(const __m128i* _llr, int8_t* _out)
+{
+    __m128i* dst = reinterpret_cast<__m128i*>(_out);
+    if constexpr(LEVELS == 1){
+        _mm_storeu_si128(dst, _llr[0]);
+    }
+    else if constexpr(LEVELS == 2){
+        _mm_storeu_si128(dst, _mm_unpacklo_epi16(_llr[0], _llr[1]));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(_llr[0], _llr[1]));
+    }
+    else if constexpr(LEVELS == 3){
+        for(int j = 0; j < 3; ++j){
+            __m128i v = _mm_shuffle_epi8(_llr[0], *reinterpret_cast<const __m128i*>(shuffle_qam64[j][0]));
+            v = _mm_or_si128(v, _mm_shuffle_epi8(_llr[1], *reinterpret_cast<const __m128i*>(shuffle_qam64[j][1])));
+            v = _mm_or_si128(v, _mm_shuffle_epi8(_llr[2], *reinterpret_cast<const __m128i*>(shuffle_qam64[j][2])));
+            _mm_storeu_si128(dst + j, v);
+        }
+    }
+    else{
+        __m128i t0 = _mm_unpacklo_epi16(_llr[0], _llr[1]);
+        __m128i t1 = _mm_unpackhi_epi16(_llr[0], _llr[1]);
+        __m128i t2 = _mm_unpacklo_epi16(_llr[2], _llr[3]);
+        __m128i t3 = _mm_unpackhi_epi16(_llr[2], _llr[3]);
+        _mm_storeu_si128(dst, _mm_unpacklo_epi32(t0, t2));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi32(t0, t2));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi32(t1, t3));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi32(t1, t3));
+    }
+}
+//------------------------------------------------------------------------------------------
+// Soft bits in cell order: for each cell LLR pair (I, Q) of level 0, level 1, ...
+// Each LLR is scaled by the channel state weight of its axis.
+template<int BITS_PER_CELL>
+void llr_demapper::soft_demap(int _len, const complex* _cell, const uint8_t* _csi, float _precision,
+                              const float* _threshold, int8_t* _out)
+{
+    constexpr int levels = BITS_PER_CELL / 2;
+    const __m256 signbits = _mm256_set1_ps(-0.0f);
+    const float precision = _precision / CSI_UNITY;
+    const __m256 v_precision = _mm256_set1_ps(precision);
+    __m256 v_threshold[levels];
+    for(int k = 1; k < levels; ++k) v_threshold[k] = _mm256_set1_ps(_threshold[k - 1]);
+    const float* cell = reinterpret_cast<const float*>(_cell);
+    int8_t* bit = _out;
+    int i = 0;
+    for(; i + 8 <= _len; i += 8){
+        __m128i llr[levels];
+        __m256 v_a = _mm256_loadu_ps(cell + 2 * i);
+        __m256 v_b = _mm256_loadu_ps(cell + 2 * i + 8);
+        __m128i v_csi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_csi + 2 * i));
+        __m256 v_scale_a = _mm256_mul_ps(csi_to_ps(v_csi), v_precision);
+        __m256 v_scale_b = _mm256_mul_ps(csi_to_ps(_mm_srli_si128(v_csi, 8)), v_precision);
+        for(int k = 0; k < levels; ++k){
+            if(k > 0){
+                v_a = _mm256_sub_ps(_mm256_andnot_ps(signbits, v_a), v_threshold[k]);
+                v_b = _mm256_sub_ps(_mm256_andnot_ps(signbits, v_b), v_threshold[k]);
+            }
+            llr[k] = pack_llr(_mm256_mul_ps(v_a, v_scale_a), _mm256_mul_ps(v_b, v_scale_b));
+        }
+        store_llr<levels>(llr, bit);
+        bit += 8 * BITS_PER_CELL;
+    }
+    for(; i < _len; ++i){
+        float re = _cell[i].real();
+        float im = _cell[i].imag();
+        float precision_re = precision * _csi[2 * i];
+        float precision_im = precision * _csi[2 * i + 1];
+        for(int k = 0; k < levels; ++k){
+            if(k > 0){
+                re = std::abs(re) - _threshold[k - 1];
+                im = std::abs(im) - _threshold[k - 1];
+            }
+            *bit++ = quantize(precision_re, re);
+            *bit++ = quantize(precision_im, im);
+        }
+    }
 }
 //------------------------------------------------------------------------------------------
-void llr_demapper::address_generator(int _column, int _row, int* _address, const int* _tc,
-                                     const int* _demux)
+// Max-log demapping of rotated cells on both axes at once. The cells are derotated, the
+// cyclic Q-delay is already removed, so each axis is weighted by the channel state of the
+// carrier it was sent on: d^2 = w_i * (y_i - s_i)^2 + w_q * (y_q - s_q)^2 with y = rot(cell).
+// The search is pruned to 2 * M points of the M x M constellation: for each level of one
+// axis the best level of the other one is the nearest to the minimum of the quadratic.
+template<int BITS_PER_CELL>
+void llr_demapper::rotated_demap(int _len, const complex* _cell, const uint8_t* _csi, float _rotation,
+                                 float _norm, float _precision, int8_t* _out)
 {
-    int address[FEC_SIZE_NORMAL];
-    for(int c = 0; c < _column; ++c){
-        for(int r = 0; r < _row; ++r){
-            address[c * _row + r] = _column * r + (c + _column - _tc[r]) % _column;
+    constexpr int levels = BITS_PER_CELL / 2;
+    constexpr int m = 1 << levels;
+    const float c = cosf(_rotation);
+    const float s = sinf(_rotation);
+    float scale = _precision / (4.0f * _norm * CSI_UNITY);
+    constexpr float eps = 1.0e-6f;
+    // levels (2 * j + 1 - m) * norm, bit k of a level is 1 in label[k]
+    float level[m];
+    int label[levels] = {};
+    for(int j = 0; j < m; ++j){
+        int u = 2 * j + 1 - m;
+        level[j] = u * _norm;
+        for(int k = 0; k < levels; ++k){
+            if(k > 0) u = std::abs(u) - (m >> k);
+            if(u < 0) label[k] |= 1 << j;
         }
     }
-    int k = 0;
-    int n = 0;
-    int frame = _column * _row;
-    for(int i = 0; i < frame; ++i){
-        _address[i] =  address[_demux[n] + k];
-        ++n;
-        if(n == _row) {
-            n = 0;
-            k += _row;
+    const __m256 v_c = _mm256_set1_ps(c);
+    const __m256 v_s = _mm256_set1_ps(s);
+    const __m256 v_eps = _mm256_set1_ps(eps);
+    const __m256 v_half_step = _mm256_set1_ps(0.5f / _norm);
+    const __m256 v_offset = _mm256_set1_ps(0.5f * m);
+    const __m256 v_index_max = _mm256_set1_ps(m - 1);
+    const __m256 v_level_0 = _mm256_set1_ps(level[0]);
+    const __m256 v_step = _mm256_set1_ps(2.0f * _norm);
+    const __m256 v_big = _mm256_set1_ps(std::numeric_limits<float>::max());
+    const __m256 v_scale = _mm256_set1_ps(scale);
+    auto nearest = [&](__m256 _a){
+        __m256 j = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(_a, v_half_step), v_offset));
+        j = _mm256_min_ps(_mm256_max_ps(j, _mm256_setzero_ps()), v_index_max);
+        return _mm256_add_ps(v_level_0, _mm256_mul_ps(j, v_step));
+    };
+    const float* cell = reinterpret_cast<const float*>(_cell);
+    int8_t* bit = _out;
+    int i = 0;
+    for(; i + 8 <= _len; i += 8){
+        // axes of the cells 0, 1, 4, 5, 2, 3, 6, 7
+        __m256 v_a = _mm256_loadu_ps(cell + 2 * i);
+        __m256 v_b = _mm256_loadu_ps(cell + 2 * i + 8);
+        __m256 z_i = _mm256_shuffle_ps(v_a, v_b, 0x88);
+        __m256 z_q = _mm256_shuffle_ps(v_a, v_b, 0xdd);
+        __m128i v_csi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_csi + 2 * i));
+        __m256 w_a = csi_to_ps(v_csi);
+        __m256 w_b = csi_to_ps(_mm_srli_si128(v_csi, 8));
+        __m256 w_i = _mm256_shuffle_ps(w_a, w_b, 0x88);
+        __m256 w_q = _mm256_shuffle_ps(w_a, w_b, 0xdd);
+        __m256 y_i = _mm256_sub_ps(_mm256_mul_ps(z_i, v_c), _mm256_mul_ps(z_q, v_s));
+        __m256 y_q = _mm256_add_ps(_mm256_mul_ps(z_i, v_s), _mm256_mul_ps(z_q, v_c));
+        __m256 wi_c = _mm256_mul_ps(w_i, v_c);
+        __m256 wi_s = _mm256_mul_ps(w_i, v_s);
+        __m256 wq_c = _mm256_mul_ps(w_q, v_c);
+        __m256 wq_s = _mm256_mul_ps(w_q, v_s);
+        __m256 den_cc = _mm256_add_ps(_mm256_mul_ps(wi_c, v_c), _mm256_mul_ps(wq_s, v_s));
+        __m256 den_ss = _mm256_add_ps(_mm256_mul_ps(wi_s, v_s), _mm256_mul_ps(wq_c, v_c));
+        __m256 inv_cc = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(den_cc, v_eps));
+        __m256 inv_ss = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(den_ss, v_eps));
+        __m256 d_i[m], d_q[m];
+        for(int j = 0; j < m; ++j){
+            const __m256 v_level = _mm256_set1_ps(level[j]);
+            // I at level j, the best Q
+            __m256 u = _mm256_sub_ps(y_i, _mm256_mul_ps(v_c, v_level));
+            __m256 v = _mm256_sub_ps(y_q, _mm256_mul_ps(v_s, v_level));
+            __m256 a = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(wq_c, v), _mm256_mul_ps(wi_s, u)), inv_ss);
+            a = nearest(a);
+            __m256 e_i = _mm256_add_ps(u, _mm256_mul_ps(v_s, a));
+            __m256 e_q = _mm256_sub_ps(v, _mm256_mul_ps(v_c, a));
+            d_i[j] = _mm256_add_ps(_mm256_mul_ps(w_i, _mm256_mul_ps(e_i, e_i)),
+                                   _mm256_mul_ps(w_q, _mm256_mul_ps(e_q, e_q)));
+            // Q at level j, the best I
+            u = _mm256_add_ps(y_i, _mm256_mul_ps(v_s, v_level));
+            v = _mm256_sub_ps(y_q, _mm256_mul_ps(v_c, v_level));
+            a = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(wi_c, u), _mm256_mul_ps(wq_s, v)), inv_cc);
+            a = nearest(a);
+            e_i = _mm256_sub_ps(u, _mm256_mul_ps(v_c, a));
+            e_q = _mm256_sub_ps(v, _mm256_mul_ps(v_s, a));
+            d_q[j] = _mm256_add_ps(_mm256_mul_ps(w_i, _mm256_mul_ps(e_i, e_i)),
+                                   _mm256_mul_ps(w_q, _mm256_mul_ps(e_q, e_q)));
+        }
+        __m128i llr[levels];
+        for(int k = 0; k < levels; ++k){
+            __m256 i_0 = v_big, i_1 = v_big, q_0 = v_big, q_1 = v_big;
+            for(int j = 0; j < m; ++j){
+                if(label[k] & (1 << j)){
+                    i_1 = _mm256_min_ps(i_1, d_i[j]);
+                    q_1 = _mm256_min_ps(q_1, d_q[j]);
+                }
+                else{
+                    i_0 = _mm256_min_ps(i_0, d_i[j]);
+                    q_0 = _mm256_min_ps(q_0, d_q[j]);
+                }
+            }
+            __m256 llr_i = _mm256_mul_ps(_mm256_sub_ps(i_1, i_0), v_scale);
+            __m256 llr_q = _mm256_mul_ps(_mm256_sub_ps(q_1, q_0), v_scale);
+            // back to the cells 0, 1, 2, 3 and 4, 5, 6, 7
+            llr[k] = pack_llr(_mm256_unpacklo_ps(llr_i, llr_q), _mm256_unpackhi_ps(llr_i, llr_q));
         }
+        store_llr<levels>(llr, bit);
+        bit += 8 * BITS_PER_CELL;
+    }
+    for(; i < _len; ++i){
+        float z_i = _cell[i].real();
+        float z_q = _cell[i].imag();
+        float w_i = _csi[2 * i];
+        float w_q = _csi[2 * i + 1];
+        float y_i = z_i * c - z_q * s;
+        float y_q = z_i * s + z_q * c;
+        float inv_cc = 1.0f / (w_i * c * c + w_q * s * s + eps);
+        float inv_ss = 1.0f / (w_i * s * s + w_q * c * c + eps);
+        auto nearest_level = [&](float _a){
+            float j = std::floor(_a * 0.5f / _norm + 0.5f * m);
+            return level[0] + std::min(std::max(j, 0.0f), static_cast<float>(m - 1)) * 2.0f * _norm;
+        };
+        float d_i[m], d_q[m];
+        for(int j = 0; j < m; ++j){
+            float u = y_i - c * level[j];
+            float v = y_q - s * level[j];
+            float a = nearest_level((w_q * c * v - w_i * s * u) * inv_ss);
+            float e_i = u + s * a;
+            float e_q = v - c * a;
+            d_i[j] = w_i * e_i * e_i + w_q * e_q * e_q;
+            u = y_i + s * level[j];
+            v = y_q - c * level[j];
+            a = nearest_level((w_i * c * u + w_q * s * v) * inv_cc);
+            e_i = u - c * a;
+            e_q = v - s * a;
+            d_q[j] = w_i * e_i * e_i + w_q * e_q * e_q;
+        }
+        for(int k = 0; k < levels; ++k){
+            float i_0 = std::numeric_limits<float>::max(), i_1 = i_0, q_0 = i_0, q_1 = i_0;
+            for(int j = 0; j < m; ++j){
+                if(label[k] & (1 << j)){
+                    i_1 = std::min(i_1, d_i[j]);
+                    q_1 = std::min(q_1, d_q[j]);
+                }
+                else{
+                    i_0 = std::min(i_0, d_i[j]);
+                    q_0 = std::min(q_0, d_q[j]);
+                }
+            }
+            *bit++ = quantize(scale, i_1 - i_0);
+            *bit++ = quantize(scale, q_1 - q_0);
+        }
+    }
+}
+//------------------------------------------------------------------------------------------
+static inline void transpose_16x16_epi8(__m128i* _a)
+{
+    __m128i b[16];
+    for(int s = 0; s < 4; ++s){
+        for(int i = 0; i < 8; ++i){
+            b[2 * i] = _mm_unpacklo_epi8(_a[i], _a[i + 8]);
+            b[2 * i + 1] = _mm_unpackhi_epi8(_a[i], _a[i + 8]);
+        }
+        for(int i = 0; i < 16; ++i) _a[i] = b[i];
+    }
+}
+//------------------------------------------------------------------------------------------
+// Block k of the batch becomes lane k: bit i of every block lands in the i-th simd word.
+// The decoder works on the parity in transmission order, no parity interleaving is needed.
+void llr_demapper::lane_interleave(int _fec_size, const int8_t* _in, int8_t* _out)
+{
+    __m128i v[16];
+    int i = 0;
+    for(; i + 16 <= _fec_size; i += 16){
+        for(int h = 0; h < SIZEOF_SIMD; h += 16){
+            const int8_t* src = _in + h * _fec_size + i;
+            for(int k = 0; k < 16; ++k){
+                v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * _fec_size));
+            }
+            transpose_16x16_epi8(v);
+            int8_t* dst = _out + i * SIZEOF_SIMD + h;
+            for(int k = 0; k < 16; ++k){
+                _mm_store_si128(reinterpret_cast<__m128i*>(dst + k * SIZEOF_SIMD), v[k]);
+            }
+        }
+    }
+    for(; i < _fec_size; ++i){
+        for(int k = 0; k < SIZEOF_SIMD; ++k) _out[i * SIZEOF_SIMD + k] = _in[k * _fec_size + i];
+    }
+}
+//------------------------------------------------------------------------------------------
+void llr_demapper::fec_frame_done(int _plp_id, l1_postsignalling &_l1_post, int _fec_size)
+{
+    out += _fec_size;
+    idx_plp_simd[blocks] = _plp_id;
+    ++blocks;
+    if(blocks == SIZEOF_SIMD) {
+        TRACE_SCOPE(TRACE_FEC_BATCH, trace_batch);
+        ++trace_batch;
+        blocks = 0;
+        int len_out = _fec_size * SIZEOF_SIMD;
+        lane_interleave(_fec_size, &buffer_llr[0], &buffer_out[0]);
+        emit soft_multiplexer_de_twist(idx_plp_simd, _l1_post, len_out, buffer_out);
+        out = &buffer_llr[0];
+        ++nqueued_frames;
+        receiver_metrics::instance().set(METRIC_DEMAPPER_QUEUE, nqueued_frames);
     }
 }
 //------------------------------------------------------------------------------------------
@@ -120,631 +577,202 @@ void llr_demapper::execute(int _ti_block_size,
 {
     mutex_in->lock();
     std::vector<complex> ua_in;
+    std::vector<uint8_t> csi_in;
     const bool shifted = fifo.shift(ua_in);
+    if(shifted) fifo_csi.shift(csi_in);
     mutex_in->unlock();
     if(!shifted)
         return;
+    TRACE_SCOPE(TRACE_LLR_DEMAPPER, trace_item);
+    ++trace_item;
     if(nqueued_frames<nqueued_max)
     {
         int plp_id = _plp_id;
         l1_postsignalling &l1_post = _l1_post;
         int len_in = _ti_block_size;
         complex* in = get_aligned(&ua_in[0], alignment);;
+        const uint8_t* csi = csi_in.data();
         switch(l1_post.plp[plp_id].plp_mod){
         case MOD_64QAM:
-            qam64(plp_id, l1_post, len_in, in);
+            qam64(plp_id, l1_post, len_in, in, csi);
             break;
         case MOD_256QAM:
-            qam256(plp_id, l1_post, len_in, in);
+            qam256(plp_id, l1_post, len_in, in, csi);
             break;
         case MOD_16QAM:
-            qam16(plp_id, l1_post, len_in, in);
+            qam16(plp_id, l1_post, len_in, in, csi);
             break;
         case MOD_QPSK:
-            qpsk(plp_id, l1_post, len_in, in);
+            qpsk(plp_id, l1_post, len_in, in, csi);
             break;
         default:
             break;
         }
     }else{
-        //signal queue overflow
+        receiver_metrics::instance().add(METRIC_DEMAPPER_DROPPED);
     }
     mutex_in->lock();
     fifo.release(ua_in);
+    fifo_csi.release(csi_in);
     mutex_in->unlock();
 }
 //------------------------------------------------------------------------------------------
-void llr_demapper::qpsk(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in)
+
+void llr_demapper::qpsk(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in,
+                        const uint8_t* _csi)
 {
     int plp_id = _plp_id;
-    l1_postsignalling l1_post = _l1_post;
+    l1_postsignalling &l1_post = _l1_post;
     int len_in = _len_in;
-    bool derotate = false;
-    if(l1_post.plp[plp_id].plp_rotation != 0) derotate = true;
     dvbt2_fectype_t fec_type = static_cast<dvbt2_fectype_t>(l1_post.plp[plp_id].plp_fec_type);
     int fec_size = FEC_SIZE_NORMAL;
     if(fec_type == FECFRAME_SHORT) fec_size = FEC_SIZE_SHORT;
-    int idx_out = 0;
-    if(swap_buffer) out = &buffer_a[0];
-    else out = &buffer_b[0];
-    float sum_s = 0;
-    float sum_e = 0;
-    float snr, precision;
-    if(derotate) {
-        for(int i = 0; i < len_in; ++i) _in[i] *=  derotate_qpsk;
-    }
-    complex in;
+    int cells_per_fec_block = fec_size / 2;
+    if(blocks == 0) out = &buffer_llr[0];
+    const bool demap_2d = enabled_demap_2d && l1_post.plp[plp_id].plp_rotation != 0;
+    if(l1_post.plp[plp_id].plp_rotation != 0) derotate_cell(len_in, _in, derotate_qpsk);
     //hard demap
-    for(int i = 0; i < 2048; ++i) {
-        complex s, e;
-        in = _in[i];
-        if(in.real() > 0)s.real(NORM_FACTOR_QPSK);
-        else s.real(-NORM_FACTOR_QPSK);
-        if(in.imag() > 0)s.imag(NORM_FACTOR_QPSK);
-        else s.imag(-NORM_FACTOR_QPSK);
-        e = in - s;
-        sum_s += std::norm(s);
-        sum_e += std::norm(e);
-    }
-    snr = 10.0f * std::log10(sum_s / sum_e);
+    float sum_s, sum_e;
+    hard_demap(len_in, _in, _csi, NORM_FACTOR_QPSK, 1.0f, sum_s, sum_e);
+    float snr = 10.0f * std::log10(sum_s / sum_e);
     snr_f += (snr - snr_f) * SNR_ALFA;
     emit signal_noise_ratio(snr_f);
-    precision = 8.0f * NORM_FACTOR_QPSK * sum_s / sum_e;
-    //soft demap
-    for(int i = 0; i < len_in; ++i) {
-        complex in;
-        in = _in[i];
-        out[idx_out++] = quantize(precision, in.real());
-        out[idx_out++] = quantize(precision, in.imag());
-        if(idx_out == fec_size){
-            idx_out = 0;
-            out += fec_size;
-            idx_plp_simd[blocks] = plp_id;
-            ++blocks;
-            if(blocks == SIZEOF_SIMD) {
-                blocks = 0;
-                int len_out = fec_size * SIZEOF_SIMD;
-                if(swap_buffer) {
-                    swap_buffer = false;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_a);
-                    out = &buffer_b[0];
-                }
-                else {
-                    swap_buffer = true;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_b);
-                    out = &buffer_a[0];
-                }
-                ++nqueued_frames;
-            }
-        }
+    receiver_metrics::instance().set(METRIC_SNR, static_cast<double>(snr_f));
+    //soft demap, no bit interleaving for QPSK
+    float precision = 8.0f * NORM_FACTOR_QPSK * sum_s / sum_e;
+    for(int i = 0; i + cells_per_fec_block <= len_in; i += cells_per_fec_block) {
+        if(demap_2d) rotated_demap<2>(cells_per_fec_block, _in + i, _csi + 2 * i, ROT_QPSK, NORM_FACTOR_QPSK,
+                                      precision, out);
+        else soft_demap<2>(cells_per_fec_block, _in + i, _csi + 2 * i, precision, nullptr, out);
+        fec_frame_done(plp_id, l1_post, fec_size);
     }
 }
 //------------------------------------------------------------------------------------------
-void llr_demapper::qam16(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in)
+void llr_demapper::qam16(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in,
+                         const uint8_t* _csi)
 {
     int plp_id = _plp_id;
-    l1_postsignalling l1_post = _l1_post;
+    l1_postsignalling &l1_post = _l1_post;
     int len_in = _len_in;
-    bool derotate = false;
-    if(l1_post.plp[plp_id].plp_rotation != 0) derotate = true;
     dvbt2_fectype_t fec_type = static_cast<dvbt2_fectype_t>(l1_post.plp[plp_id].plp_fec_type);
     dvbt2_code_rate_t code_rate = static_cast<dvbt2_code_rate_t>(l1_post.plp[plp_id].plp_cod);
     int fec_size;
-    int idx_out = 0;
-    if(blocks == 0){
-        if(swap_buffer) out = &buffer_a[0];
-        else out = &buffer_b[0];
-    }
-    if(derotate){
-        for(int i = 0; i < len_in; ++i) _in[i] *=  derotate_qam16;
-    }
-    //hard demap
-    float sum_s = 0;
-    float sum_e = 0;
-    float snr;
-    complex in;
-    //hard demap
-    for(int i = 0; i < len_in; ++i) {
-        complex s, e;
-        in = _in[i];
-        if(in.real() > 0){
-            if(in.real() > norm_16_x2) s.real(norm_16_x3);
-            else s.real(norm_16_x1);
-        }
-        else{
-            if(in.real() < -norm_16_x2) s.real(-norm_16_x3);
-            else s.real(-norm_16_x1);
-        }
-        if(in.imag() > 0){
-            if(in.imag() > norm_16_x2) s.imag(norm_16_x3);
-            else s.imag(norm_16_x1);
-        }
-        else{
-            if(in.imag() < -norm_16_x2) s.imag(-norm_16_x3);
-            else s.imag(-norm_16_x1);
-        }
-        e = in - s;
-        sum_s += std::norm(s);
-        sum_e += std::norm(e);
-    }
-    snr = 20.0f * std::log10(sum_s / sum_e);
-    snr_f += (snr - snr_f) * SNR_ALFA;
-    emit signal_noise_ratio(snr_f);
-    //soft demap
-    int* address;
-    int* address_begin = nullptr;
-    float precision;
-    float ALIGNED_(32) llr_bits_0_1[8] ;
-    float ALIGNED_(32) llr_bits_2_3[8] ;
-    __m256  v_precision, v_norm_x2, signbits;
-    __m256 v_in, v_mul, v_sub, v_abs_in, v_round;
-    precision = 8.0f * NORM_FACTOR_QAM16 * sum_s / sum_e;
-    v_precision = _mm256_set1_ps(precision);
-    v_norm_x2 = _mm256_set1_ps(norm_16_x2);
-    signbits = _mm256_set1_ps(-0.0f);
+    const twist_t* twist;
     if(fec_type == FEC_FRAME_NORMAL) {
         fec_size = FEC_SIZE_NORMAL;
-        if(code_rate == C3_5) address = address_qam16_fecnormal_3_5.data();
-        else address = address_qam16_fecnormal.data();
+        if(code_rate == C3_5) twist = &twist_qam16_fecnormal_3_5;
+        else twist = &twist_qam16_fecnormal;
     }
     else{
         fec_size = FEC_SIZE_SHORT;
-        address = address_qam16_fecshort.data();
+        twist = &twist_qam16_fecshort;
     }
-    address_begin = address;
-
-    for(int i = 0; i < len_in; i += 4) {
-
-        float* in = reinterpret_cast<float*>(_in + i);
-        v_in = _mm256_load_ps(in);
-        v_mul = _mm256_mul_ps(v_in, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_0_1, v_round);
-
-        v_abs_in = _mm256_andnot_ps(signbits, v_in);
-        v_sub = _mm256_sub_ps(v_abs_in, v_norm_x2);
-        v_mul = _mm256_mul_ps(v_sub, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_2_3, v_round);
-
-        int n = 0;
-        for(int i = 0; i < 2; ++i){
-            int even_1 = n;
-            int odd_1  = n + 1;
-            int even_2 = n + 2;
-            int odd_2  = n + 3;
-
-            out[address[0]] = static_cast<int8_t>(llr_bits_0_1[even_1]);
-            out[address[1]] = static_cast<int8_t>(llr_bits_0_1[odd_1]);
-            out[address[2]] = static_cast<int8_t>(llr_bits_2_3[even_1]);
-            out[address[3]] = static_cast<int8_t>(llr_bits_2_3[odd_1]);
-            out[address[4]] = static_cast<int8_t>(llr_bits_0_1[even_2]);
-            out[address[5]] = static_cast<int8_t>(llr_bits_0_1[odd_2]);
-            out[address[6]] = static_cast<int8_t>(llr_bits_2_3[even_2]);
-            out[address[7]] = static_cast<int8_t>(llr_bits_2_3[odd_2]);
-
-            n += 4;
-            address += 8;
-        }
-        idx_out += 16;
-        if(idx_out == fec_size) {
-            idx_out = 0;
-            address = address_begin;
-            out += fec_size;
-            idx_plp_simd[blocks] = plp_id;
-            ++blocks;
-            if(blocks == SIZEOF_SIMD){
-                blocks = 0;
-                int len_out = fec_size * SIZEOF_SIMD;
-                if(swap_buffer) {
-                    swap_buffer = false;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_a);
-                    out = &buffer_b[0];
-                }
-                else {
-                    swap_buffer = true;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_b);
-                    out = &buffer_a[0];
-                }
-                ++nqueued_frames;
-            }
-        }
+    int cells_per_fec_block = fec_size / 4;
+    if(blocks == 0) out = &buffer_llr[0];
+    const bool demap_2d = enabled_demap_2d && l1_post.plp[plp_id].plp_rotation != 0;
+    if(l1_post.plp[plp_id].plp_rotation != 0) derotate_cell(len_in, _in, derotate_qam16);
+    //hard demap
+    float sum_s, sum_e;
+    hard_demap(len_in, _in, _csi, NORM_FACTOR_QAM16, 3.0f, sum_s, sum_e);
+    float snr = 20.0f * std::log10(sum_s / sum_e);
+    snr_f += (snr - snr_f) * SNR_ALFA;
+    emit signal_noise_ratio(snr_f);
+    receiver_metrics::instance().set(METRIC_SNR, static_cast<double>(snr_f));
+    //soft demap
+    float precision = 8.0f * NORM_FACTOR_QAM16 * sum_s / sum_e;
+    const float threshold[1] = {NORM_FACTOR_QAM16 * 2.0f};
+    for(int i = 0; i + cells_per_fec_block <= len_in; i += cells_per_fec_block) {
+        if(demap_2d) rotated_demap<4>(cells_per_fec_block, _in + i, _csi + 2 * i, ROT_QAM16, NORM_FACTOR_QAM16,
+                                      precision, llr_cell.data());
+        else soft_demap<4>(cells_per_fec_block, _in + i, _csi + 2 * i, precision, threshold, llr_cell.data());
+        bit_deinterleave(*twist, llr_cell.data(), out);
+        fec_frame_done(plp_id, l1_post, fec_size);
     }
 }
 //------------------------------------------------------------------------------------------
-void llr_demapper::qam64(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in)
+void llr_demapper::qam64(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in,
+                         const uint8_t* _csi)
 {
     int plp_id = _plp_id;
     l1_postsignalling &l1_post = _l1_post;
     int len_in = _len_in;
-    bool derotate = false;
-    if(l1_post.plp[plp_id].plp_rotation != 0) derotate = true;
     dvbt2_fectype_t fec_type = static_cast<dvbt2_fectype_t>(l1_post.plp[plp_id].plp_fec_type);
     dvbt2_code_rate_t code_rate = static_cast<dvbt2_code_rate_t>(l1_post.plp[plp_id].plp_cod);
     int fec_size;
-    int idx_out = 0;
-    if(blocks == 0) {
-        if(swap_buffer) out = &buffer_a[0];
-        else out = &buffer_b[0];
-    }
-    if(derotate) {
-        for(int i = 0; i < len_in; ++i) _in[i] *=  derotate_qam64;
-    }
-    //hard demap
-    float sum_s = 0;
-    float sum_e = 0;
-    float snr;
-    complex in;
-    for(int i = 0; i < len_in; ++i) {
-        complex s, e;
-        in = _in[i];
-        if(in.real() > 0){
-            if(in.real() > norm_64_x4){
-                if(in.real() > norm_64_x6)s.real(norm_64_x7);
-                else s.real(norm_64_x5);
-            }
-            else{
-                if(in.real() > norm_64_x2)s.real(norm_64_x3);
-                else s.real(norm_64_x1);
-            }
-        }
-        else{
-            if(in.real() < -norm_64_x4){
-                if(in.real() > norm_64_x6)s.real(-norm_64_x7);
-                else s.real(-norm_64_x5);
-            }
-            else{
-                if(in.real() < -norm_64_x2)s.real(-norm_64_x3);
-                else s.real(-norm_64_x1);
-            }
-        }
-        if(in.imag() > 0){
-            if(in.imag() > norm_64_x4){
-                if(in.imag() > norm_64_x6)s.imag(norm_64_x7);
-                else s.imag(norm_64_x5);
-            }
-            else{
-                if(in.imag() > norm_64_x2)s.imag(norm_64_x3);
-                else s.imag(norm_64_x1);
-            }
-        }
-        else{
-            if(in.imag() < -norm_64_x4){
-                if(in.imag() > norm_64_x6)s.imag(-norm_64_x7);
-                else s.imag(-norm_64_x5);
-            }
-            else{
-                if(in.imag() < -norm_64_x2)s.imag(-norm_64_x3);
-                else s.imag(-norm_64_x1);
-            }
-        }
-        e = in - s;
-        sum_s += std::norm(s);
-        sum_e += std::norm(e);
-    }
-    snr = 20.0f * std::log10(sum_s / sum_e);
-    snr_f += (snr - snr_f) * SNR_ALFA;
-    emit signal_noise_ratio(snr_f);
-    //soft demap
-    int* address;
-    int* address_begin = nullptr;
-    float precision;
-    float ALIGNED_(32) llr_bits_0_1[8];
-    float ALIGNED_(32) llr_bits_2_3[8];
-    float ALIGNED_(32) llr_bits_4_5[8];
-    __m256  v_precision, v_norm_x4, v_norm_x2, signbits;
-    __m256 v_in, v_mul, v_sub, v_abs_in, v_abs_in_sub_x, v_round;
-    precision = 8.0f * NORM_FACTOR_QAM64 * sum_s / sum_e;
-    v_precision = _mm256_set1_ps(precision);
-    v_norm_x4 = _mm256_set1_ps(norm_64_x4);
-    v_norm_x2 = _mm256_set1_ps(norm_64_x2);
-    signbits = _mm256_set1_ps(-0.0f);
+    const twist_t* twist;
     if(fec_type == FEC_FRAME_NORMAL) {
         fec_size = FEC_SIZE_NORMAL;
-        if(code_rate == C3_5) address = address_qam64_fecnormal_3_5.data();
-        else address = address_qam64_fecnormal.data();
+        if(code_rate == C3_5) twist = &twist_qam64_fecnormal_3_5;
+        else twist = &twist_qam64_fecnormal;
     }
     else{
         fec_size = FEC_SIZE_SHORT;
-        address = address_qam64_fecshort.data();
+        twist = &twist_qam64_fecshort;
     }
-    address_begin = address;
-
-    for(int i = 0; i < len_in; i += 4) {
-
-        float* in = reinterpret_cast<float*>(_in + i);
-        v_in = _mm256_load_ps(in);
-        v_mul = _mm256_mul_ps(v_in, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_0_1, v_round);
-
-        v_abs_in = _mm256_andnot_ps(signbits, v_in);
-        v_sub = _mm256_sub_ps(v_abs_in, v_norm_x4);
-        v_mul = _mm256_mul_ps(v_sub, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_2_3, v_round);
-
-        v_abs_in_sub_x = _mm256_andnot_ps(signbits, v_sub);
-        v_sub = _mm256_sub_ps(v_abs_in_sub_x, v_norm_x2);
-        v_mul = _mm256_mul_ps(v_sub, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_4_5, v_round);
-
-        int n = 0;
-        for(int i = 0; i < 2; ++i) {
-            int even_1 = n;
-            int odd_1  = n + 1;
-            int even_2 = n + 2;
-            int odd_2  = n + 3;
-
-            out[address[0]] = static_cast<int8_t>(llr_bits_0_1[even_1]);
-            out[address[1]] = static_cast<int8_t>(llr_bits_0_1[odd_1]);
-            out[address[2]] = static_cast<int8_t>(llr_bits_2_3[even_1]);
-            out[address[3]] = static_cast<int8_t>(llr_bits_2_3[odd_1]);
-            out[address[4]] = static_cast<int8_t>(llr_bits_4_5[even_1]);
-            out[address[5]] = static_cast<int8_t>(llr_bits_4_5[odd_1]);
-            out[address[6]] = static_cast<int8_t>(llr_bits_0_1[even_2]);
-            out[address[7]] = static_cast<int8_t>(llr_bits_0_1[odd_2]);
-            out[address[8]] = static_cast<int8_t>(llr_bits_2_3[even_2]);
-            out[address[9]] = static_cast<int8_t>(llr_bits_2_3[odd_2]);
-            out[address[10]] = static_cast<int8_t>(llr_bits_4_5[even_2]);
-            out[address[11]] = static_cast<int8_t>(llr_bits_4_5[odd_2]);
-
-            n += 4;
-            address += 12;
-        }
-        idx_out += 24;
-        if(idx_out == fec_size) {
-            idx_out = 0;
-            address = address_begin;
-            out += fec_size;
-            idx_plp_simd[blocks] = plp_id;
-            ++blocks;
-            if(blocks == SIZEOF_SIMD) {
-                blocks = 0;
-                int len_out = fec_size * SIZEOF_SIMD;
-                if(swap_buffer) {
-                    swap_buffer = false;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_a);
-                    out = &buffer_b[0];
-                }
-                else {
-                    swap_buffer = true;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_b);
-                    out = &buffer_a[0];
-                }
-                ++nqueued_frames;
-            }
-        }
+    int cells_per_fec_block = fec_size / 6;
+    if(blocks == 0) out = &buffer_llr[0];
+    const bool demap_2d = enabled_demap_2d && l1_post.plp[plp_id].plp_rotation != 0;
+    if(l1_post.plp[plp_id].plp_rotation != 0) derotate_cell(len_in, _in, derotate_qam64);
+    //hard demap
+    float sum_s, sum_e;
+    hard_demap(len_in, _in, _csi, NORM_FACTOR_QAM64, 7.0f, sum_s, sum_e);
+    float snr = 20.0f * std::log10(sum_s / sum_e);
+    snr_f += (snr - snr_f) * SNR_ALFA;
+    emit signal_noise_ratio(snr_f);
+    receiver_metrics::instance().set(METRIC_SNR, static_cast<double>(snr_f));
+    //soft demap
+    float precision = 8.0f * NORM_FACTOR_QAM64 * sum_s / sum_e;
+    const float threshold[2] = {NORM_FACTOR_QAM64 * 4.0f, NORM_FACTOR_QAM64 * 2.0f};
+    for(int i = 0; i + cells_per_fec_block <= len_in; i += cells_per_fec_block) {
+        if(demap_2d) rotated_demap<6>(cells_per_fec_block, _in + i, _csi + 2 * i, ROT_QAM64, NORM_FACTOR_QAM64,
+                                      precision, llr_cell.data());
+        else soft_demap<6>(cells_per_fec_block, _in + i, _csi + 2 * i, precision, threshold, llr_cell.data());
+        bit_deinterleave(*twist, llr_cell.data(), out);
+        fec_frame_done(plp_id, l1_post, fec_size);
     }
 }
 //------------------------------------------------------------------------------------------
-void llr_demapper::qam256(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in)
+void llr_demapper::qam256(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in,
+                          const uint8_t* _csi)
 {
     int plp_id = _plp_id;
-    l1_postsignalling l1_post = _l1_post;
+    l1_postsignalling &l1_post = _l1_post;
     int len_in = _len_in;
-    bool derotate = false;
-    if(l1_post.plp[plp_id].plp_rotation != 0) derotate = true;
     dvbt2_fectype_t fec_type = static_cast<dvbt2_fectype_t>(l1_post.plp[plp_id].plp_fec_type);
     dvbt2_code_rate_t code_rate = static_cast<dvbt2_code_rate_t>(l1_post.plp[plp_id].plp_cod);
     int fec_size;
-    int idx_out = 0;
-    if(blocks == 0) {
-        if(swap_buffer) out = &buffer_a[0];
-        else out = &buffer_b[0];
-    }
-    if(derotate) {
-        for(int i = 0; i < len_in; ++i) _in[i] *=  derotate_qam256;
-    }
-    //hard demap
-    float sum_s = 0;
-    float sum_e = 0;
-    float snr;
-    //hard demap
-    complex in;
-    for(int i = 0; i < len_in; ++i) {
-        complex s, e;
-        in = _in[i];
-        if(in.real() > 0){
-            if(in.real() > norm_256_x8){
-                if(in.real() > norm_256_x12){
-                    if(in.real() > norm_256_x14) s.real(norm_256_x15);
-                    else s.real(norm_256_x13);
-                }
-                else{
-                    if(in.real() > norm_256_x10) s.real(norm_256_x11);
-                    else s.real(norm_256_x9);
-                }
-            }
-            else{
-                if(in.real() > norm_256_x4){
-                    if(in.real() > norm_256_x6) s.real(norm_256_x7);
-                    else s.real(norm_256_x5);
-                }
-                else{
-                    if(in.real() > norm_256_x2) s.real(norm_256_x3);
-                    else s.real(norm_256_x1);
-                }
-            }
-        }
-        else {
-            if(in.real() < -norm_256_x8){
-                if(in.real() < -norm_256_x12){
-                    if(in.real() < -norm_256_x14) s.real(-norm_256_x15);
-                    else s.real(-norm_256_x13);
-                }
-                else{
-                    if(in.real() < -norm_256_x10) s.real(-norm_256_x11);
-                    else s.real(-norm_256_x9);
-                }
-            }
-            else{
-                if(in.real() < -norm_256_x4){
-                    if(in.real() < -norm_256_x6) s.real(-norm_256_x7);
-                    else s.real(-norm_256_x5);
-                }
-                else{
-                    if(in.real() < -norm_256_x2) s.real(-norm_256_x3);
-                    else s.real(-norm_256_x1);
-                }
-            }
-        }
-        if(in.imag() > 0) {
-            if(in.imag() > norm_256_x8){
-                if(in.imag() > norm_256_x12){
-                    if(in.imag() > norm_256_x14) s.imag(norm_256_x15);
-                    else s.imag(norm_256_x13);
-                }
-                else{
-                    if(in.imag() > norm_256_x10) s.imag(norm_256_x11);
-                    else s.imag(norm_256_x9);
-                }
-            }
-            else{
-                if(in.imag() > norm_256_x4){
-                    if(in.imag() > norm_256_x6) s.imag(norm_256_x7);
-                    else s.imag(norm_256_x5);
-                }
-                else{
-                    if(in.imag() > norm_256_x2) s.imag(norm_256_x3);
-                    else s.imag(norm_256_x1);
-                }
-            }
-        }
-        else {
-            if(in.imag() < -norm_256_x8){
-                if(in.imag() < -norm_256_x12){
-                    if(in.imag() < -norm_256_x14) s.imag(-norm_256_x15);
-                    else s.imag(-norm_256_x13);
-                }
-                else{
-                    if(in.imag() < -norm_256_x10) s.imag(-norm_256_x11);
-                    else s.imag(-norm_256_x9);
-                }
-            }
-            else{
-                if(in.imag() < -norm_256_x4){
-                    if(in.imag() < -norm_256_x6) s.imag(-norm_256_x7);
-                    else s.imag(-norm_256_x5);
-                }
-                else{
-                    if(in.imag() < -norm_256_x2) s.imag(-norm_256_x3);
-                    else s.imag(-norm_256_x1);
-                }
-            }
-        }
-        e = in - s;
-        sum_s += std::norm(s);
-        sum_e += std::norm(e);
-    }
-    snr = 20.0f * std::log10(sum_s / sum_e);
-    snr_f += (snr - snr_f) * SNR_ALFA;
-    emit signal_noise_ratio(snr_f);
-    //soft demap
-    int* address;
-    int* address_begin = nullptr;
-    float precision;
-    float ALIGNED_(32) llr_bits_0_1[8];
-    float ALIGNED_(32) llr_bits_2_3[8];
-    float ALIGNED_(32) llr_bits_4_5[8];
-    float ALIGNED_(32) llr_bits_6_7[8];
-    __m256 v_precision, v_norm_x8, v_norm_x4, v_norm_x2, signbits;
-    __m256 v_in, v_mul, v_sub, v_abs_in, v_abs_in_sub_x, v_round;
-    precision = 8.0f * NORM_FACTOR_QAM256 * sum_s / sum_e;
-    v_precision = _mm256_set1_ps(precision);
-    v_norm_x8 = _mm256_set1_ps(norm_256_x8);
-    v_norm_x4 = _mm256_set1_ps(norm_256_x4);
-    v_norm_x2 = _mm256_set1_ps(norm_256_x2);
-    signbits = _mm256_set1_ps(-0.0f);
+    const twist_t* twist;
     if(fec_type == FEC_FRAME_NORMAL) {
         fec_size = FEC_SIZE_NORMAL;
-        if(code_rate == C3_5) address = address_qam256_fecnormal_3_5.data();
-        else if (code_rate == C2_3) address = address_qam256_fecnormal_2_3.data();
-        else address = address_qam256_fecnormal.data();
+        if(code_rate == C3_5) twist = &twist_qam256_fecnormal_3_5;
+        else if (code_rate == C2_3) twist = &twist_qam256_fecnormal_2_3;
+        else twist = &twist_qam256_fecnormal;
     }
     else{
         fec_size = FEC_SIZE_SHORT;
-        address = address_qam256_fecshort.data();
+        twist = &twist_qam256_fecshort;
     }
-    address_begin = address;
-
-    for(int i = 0; i < len_in; i += 4) {
-
-        float* in = reinterpret_cast<float*>(_in + i);
-        v_in = _mm256_load_ps(in);
-        v_mul = _mm256_mul_ps(v_in, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_0_1, v_round);
-
-        v_abs_in = _mm256_andnot_ps(signbits, v_in);
-        v_sub = _mm256_sub_ps(v_abs_in, v_norm_x8);
-        v_mul = _mm256_mul_ps(v_sub, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_2_3, v_round);
-
-        v_abs_in_sub_x = _mm256_andnot_ps(signbits, v_sub);
-        v_sub = _mm256_sub_ps(v_abs_in_sub_x, v_norm_x4);
-        v_mul = _mm256_mul_ps(v_sub, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_4_5, v_round);
-
-        v_abs_in_sub_x = _mm256_andnot_ps(signbits, v_sub);
-        v_sub = _mm256_sub_ps(v_abs_in_sub_x, v_norm_x2);
-        v_mul = _mm256_mul_ps(v_sub, v_precision);
-        v_round = _mm256_round_ps(v_mul ,_MM_FROUND_TO_NEAREST_INT |_MM_FROUND_NO_EXC);
-        _mm256_store_ps(llr_bits_6_7, v_round);
-
-        int n = 0;
-        for(int i = 0; i < 2; ++i){
-            int even_1 = n;
-            int odd_1  = n + 1;
-            int even_2 = n + 2;
-            int odd_2  = n + 3;
-
-            out[address[0]] = static_cast<int8_t>(llr_bits_0_1[even_1]);
-            out[address[1]] = static_cast<int8_t>(llr_bits_0_1[odd_1]);
-            out[address[2]] = static_cast<int8_t>(llr_bits_2_3[even_1]);
-            out[address[3]] = static_cast<int8_t>(llr_bits_2_3[odd_1]);
-            out[address[4]] = static_cast<int8_t>(llr_bits_4_5[even_1]);
-            out[address[5]] = static_cast<int8_t>(llr_bits_4_5[odd_1]);
-            out[address[6]] = static_cast<int8_t>(llr_bits_6_7[even_1]);
-            out[address[7]] = static_cast<int8_t>(llr_bits_6_7[odd_1]);
-            out[address[8]] = static_cast<int8_t>(llr_bits_0_1[even_2]);
-            out[address[9]] = static_cast<int8_t>(llr_bits_0_1[odd_2]);
-            out[address[10]] = static_cast<int8_t>(llr_bits_2_3[even_2]);
-            out[address[11]] = static_cast<int8_t>(llr_bits_2_3[odd_2]);
-            out[address[12]] = static_cast<int8_t>(llr_bits_4_5[even_2]);
-            out[address[13]] = static_cast<int8_t>(llr_bits_4_5[odd_2]);
-            out[address[14]] = static_cast<int8_t>(llr_bits_6_7[even_2]);
-            out[address[15]] = static_cast<int8_t>(llr_bits_6_7[odd_2]);
-
-            n += 4;
-            address += 16;
-        }
-        idx_out += 32;
-        if(idx_out == fec_size){
-            idx_out = 0;
-            address = address_begin;
-            out += fec_size;
-            idx_plp_simd[blocks] = plp_id;
-            ++blocks;
-            if(blocks == SIZEOF_SIMD){
-                blocks = 0;
-                int len_out = fec_size * SIZEOF_SIMD;
-                if(swap_buffer) {
-                    swap_buffer = false;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_a);
-                    out = &buffer_b[0];
-                }
-                else {
-                    swap_buffer = true;
-                    emit soft_multiplexer_de_twist(idx_plp_simd, l1_post, len_out, buffer_b);
-                    out = &buffer_a[0];
-                }
-                ++nqueued_frames;
-            }
-        }
+    int cells_per_fec_block = fec_size / 8;
+    if(blocks == 0) out = &buffer_llr[0];
+    const bool demap_2d = enabled_demap_2d && l1_post.plp[plp_id].plp_rotation != 0;
+    if(l1_post.plp[plp_id].plp_rotation != 0) derotate_cell(len_in, _in, derotate_qam256);
+    //hard demap
+    float sum_s, sum_e;
+    hard_demap(len_in, _in, _csi, NORM_FACTOR_QAM256, 15.0f, sum_s, sum_e);
+    float snr = 20.0f * std::log10(sum_s / sum_e);
+    snr_f += (snr - snr_f) * SNR_ALFA;
+    emit signal_noise_ratio(snr_f);
+    receiver_metrics::instance().set(METRIC_SNR, static_cast<double>(snr_f));
+    //soft demap
+    float precision = 8.0f * NORM_FACTOR_QAM256 * sum_s / sum_e;
+    const float threshold[3] = {NORM_FACTOR_QAM256 * 8.0f, NORM_FACTOR_QAM256 * 4.0f,
+                                NORM_FACTOR_QAM256 * 2.0f};
+    for(int i = 0; i + cells_per_fec_block <= len_in; i += cells_per_fec_block) {
+        if(demap_2d) rotated_demap<8>(cells_per_fec_block, _in + i, _csi + 2 * i, ROT_QAM256, NORM_FACTOR_QAM256,
+                                      precision, llr_cell.data());
+        else soft_demap<8>(cells_per_fec_block, _in + i, _csi + 2 * i, precision, threshold, llr_cell.data());
+        bit_deinterleave(*twist, llr_cell.data(), out);
+        fec_frame_done(plp_id, l1_post, fec_size);
     }
 }
 //------------------------------------------------------------------------------------------
@@ -756,6 +784,11 @@ inline int8_t llr_demapper::quantize(float &_precision, float _in)
     return out;
 }
 //------------------------------------------------------------------------------------------
+void llr_demapper::set_demap_2d(bool mode)
+{
+    enabled_demap_2d = mode;
+}
+//------------------------------------------------------------------------------------------
 void llr_demapper::stop()
 {
     emit finished();
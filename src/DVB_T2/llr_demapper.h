@@ -22,6 +22,7 @@
 #include <complex>
 #include <vector>
 #include <array>
+#include <immintrin.h>
 
 #include "dvbt2_definition.h"
 #include "ldpc_decoder.h"
@@ -37,6 +38,7 @@ public:
     ~llr_demapper();
     ldpc_decoder* decoder;
     vector_fifo<complex> fifo{};
+    vector_fifo<uint8_t> fifo_csi{};    // channel state weights of the cells in fifo
 
 signals:
     void signal_noise_ratio(float _snr);
@@ -49,6 +51,7 @@ public slots:
                  int _plp_id, l1_postsignalling _l1_post);
     void stop();
     void ldpc_frame_finished();
+    void set_demap_2d(bool mode);
 
 private:
     QWaitCondition* signal_in;
@@ -57,10 +60,8 @@ private:
     QMutex* mutex_in;
     QMutex* mutex_out;
     l1_postsignalling l1_post;
-    fec_frame buffer_a{};
-    fec_frame buffer_b{};
-    bool swap_buffer_start = true;
-    bool swap_buffer = true;
+    fec_frame buffer_llr{};     // SIZEOF_SIMD FEC blocks one after another in bit order
+    fec_frame buffer_out{};     // the same soft bits interleaved by lane for the LDPC decoder
     int blocks{0};
     int nqueued_frames{0};
     float snr_f{0.f};
@@ -68,6 +69,9 @@ private:
     constexpr static int nqueued_max{64};
     constexpr static int alignment = 64;
     int8_t* out{nullptr};
+    bool enabled_demap_2d{false};
+    int64_t trace_item{0};      // TI blocks in
+    int64_t trace_batch{0};     // FEC batches out
     idx_plp_simd_t idx_plp_simd{};
     complex derotate_qpsk;
     complex derotate_qam16;
@@ -90,49 +94,48 @@ private:
     const int demux_256_fec_size_normal_3_5[16] = {4, 6, 0, 2, 3, 14, 12, 10, 7, 5, 8, 1, 15, 9, 11, 13};
     const int demux_256_fec_size_normal_2_3[16] = {3, 15, 1, 7, 4, 11, 5, 0, 12, 2, 9, 14, 13, 6, 8, 10};
 
-    std::array<int,FEC_SIZE_SHORT> address_qam16_fecshort;
-    std::array<int,FEC_SIZE_NORMAL> address_qam16_fecnormal;
-    std::array<int,FEC_SIZE_NORMAL> address_qam16_fecnormal_3_5;
-    std::array<int,FEC_SIZE_SHORT> address_qam64_fecshort;
-    std::array<int,FEC_SIZE_NORMAL> address_qam64_fecnormal;
-    std::array<int,FEC_SIZE_NORMAL> address_qam64_fecnormal_3_5;
-    std::array<int,FEC_SIZE_SHORT> address_qam256_fecshort;
-    std::array<int,FEC_SIZE_NORMAL> address_qam256_fecnormal;
-    std::array<int,FEC_SIZE_NORMAL> address_qam256_fecnormal_3_5;
-    std::array<int,FEC_SIZE_NORMAL> address_qam256_fecnormal_2_3;
+    // Column twist deinterleaver and demultiplexer as a transposition: bit n of the cell
+    // group g (row bits per group) goes to dst[n] + (g + start[n]) % column.
+    struct twist_t{
+        int column;
+        int row;
+        int dst[16];
+        int start[16];
+    };
+    twist_t twist_qam16_fecshort;
+    twist_t twist_qam16_fecnormal;
+    twist_t twist_qam16_fecnormal_3_5;
+    twist_t twist_qam64_fecshort;
+    twist_t twist_qam64_fecnormal;
+    twist_t twist_qam64_fecnormal_3_5;
+    twist_t twist_qam256_fecshort;
+    twist_t twist_qam256_fecnormal;
+    twist_t twist_qam256_fecnormal_3_5;
+    twist_t twist_qam256_fecnormal_2_3;
+    constexpr static int twist_tile = 512;
+    alignas(32) std::array<int8_t, FEC_SIZE_NORMAL> llr_cell{};    // soft bits of one FEC block in cell order
+    alignas(16) int8_t shuffle_qam64[3][3][16];
 
-    void address_generator(int _column, int _row, int *_address, const int *_tc, const int *_demux);
+    void twist_generator(int _column, int _row, const int *_tc, const int *_demux, twist_t &_twist);
+    void bit_deinterleave(const twist_t &_twist, const int8_t* _in, int8_t* _out);
+    void derotate_cell(int _len, complex* _cell, complex _derotate);
+    void hard_demap(int _len, const complex* _cell, const uint8_t* _csi, float _norm, float _level_max,
+                    float &_sum_s, float &_sum_e);
+    template<int BITS_PER_CELL>
+    void soft_demap(int _len, const complex* _cell, const uint8_t* _csi, float _precision,
+                    const float* _threshold, int8_t* _out);
+    template<int BITS_PER_CELL>
+    void rotated_demap(int _len, const complex* _cell, const uint8_t* _csi, float _rotation, float _norm,
+                       float _precision, int8_t* _out);
+    template<int LEVELS>
+    inline void store_llr(const __m128i* _llr, int8_t* _out);
+    void lane_interleave(int _fec_size, const int8_t* _in, int8_t* _out);
+    void fec_frame_done(int _plp_id, l1_postsignalling &_l1_post, int _fec_size);
 
-    const float norm_16_x1 = NORM_FACTOR_QAM16;
-    const float norm_16_x2 = NORM_FACTOR_QAM16 * 2.0f;
-    const float norm_16_x3 = NORM_FACTOR_QAM16 * 3.0f;
-    const float norm_64_x1 = NORM_FACTOR_QAM64;
-    const float norm_64_x2 = NORM_FACTOR_QAM64 * 2.0f;
-    const float norm_64_x3 = NORM_FACTOR_QAM64 * 3.0f;
-    const float norm_64_x4 = NORM_FACTOR_QAM64 * 4.0f;
-    const float norm_64_x5 = NORM_FACTOR_QAM64 * 5.0f;
-    const float norm_64_x6 = NORM_FACTOR_QAM64 * 6.0f;
-    const float norm_64_x7 = NORM_FACTOR_QAM64 * 7.0f;
-    const float norm_256_x1 = NORM_FACTOR_QAM256;
-    const float norm_256_x2 = NORM_FACTOR_QAM256 * 2.0f;
-    const float norm_256_x3 = NORM_FACTOR_QAM256 * 3.0f;
-    const float norm_256_x4 = NORM_FACTOR_QAM256 * 4.0f;
-    const float norm_256_x5 = NORM_FACTOR_QAM256 * 5.0f;
-    const float norm_256_x6 = NORM_FACTOR_QAM256 * 6.0f;
-    const float norm_256_x7 = NORM_FACTOR_QAM256 * 7.0f;
-    const float norm_256_x8 = NORM_FACTOR_QAM256 * 8.0f;
-    const float norm_256_x9 = NORM_FACTOR_QAM256 * 9.0f;
-    const float norm_256_x10 = NORM_FACTOR_QAM256 * 10.0f;
-    const float norm_256_x11 = NORM_FACTOR_QAM256 * 11.0f;
-    const float norm_256_x12 = NORM_FACTOR_QAM256 * 12.0f;
-    const float norm_256_x13 = NORM_FACTOR_QAM256 * 13.0f;
-    const float norm_256_x14 = NORM_FACTOR_QAM256 * 14.0f;
-    const float norm_256_x15 = NORM_FACTOR_QAM256 * 15.0f;
-
-    void qpsk(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in);
-    void qam16(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in);
-    void qam64(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in);
-    void qam256(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in);
+    void qpsk(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in, const uint8_t* _csi);
+    void qam16(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in, const uint8_t* _csi);
+    void qam64(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in, const uint8_t* _csi);
+    void qam256(int _plp_id, l1_postsignalling &_l1_post, int _len_in, complex* _in, const uint8_t* _csi);
 
     inline int8_t quantize(float &_precision, float _in);
 };
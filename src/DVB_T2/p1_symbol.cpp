@@ -16,10 +16,40 @@
 
 // #include <QDebug>
 
+#include <immintrin.h>
+
 #include "DSP/fast_math.h"
+#include "acquisition_timeline.h"
 
 #define P1_HERTZ_PER_RADIAN (HERTZ_PER_RADIAN / (P1_LEN << 1))
 
+//-------------------------------------------------------------------------------------------
+static inline __m256 mul(__m256 _a, __m256 _b)
+{
+    __m256 t_re = _mm256_mul_ps(_a, _mm256_moveldup_ps(_b));
+    __m256 t_im = _mm256_mul_ps(_mm256_permute_ps(_a, 0xb1), _mm256_movehdup_ps(_b));
+    return _mm256_addsub_ps(t_re, t_im);
+}
+//-------------------------------------------------------------------------------------------
+// _a * conj(_b)
+static inline __m256 mul_conj(__m256 _a, __m256 _b)
+{
+    const __m256 signbits = _mm256_set1_ps(-0.0f);
+    __m256 t_re = _mm256_mul_ps(_a, _mm256_moveldup_ps(_b));
+    __m256 t_im = _mm256_mul_ps(_mm256_permute_ps(_a, 0xb1), _mm256_movehdup_ps(_b));
+    return _mm256_addsub_ps(t_re, _mm256_xor_ps(t_im, signbits));
+}
+//-------------------------------------------------------------------------------------------
+static inline __m256 load(const complex* _in)
+{
+    return _mm256_loadu_ps(reinterpret_cast<const float*>(_in));
+}
+//-------------------------------------------------------------------------------------------
+static inline void store(complex* _out, __m256 _v)
+{
+    _mm256_storeu_ps(reinterpret_cast<float*>(_out), _v);
+}
+
 //-------------------------------------------------------------------------------------------
 p1_symbol::p1_symbol(QObject *parent) : QObject(parent)
 {
@@ -30,6 +60,11 @@ p1_symbol::p1_symbol(QObject *parent) : QObject(parent)
         fq_shift[i].imag(cos(angle));
         angle += angle_shift;
     }
+    // repeated, a block reads on from any start without wrapping
+    for(int i = P1_FREQUENCY_SHIFT; i < P1_FREQUENCY_SHIFT + len_block + len_pad; i++) {
+        fq_shift[i] = fq_shift[i - P1_FREQUENCY_SHIFT];
+    }
+    reset_buffer();
 
     fft = new fast_fourier_transform;
     in_fft = fft->init(P1_A_PART);
@@ -78,8 +113,6 @@ bool p1_symbol::execute(bool _gain_changed, float _level_detect,
                         dvbt2_parameters &_dvbt2, double &_coarse_freq_offset,
                         bool &_p1_decoded, bool &_reset)
 {
-    static int idx_fq_shift = 0;
-    complex data_sihft, a, b, c, d, in_av_c, in_av_b, out_av_c, out_av_b, out;
     complex* buffer_sym = _buffer_sym;
     int idx_in = _consume;
     int len_in = _len_in;
@@ -89,89 +122,123 @@ bool p1_symbol::execute(bool _gain_changed, float _level_detect,
         begin_threshold = _level_detect * 1.0e+1f;
         end_threshold = 0.5f * begin_threshold;
     }
+    // When the P1 is expected only the window around the peak of the last frame is searched:
+    // the correlator starts just in time for the window and the search ends after it.
+    bool windowed = expected && peak_expected >= 0;
+    const int begin_window = peak_expected - len_window;
+    const int end_window = peak_expected + len_window;
+    const int begin_correlator = begin_window - (P1_LEN - 1);
+    complex* block = line_in + P1_LEN;
     while(idx_in < len_in) {
 
-        complex data = in[idx_in++];
-        p1_buffer.write(data);
+        int len = std::min(len_block, len_in - idx_in);
+        if(windowed && idx_expected < begin_correlator) {
+            len = std::min(len, begin_correlator - idx_expected);
+            memcpy(block, in + idx_in, sizeof(complex) * static_cast<unsigned int>(len));
+            memmove(line_in, line_in + len, sizeof(complex) * P1_LEN);
+            idx_in += len;
+            idx_expected += len;
+
+            continue;
 
-        if(correlation_detect) {
+        }
+        memcpy(block, in + idx_in, sizeof(complex) * static_cast<unsigned int>(len));
+        correlate(len);
 
-            buffer_sym[idx_buffer] = data;
+        for(int i = 0; i < len; ++i) {
 
-            if(++idx_buffer > P1_LEN) {
-               // qDebug() << idx_buffer;
-                reset_buffer();
-            }
+            const int idx_window = idx_expected + i;
 
-            if(correlation < max_correlation * 0.1f && (idx_buffer >= P1_B_PART || !p1_decoded)) {
-
-                p1_detect = true;
-                _idx_buffer_sym = idx_buffer;
-
-                memcpy(in_fft, &p1_buffer.read()[P1_C_PART - idx_buffer],
-                        sizeof(complex) * static_cast<unsigned int>(P1_A_PART));
-                p1_buffer.reset();
-                p1_fft = fft->execute();
-                double coarse_freq_offset = atan2_approx(arg_max.imag(), arg_max.real()) * (double)P1_HERTZ_PER_RADIAN;
-                if(!p1_decoded || _reset) {
-                    for(int shift = 76; shift < 96; ++shift) { // +- 90kHz (one shift +- 8928,5Hz)
-                        complex* p1= p1_fft + shift;
-                        if(demodulate(p1, _dvbt2)) {
-                            p1_decoded = true;
-                            if(shift != first_active_carrier) {
-                                coarse_freq_offset += (double)(shift - first_active_carrier) * (double)P1_CARRIER_SPASING;
+            if(correlation_detect) {
+
+                buffer_sym[idx_buffer] = block[i];
+
+                if(++idx_buffer > P1_LEN) {
+                   // qDebug() << idx_buffer;
+                    correlation_detect = false;
+                    max_correlation = 0.0f;
+                    idx_buffer = 0;
+                }
+
+                if((correlation < max_correlation * 0.1f && (idx_buffer >= P1_B_PART || !p1_decoded)) ||
+                   (windowed && idx_window >= end_window)) {
+
+                    p1_detect = true;
+                    acquisition_timeline::instance().mark(ACQUISITION_P1);
+                    _idx_buffer_sym = idx_buffer;
+                    peak_expected = expected ? idx_window - idx_buffer : -1;
+                    expected = false;
+
+                    memcpy(in_fft, &block[i - (P1_LEN - 1) + P1_C_PART - idx_buffer],
+                            sizeof(complex) * static_cast<unsigned int>(P1_A_PART));
+                    p1_fft = fft->execute();
+                    double coarse_freq_offset = atan2_approx(arg_max.imag(), arg_max.real()) * (double)P1_HERTZ_PER_RADIAN;
+                    if(!p1_decoded || _reset) {
+                        // one shift +- 8928,5Hz, only the two best by the energy are demodulated
+                        int shift[2];
+                        search_carrier(p1_fft, shift[0], shift[1]);
+                        for(int j = 0; j < 2; ++j) {
+                            if(demodulate(p1_fft + shift[j], _dvbt2)) {
+                                p1_decoded = true;
+                                if(shift[j] != first_active_carrier) {
+                                    coarse_freq_offset += (double)(shift[j] - first_active_carrier) * (double)P1_CARRIER_SPASING;
+                                }
+                                break;
                             }
-                            break;
                         }
                     }
-                }
-                _p1_decoded = p1_decoded;
-                _coarse_freq_offset = coarse_freq_offset;
-
-                reset_buffer();
-
-                if(enabled_display)
-                {
-                    //__show__
-                    cor_os = cor_buffer.read();
-                    //                    cor_os[0].imag(_coarse_freq_offset);
-                    for(int i = 0; i < P1_ACTIVE_CARRIERS; ++i) {
-                        p1_dbpsk[i] = (p1_fft + first_active_carrier)[p1_active_carriers[i]] * 0.1f;
+                    _p1_decoded = p1_decoded;
+                    _coarse_freq_offset = coarse_freq_offset;
+
+                    reset_buffer();
+
+                    if(enabled_display && spectrograph_buffer.due())
+                    {
+                        //__show__
+                        cor_os = cor_buffer.read();
+                        //                    cor_os[0].imag(_coarse_freq_offset);
+                        for(int i = 0; i < P1_ACTIVE_CARRIERS; ++i) {
+                            p1_dbpsk[i] = (p1_fft + first_active_carrier)[p1_active_carriers[i]] * 0.1f;
+                        }
+                        spectrograph_buffer.publish(p1_fft, P1_A_PART);
+                        constelation_buffer.publish(p1_dbpsk, P1_ACTIVE_CARRIERS);
+                        oscilloscope_buffer.publish(cor_os, P1_A_PART);
+                        emit replace_spectrograph(&spectrograph_buffer);
+                        emit replace_constelation(&constelation_buffer);
+                        emit replace_oscilloscope(&oscilloscope_buffer);
+                        //_______
                     }
-                    emit replace_spectrograph(P1_A_PART, p1_fft);
-                    emit replace_constelation(P1_ACTIVE_CARRIERS, p1_dbpsk);
-                    emit replace_oscilloscope(P1_A_PART, cor_os);
-                    //_______
-                }
 
-                break;
+                    _consume = idx_in + i + 1;
 
+                    return p1_detect;
+
+                }
             }
-        }
 
-        data_sihft = data * fq_shift[idx_fq_shift++];
-        idx_fq_shift &= 0x3FF;
-        c = delay_c(data_sihft);
-        in_av_c = data * conj(c);
-        b = delay_b(data);
-        in_av_b = data_sihft * conj(b);
-        out_av_c = average_c(in_av_c)/float(P1_C_PART);
-        out_av_b = average_b(in_av_b)/float(P1_B_PART);
-        a = delay_b_x2(out_av_c);
-        d = delay_2(out_av_b);
-        out = a * d;
-        correlation = sqrtf(std::abs(out))*10.f;
-        const complex cor(correlation);
-        if(enabled_display)
-            cor_buffer.write(cor);
-        if(correlation > begin_threshold) {
-            correlation_detect = true;
-            if(correlation > max_correlation) {
-                max_correlation = correlation;
-                arg_max = out;
-                idx_buffer = 0;
+            correlation = cor_block[i];
+            if(enabled_display)
+                cor_buffer.write(complex(correlation));
+            if(windowed && idx_window < begin_window) continue;
+            if(windowed && idx_window >= end_window) {
+                // not in the window: lost, search everywhere
+                windowed = false;
+                expected = false;
+                peak_expected = -1;
+            }
+            if(correlation > begin_threshold) {
+                correlation_detect = true;
+                if(correlation > max_correlation) {
+                    max_correlation = correlation;
+                    arg_max = cor_out[i];
+                    idx_buffer = 0;
+                }
             }
+
         }
+        shift_lines(len);
+        idx_in += len;
+        idx_expected += len;
 
     }
 
@@ -181,6 +248,96 @@ bool p1_symbol::execute(bool _gain_changed, float _level_detect,
 
 }
 //-------------------------------------------------------------------------------------------
+// Correlation of the block in line_in: frequency shift, the C and B part products, their
+// running averages (over LEN - 1 samples, as the sum_of_buffer they replace) and the product
+// of the delayed averages into cor_out, sqrt(|cor_out|) * 10 into cor_block.
+void p1_symbol::correlate(int _len)
+{
+    const complex* x = line_in + P1_LEN;
+    const complex* fq = fq_shift + idx_fq_shift;
+    complex* x_shift = line_shift + P1_C_PART;
+    complex* in_c = line_in_c + P1_C_PART;
+    complex* in_b = line_in_b + P1_B_PART;
+    complex* av_c = line_av_c + P1_B_PART * 2;
+    complex* av_b = line_av_b + 2;
+    for(int i = 0; i < _len; i += 4) {
+        __m256 v = load(x + i);
+        __m256 v_shift = mul(v, load(fq + i));
+        store(x_shift + i, v_shift);
+        store(in_c + i, mul_conj(v, load(x_shift + i - P1_C_PART)));
+        store(in_b + i, mul_conj(v_shift, load(x + i - P1_B_PART)));
+    }
+    const float norm_c = 1.0f / P1_C_PART;
+    const float norm_b = 1.0f / P1_B_PART;
+    for(int i = 0; i < _len; ++i) {
+        sum_c += in_c[i] - in_c[i - (P1_C_PART - 1)];
+        sum_b += in_b[i] - in_b[i - (P1_B_PART - 1)];
+        av_c[i] = sum_c * norm_c;
+        av_b[i] = sum_b * norm_b;
+    }
+    for(int i = 0; i < _len; i += 4) {
+        __m256 out = mul(load(av_c + i - P1_B_PART * 2), load(av_b + i - 2));
+        store(cor_out + i, out);
+        __m256 norm = _mm256_mul_ps(out, out);
+        norm = _mm256_hadd_ps(norm, norm);
+        __m128 n = _mm_shuffle_ps(_mm256_castps256_ps128(norm), _mm256_extractf128_ps(norm, 1),
+                                  _MM_SHUFFLE(1, 0, 1, 0));
+        n = _mm_mul_ps(_mm_sqrt_ps(_mm_sqrt_ps(n)), _mm_set1_ps(10.0f));
+        _mm_storeu_ps(cor_block + i, n);
+    }
+    idx_fq_shift = (idx_fq_shift + _len) & (P1_FREQUENCY_SHIFT - 1);
+}
+//-------------------------------------------------------------------------------------------
+void p1_symbol::shift_lines(int _len)
+{
+    const size_t len = static_cast<size_t>(_len);
+    memmove(line_in, line_in + len, sizeof(complex) * P1_LEN);
+    memmove(line_shift, line_shift + len, sizeof(complex) * P1_C_PART);
+    memmove(line_in_c, line_in_c + len, sizeof(complex) * P1_C_PART);
+    memmove(line_in_b, line_in_b + len, sizeof(complex) * P1_B_PART);
+    memmove(line_av_c, line_av_c + len, sizeof(complex) * P1_B_PART * 2);
+    memmove(line_av_b, line_av_b + len, sizeof(complex) * 2);
+}
+//-------------------------------------------------------------------------------------------
+void p1_symbol::set_carrier_search(float _range_hz)
+{
+    // the shifted pattern has to stay inside the FFT
+    const int max_shift = std::min(first_active_carrier,
+                                   P1_A_PART - 1 - p1_active_carriers[P1_ACTIVE_CARRIERS - 1] - first_active_carrier);
+    int offset = static_cast<int>(std::ceil(_range_hz / P1_CARRIER_SPASING));
+    max_carrier_offset = std::max(0, std::min(offset, max_shift));
+}
+//-------------------------------------------------------------------------------------------
+// Integer carrier offset by the cross-correlation of the P1 power spectrum with the mask of
+// the active carriers: the energy under the mask shifted by each offset of the range, the
+// shifts of the largest two into _best and _second.
+void p1_symbol::search_carrier(const complex* _p1, int &_best, int &_second)
+{
+    const int begin = first_active_carrier - max_carrier_offset;
+    const int len = 2 * max_carrier_offset + 1;
+    const int end_power = begin + len + p1_active_carriers[P1_ACTIVE_CARRIERS - 1];
+    for(int i = begin; i < end_power; ++i) p1_power[i] = std::norm(_p1[i]);
+    for(int i = 0; i < len; ++i) shift_energy[i] = 0.0f;
+    for(int c = 0; c < P1_ACTIVE_CARRIERS; ++c) {
+        const float* power = p1_power + begin + p1_active_carriers[c];
+        for(int i = 0; i < len; ++i) shift_energy[i] += power[i];
+    }
+    int best = 0;
+    int second = len > 1 ? 1 : 0;
+    if(shift_energy[second] > shift_energy[best]) std::swap(best, second);
+    for(int i = 2; i < len; ++i) {
+        if(shift_energy[i] > shift_energy[best]) {
+            second = best;
+            best = i;
+        }
+        else if(shift_energy[i] > shift_energy[second]) {
+            second = i;
+        }
+    }
+    _best = begin + best;
+    _second = begin + second;
+}
+//-------------------------------------------------------------------------------------------
 bool p1_symbol::demodulate(complex* _p1, dvbt2_parameters &_dvbt2)
 {
     complex dbpsk[P1_ACTIVE_CARRIERS];
@@ -305,12 +462,15 @@ void p1_symbol::reset_buffer()
 {
     correlation_detect = false;
     max_correlation = 0.0f;
-    delay_c.reset();
-    delay_b.reset();
-    delay_b_x2.reset();
-    delay_2.reset();
-    average_b.reset();
-    average_c.reset();
+    memset(line_in, 0, sizeof(line_in));
+    memset(line_shift, 0, sizeof(line_shift));
+    memset(line_in_c, 0, sizeof(line_in_c));
+    memset(line_in_b, 0, sizeof(line_in_b));
+    memset(line_av_c, 0, sizeof(line_av_c));
+    memset(line_av_b, 0, sizeof(line_av_b));
+    sum_c = {0.0f, 0.0f};
+    sum_b = {0.0f, 0.0f};
+    idx_fq_shift = 0;
     idx_buffer = 0;
 }
 //-------------------------------------------------------------------------------------------
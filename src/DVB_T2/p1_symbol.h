@@ -18,6 +18,7 @@
 #include <QObject>
 
 #include "dvbt2_definition.h"
+#include "display_buffer.h"
 #include "DSP/fast_fourier_transform.h"
 #include "DSP/buffers.hh"
 
@@ -46,25 +47,45 @@ public:
     {
         enabled_display = mode;
     }
+    // the P1 starts with the next sample: search a window around the peak of the last frame
+    void set_expected()
+    {
+        expected = true;
+        idx_expected = 0;
+    }
+    // integer carrier offsets searched at the first P1, +- _range_hz
+    void set_carrier_search(float _range_hz);
 
 signals:
-    void replace_spectrograph(const int _len_data, complex* _data);
-    void replace_constelation(const int _len_data, complex* _data);
-    void replace_oscilloscope(const int _len_data, complex* _data);
+    void replace_spectrograph(display_buffer* _buffer);
+    void replace_constelation(display_buffer* _buffer);
+    void replace_oscilloscope(display_buffer* _buffer);
     void bad_signal();
 
 private:
-    complex fq_shift[P1_FREQUENCY_SHIFT];
+    // The correlator runs on blocks: each stream is kept as a line, its history (the longest
+    // delay taken from it) followed by the block; after the block the history is moved down.
+    constexpr static int len_block = 1024;
+    constexpr static int len_pad = 4;
+    constexpr static int len_window = 64;   // search around the expected peak, samples either side
+    alignas(32) complex fq_shift[P1_FREQUENCY_SHIFT + len_block + len_pad];
+    int idx_fq_shift = 0;
     int idx_buffer = 0;
-    delay_buffer<complex, P1_B_PART>        delay_b;
-    delay_buffer<complex, P1_C_PART>        delay_c;
-    delay_buffer<complex, P1_B_PART * 2>    delay_b_x2;
-    delay_buffer<complex, 2>                delay_2;
-    sum_of_buffer<complex, P1_B_PART>       average_b;
-    sum_of_buffer<complex, P1_C_PART>       average_c;
-    save_buffer<complex, P1_LEN>            p1_buffer;
+    alignas(32) complex line_in[P1_LEN + len_block + len_pad];          // input, also the P1 for FFT
+    alignas(32) complex line_shift[P1_C_PART + len_block + len_pad];    // input frequency shifted
+    alignas(32) complex line_in_c[P1_C_PART + len_block + len_pad];
+    alignas(32) complex line_in_b[P1_B_PART + len_block + len_pad];
+    alignas(32) complex line_av_c[P1_B_PART * 2 + len_block + len_pad];
+    alignas(32) complex line_av_b[2 + len_block + len_pad];
+    alignas(32) complex cor_out[len_block + len_pad];
+    alignas(32) float cor_block[len_block + len_pad];
+    complex sum_c = {0.0f, 0.0f};
+    complex sum_b = {0.0f, 0.0f};
     save_buffer<complex, P1_A_PART>         cor_buffer;
     float correlation = 0;
+    bool expected = false;
+    int idx_expected = 0;                   // samples since set_expected()
+    int peak_expected = -1;                 // peak position after set_expected() of the last frame
 
     /*const */float begin_threshold = 5.0e+5f;// 1.5e+5f FIX ME;
     /*const */float end_threshold = begin_threshold * 0.5f;
@@ -80,11 +101,20 @@ private:
     complex* in_fft;
     complex* p1_fft;
     const int first_active_carrier = 86;
+    int max_carrier_offset = 10;
+    alignas(32) float p1_power[P1_A_PART];
+    alignas(32) float shift_energy[P1_A_PART];
     bool enabled_display = false;
+    display_buffer spectrograph_buffer;
+    display_buffer constelation_buffer;
+    display_buffer oscilloscope_buffer;
     int p1_randomize[P1_ACTIVE_CARRIERS];
     void init_p1_randomize();
     complex p1_dbpsk[P1_ACTIVE_CARRIERS];
     bool demodulate(complex *_p1, dvbt2_parameters &_dvbt2);
+    void search_carrier(const complex* _p1, int &_best, int &_second);
+    void correlate(int _len);
+    void shift_lines(int _len);
     void reset_buffer();
 
     const int p1_active_carriers[P1_ACTIVE_CARRIERS] =
@@ -15,8 +15,12 @@
 #include "p2_symbol.h"
 
 #include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #include "DSP/fast_math.h"
+#include "acquisition_timeline.h"
 
 //-------------------------------------------------------------------------------------------
 p2_symbol::p2_symbol(QObject *parent) : QObject(parent)
@@ -54,18 +58,18 @@ void p2_symbol::init(dvbt2_parameters &_dvbt2, pilot_generator* _pilot,
     h_even_p2 = _address->h_even_p2;
     h_odd_p2 = _address->h_odd_p2;
 
-    show_symbol.resize(fft_size);
-    show_data.resize(c_p2);
     est_data.resize(k_total);
-    show_est_data.resize(k_total);
 
-    init_l1_randomizer();
+    init_l1_randomizer(KBCH_1_2);
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::init_l1_randomizer()
+void p2_symbol::init_l1_randomizer(int _len)
 {
+    if(static_cast<int>(l1_randomize.size()) >= _len) return;
+
+    l1_randomize.resize(static_cast<size_t>(_len));
     int sr = 0x4A80;
-    for (int i = 0; i < KBCH_1_2; ++i) {
+    for (int i = 0; i < _len; ++i) {
         int b = ((sr) ^ (sr >> 1)) & 1;
         l1_randomize[i] = static_cast<unsigned char>(b);
         sr >>= 1;
@@ -73,12 +77,76 @@ void p2_symbol::init_l1_randomizer()
     }
 }
 //-------------------------------------------------------------------------------------------
+static inline int8_t quantize_llr(float _llr)
+{
+    return static_cast<int8_t>(std::lrint(std::min(std::max(_llr, -127.0f), 127.0f)));
+}
+//-------------------------------------------------------------------------------------------
+// Noise per axis: the L1-pre is BPSK, nothing is sent on the imaginary axis.
+float p2_symbol::l1_noise_variance() const
+{
+    float sum = 0.0f;
+    for(int i = 0; i < L1_PRE_CELL; ++i){
+        sum += deinterleaved_cell[i].imag() * deinterleaved_cell[i].imag();
+    }
+
+    return std::max(sum / L1_PRE_CELL, 1.0e-4f);
+
+}
+//-------------------------------------------------------------------------------------------
+bool p2_symbol::l1_pre_decode()
+{
+    const float precision = 4.0f / l1_noise_variance();
+    for(int i = 0; i < L1_PRE_CELL; ++i){
+        l1_pre_llr[i] = quantize_llr(precision * deinterleaved_cell[i].real());
+    }
+    l1_fec.decode_pre(l1_pre_llr, l1_pre_bit);
+    l1_pre_stream.pack(l1_pre_bit, KSIG_PRE);
+
+    return l1_pre_stream.check_crc32(KSIG_PRE - 32);
+
+}
+//-------------------------------------------------------------------------------------------
+// The L1-post is split in FEC blocks of the same size, each bit interleaved on its own,
+// the padding is at the end of the last one and the scrambling runs over all of them.
+bool p2_symbol::l1_post_decode(int _n_post, int _colums, bool _randomize)
+{
+    const int k_post_ex_pad = l1_pre.l1_post_info_size + 32;
+    const int n_fec_block = (k_post_ex_pad + KBCH_1_2 - 1) / KBCH_1_2;
+    const int k_sig = (k_post_ex_pad + n_fec_block - 1) / n_fec_block;
+    const int n_block = _n_post / n_fec_block;
+    if(n_block * n_fec_block != _n_post) return false;
+
+    for(int b = 0; b < n_fec_block; ++b){
+        const int8_t* in = &l1_post_llr_interleaving[static_cast<size_t>(b * n_block)];
+        int8_t* out = &l1_post_llr[static_cast<size_t>(b * n_block)];
+        if(_colums == 0){
+            memcpy(out, in, static_cast<size_t>(n_block));
+            continue;
+        }
+        const int rows = n_block / _colums;
+        for(int i = 0; i < n_block; ++i) out[(i % _colums) * rows + i / _colums] = in[i];
+    }
+    l1_post_fec_bit.resize(static_cast<size_t>(n_fec_block * k_sig));
+    l1_fec.decode_post(n_fec_block, k_sig, n_block, l1_post_llr.data(), l1_post_fec_bit.data());
+    for(int i = 0; i < k_post_ex_pad; ++i){
+        l1_post_bit[static_cast<size_t>(i)] = l1_post_fec_bit[static_cast<size_t>(i)];
+        if(_randomize) l1_post_bit[static_cast<size_t>(i)] ^= l1_randomize[static_cast<size_t>(i)];
+    }
+    l1_post_stream.pack(l1_post_bit.data(), k_post_ex_pad);
+
+    return l1_post_stream.check_crc32(l1_pre.l1_post_info_size);
+
+}
+//-------------------------------------------------------------------------------------------
 void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_symbol, complex* _ofdm_cell,
                             l1_presignalling &_l1_pre, l1_postsignalling &_l1_post, bool &_crc32_l1_pre,
                             bool &_crc32_l1_post, float &_sample_rate_offset, float &_phase_offset, std::vector<complex> &out)
 {
 
-    complex* ofdm_cell = &_ofdm_cell[left_nulls];
+    // the spectrum is in natural order, active carrier i is in bin (left_nulls + i + fft_size / 2) mod fft_size
+    const int bin_shift = left_nulls + fft_size / 2;
+    const int bin_mask = fft_size - 1;
     complex est_pilot;
     float angle = 0.0f;
     float delta_angle = 0.0f;
@@ -109,7 +177,7 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
     else h = h_even_p2;
 
     //__for first pilot______
-    cell = ofdm_cell[0];
+    cell = _ofdm_cell[bin_shift & bin_mask];
     pilot_refer = pilot_refer_idx_p2_symbol[0];
     est_pilot = cell * pilot_refer;
     sum_pilot_1 += est_pilot;
@@ -122,7 +190,7 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
     //__ ... ______________
 
     for (int i = 1; i < half_total; ++i){
-        cell = ofdm_cell[i];
+        cell = _ofdm_cell[(i + bin_shift) & bin_mask];
         pilot_refer = pilot_refer_idx_p2_symbol[i];
         switch (p2_carrier_map[i]){
         case DATA_CARRIER:
@@ -171,7 +239,7 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
             break;
         }
     }
-    cell = ofdm_cell[half_total];
+    cell = _ofdm_cell[(half_total + bin_shift) & bin_mask];
     pilot_refer = pilot_refer_idx_p2_symbol[half_total];
     est_pilot = cell * pilot_refer;
     angle = atan2_approx(est_pilot.imag(), est_pilot.real());
@@ -182,7 +250,7 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
     ++len_est;
     // ...
     for (int i = half_total + 1; i < k_total; ++i){
-        cell = ofdm_cell[i];
+        cell = _ofdm_cell[(i + bin_shift) & bin_mask];
         pilot_refer = pilot_refer_idx_p2_symbol[i];
         switch (p2_carrier_map[i]){
         case DATA_CARRIER:
@@ -238,9 +306,8 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
 
     _sample_rate_offset = (sum_angle_2 - sum_angle_1)/* / k_total*/;
 
-    if(enabled_display)
+    if(enabled_display && spectrograph_buffer.due())
     {
-        memcpy(&show_symbol[0], _ofdm_cell, sizeof(complex) * static_cast<unsigned long>(fft_size));
         int len_show = L1_PRE_CELL;
         int idx_show = 0;
         if(_crc32_l1_pre){
@@ -255,19 +322,22 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
                 break;
             }
         }
-        memcpy(&show_data[0], deinterleaved_cell, sizeof(complex) * static_cast<unsigned long>(c_p2));
-        emit replace_spectrograph(fft_size, &show_symbol[0]);
-        emit replace_constelation(len_show, &show_data[idx_show]);
-        memcpy(&show_est_data[0], &est_data[0], sizeof(complex) * static_cast<unsigned long>(len_est));
-        emit replace_oscilloscope(len_est, &show_est_data[0]);
+        spectrograph_buffer.publish(_ofdm_cell, fft_size, fft_size / 2);
+        constelation_buffer.publish(&deinterleaved_cell[idx_show], len_show);
+        oscilloscope_buffer.publish(&est_data[0], len_est);
+        emit replace_spectrograph(&spectrograph_buffer);
+        emit replace_constelation(&constelation_buffer);
+        emit replace_oscilloscope(&oscilloscope_buffer);
     }
 
     if(l1_pre_info(_dvbt2)) {
         _l1_pre = l1_pre;
         _crc32_l1_pre = true;
+        acquisition_timeline::instance().mark(ACQUISITION_L1_PRE);
         if(l1_post_info()) {
             _l1_post = l1_post;
             _crc32_l1_post = true;
+            acquisition_timeline::instance().mark(ACQUISITION_L1_POST);
         }
         else{
             _crc32_l1_post = false;
@@ -281,194 +351,66 @@ void p2_symbol::execute(dvbt2_parameters &_dvbt2, bool _demod_init, int &_idx_sy
 //-------------------------------------------------------------------------------------------
 bool p2_symbol::l1_pre_info(dvbt2_parameters &_dvbt2)
 {
-    unsigned int crc = 0xffffffff;
-    int field = 0;
-    unsigned int shift = 31;
-    unsigned char bit;
-    //calculate CRC32
-    for(int i = 0; i < 168; ++i){
-        //BPSK demodulate
-        bit = deinterleaved_cell[i].real() > 0 ? 0 : 1;
-        unsigned int b = bit ^ ((crc >> 31) & 0x01);
-        crc <<= 1;
-        if (b) crc ^= CRC_POLY;
-    }
-    //get field CRC32
-    field = 0;
-    for(int i = 168; i < 200; ++i){
-        //BPSK demodulate
-        bit = deinterleaved_cell[i].real() > 0 ? 0 : 1;
-        //demap
-        field |= (bit << shift);
-        --shift;
-    }
-    l1_pre.crc_32 = field;
-    //check CRC32
-    if(crc != static_cast<unsigned int>(field)) {
-        emit view_l1_presignalling("CRC_32 ERROR");
+    //BPSK demodulate
+    for(int i = 0; i < KSIG_PRE; ++i){
+        l1_pre_bit[i] = deinterleaved_cell[i].real() > 0 ? 0 : 1;
+    }
+    l1_pre_stream.pack(l1_pre_bit, KSIG_PRE);
+    //check CRC32, the FEC only when the hard decisions fail
+    bool crc_ok = l1_pre_stream.check_crc32(KSIG_PRE - 32) || l1_pre_decode();
+    int idx = KSIG_PRE - 32;
+    l1_pre.crc_32 = static_cast<int>(l1_pre_stream.read(idx, 32));
+    if(!crc_ok) {
+        if(enabled_l1_display) emit view_l1_presignalling(l1_pre, false);
 
         return false;
 
     }
 
-    field = 0;
-    shift = 7;
-    for(int i = 0; i < 168; ++i){
-        //BPSK demodulate
-        bit = deinterleaved_cell[i].real() > 0 ? 0 : 1;
-        //demap bit
-        field |= (bit << shift);
-        --shift;
-        switch (i){
-        case 7:
-            l1_pre.type = field;
-            field = 0;
-            shift = 0;
-            break;
-        case 8:
-            l1_pre.bwt_ext = field;
-            field = 0;
-            shift = 2;
-            break;
-        case 11:
-            l1_pre.s1 = field;
-            field = 0;
-            shift = 2;
-            break;
-        case 14:
-            l1_pre.s2_field1 = field;
-            field = 0;
-            shift = 0;
-            break;
-        case 15:
-            l1_pre.s2_field2 = field;
-            idx_l1_post_fef_shift = field * 34;
-            field = 0;
-            shift = 0;
-            break;
-        case 16:
-            l1_pre.l1_repetition_flag = field;
-            field = 0;
-            shift = 2;
-            break;
-        case 19:
-            l1_pre.guard_interval = field;
-            field = 0;
-            shift = 3;
-            break;
-        case 23:
-            l1_pre.papr = field;
-            field = 0;
-            shift = 3;
-            break;
-        case 27:
-            l1_pre.l1_post_mod = field;
-            field = 0;
-            shift = 1;
-            break;
-        case 29:
-            l1_pre.l1_cod = field;
-            field = 0;
-            shift = 1;
-            break;
-        case 31:
-            l1_pre.l1_fec_type = field;
-            field = 0;
-            shift = 17;
-            break;
-        case 49:
-            l1_pre.l1_post_size = field;
-            l1_size = field + L1_PRE_CELL;
-            field = 0;
-            shift = 17;
-            break;
-        case 67:
-            l1_pre.l1_post_info_size = field;
-            l1_post_bit.resize(l1_pre.l1_post_size * l1_pre.l1_post_mod * 2);
-            l1_post_bit_interleaving.resize(l1_pre.l1_post_size * l1_pre.l1_post_mod * 2);
-            field = 0;
-            shift = 3;
-            break;
-        case 71:
-            l1_pre.pilot_pattern = field;
-            field = 0;
-            shift = 7;
-            break;
-        case 79:
-            l1_pre.tx_id_availability = field;
-            field = 0;
-            shift = 15;
-            break;
-        case 95:
-            l1_pre.cell_id = field;
-            field = 0;
-            shift = 15;
-            break;
-        case 111:
-            l1_pre.network_id = field;
-            field = 0;
-            shift = 15;
-            break;
-        case 127:
-            l1_pre.t2_system_id = field;
-            field = 0;
-            shift = 7;
-            break;
-        case 135:
-            l1_pre.num_t2_frames = field;
-            field = 0;
-            shift = 11;
-            break;
-        case 147:
-            l1_pre.num_data_symbols = field;
-            field = 0;
-            shift = 2;
-            break;
-        case 150:
-            l1_pre.regen_flag = field;
-            field = 0;
-            shift = 0;
-            break;
-        case 151:
-            l1_pre.l1_post_extension = field;
-            field = 0;
-            shift = 2;
-            break;
-        case 154:
-            l1_pre.num_rf = field;
-            if(l1_post.rf.size() != size_t(field))
-                l1_post.rf.resize(field);
-            idx_l1_post_rf_shift = (field - 1) * 35;
-            field = 0;
-            shift = 2;
-            break;
-        case 157:
-            l1_pre.current_rf_index = field;
-            field = 0;
-            shift = 3;
-            break;
-        case 161:
-            l1_pre.t2_version = field;
-            field = 0;
-            shift = 0;
-            break;
-        case 162:
-            l1_pre.l1_post_scrambled = field;
-            field = 0;
-            shift = 0;
-            break;
-        case 163:
-            l1_pre.t2_base_lite = field;
-            field = 0;
-            shift = 3;
-            break;
-        case 167:
-            l1_pre.reserved = field;
-            break;
-        default:
-            break;
-        }
-    }
+    const l1_bitstream &bit = l1_pre_stream;
+    idx = 0;
+    l1_pre.type = bit.read(idx, 8);
+    l1_pre.bwt_ext = bit.read(idx, 1);
+    l1_pre.s1 = bit.read(idx, 3);
+    l1_pre.s2_field1 = bit.read(idx, 3);
+    l1_pre.s2_field2 = bit.read(idx, 1);
+    idx_l1_post_fef_shift = l1_pre.s2_field2 * 34;
+    l1_pre.l1_repetition_flag = bit.read(idx, 1);
+    l1_pre.guard_interval = bit.read(idx, 3);
+    l1_pre.papr = bit.read(idx, 4);
+    l1_pre.l1_post_mod = bit.read(idx, 4);
+    l1_pre.l1_cod = bit.read(idx, 2);
+    l1_pre.l1_fec_type = bit.read(idx, 2);
+    l1_pre.l1_post_size = bit.read(idx, 18);
+    l1_size = l1_pre.l1_post_size + L1_PRE_CELL;
+    l1_pre.l1_post_info_size = bit.read(idx, 18);
+    {
+        // bits per cell: BPSK, QPSK, 16QAM, 64QAM
+        const int n_bit = l1_pre.l1_post_mod == 0 ? 1 : l1_pre.l1_post_mod * 2;
+        const size_t len = static_cast<size_t>(l1_pre.l1_post_size * n_bit);
+        l1_post_bit.resize(len);
+        l1_post_bit_interleaving.resize(len);
+        l1_post_llr.resize(len);
+        l1_post_llr_interleaving.resize(len);
+    }
+    l1_pre.pilot_pattern = bit.read(idx, 4);
+    l1_pre.tx_id_availability = bit.read(idx, 8);
+    l1_pre.cell_id = bit.read(idx, 16);
+    l1_pre.network_id = bit.read(idx, 16);
+    l1_pre.t2_system_id = bit.read(idx, 16);
+    l1_pre.num_t2_frames = bit.read(idx, 8);
+    l1_pre.num_data_symbols = bit.read(idx, 12);
+    l1_pre.regen_flag = bit.read(idx, 3);
+    l1_pre.l1_post_extension = bit.read(idx, 1);
+    l1_pre.num_rf = bit.read(idx, 3);
+    if(l1_post.rf.size() != size_t(l1_pre.num_rf))
+        l1_post.rf.resize(l1_pre.num_rf);
+    idx_l1_post_rf_shift = (l1_pre.num_rf - 1) * 35;
+    l1_pre.current_rf_index = bit.read(idx, 3);
+    l1_pre.t2_version = bit.read(idx, 4);
+    l1_pre.l1_post_scrambled = bit.read(idx, 1);
+    l1_pre.t2_base_lite = bit.read(idx, 1);
+    l1_pre.reserved = bit.read(idx, 4);
 
     if(_dvbt2.carrier_mode != l1_pre.bwt_ext){
         _dvbt2.carrier_mode = l1_pre.bwt_ext;
@@ -479,45 +421,19 @@ bool p2_symbol::l1_pre_info(dvbt2_parameters &_dvbt2)
     _dvbt2.pilot_pattern = l1_pre.pilot_pattern;
     _dvbt2.n_data = l1_pre.num_data_symbols;
 
-    emit view_l1_presignalling("TYPE\t\t  " + QString::number(l1_pre.type) + "\n"
-                               + "BWT_EXT\t\t  " + QString::number(l1_pre.bwt_ext) +  "\n"
-                               + "S1\t\t  " + QString::number(l1_pre.s1) +  "\n"
-                               + "S2_FIELD1\t\t  " + QString::number(l1_pre.s2_field1) +  "\n"
-                               + "S2_FIELD2\t\t  " + QString::number(l1_pre.s2_field2) +  "\n"
-                               + "L1_REPETITION_FLAG  " + QString::number(l1_pre.l1_repetition_flag) +  "\n"
-                               + "GUARD_INTERVAL\t  " + QString::number(l1_pre.guard_interval) +  "\n"
-                               + "PAPR\t\t  " + QString::number(l1_pre.papr) +  "\n"
-                               + "L1_POST_MOD\t  " + QString::number(l1_pre.l1_post_mod) +  "\n"
-                               + "L1_COD\t\t " + QString::number(l1_pre.l1_cod) +  "\n"
-                               + "L1_FEC_TYPE\t " + QString::number(l1_pre.l1_fec_type) +  "\n"
-                               + "L1_POST_SIZE\t " + QString::number(l1_pre.l1_post_size) +  "\n"
-                               + "L1_POST_INFO_SIZE   " + QString::number(l1_pre.l1_post_info_size) +  "\n"
-                               + "PILOT_PATTERN\t " + QString::number(l1_pre.pilot_pattern) +  "\n"
-                               + "TX_ID_AVAILABILITY   " + QString::number(l1_pre.tx_id_availability) +  "\n"
-                               + "CELL_ID\t\t " + QString::number(l1_pre.cell_id) +  "\n"
-                               + "NETWORK_ID\t " + QString::number(l1_pre.network_id) +  "\n"
-                               + "T2_SYSTEM_ID\t " + QString::number(l1_pre.t2_system_id) +  "\n"
-                               + "NUM_T2_FRAMES\t " + QString::number(l1_pre.num_t2_frames) +  "\n"
-                               + "NUM_DATA_SYMBOLS " + QString::number(l1_pre.num_data_symbols) +  "\n"
-                               + "REGEN_FLAG\t " + QString::number(l1_pre.regen_flag) +  "\n"
-                               + "L1_POST_EXTENSION " + QString::number(l1_pre.l1_post_extension) +  "\n"
-                               + "NUM_RF\t\t " + QString::number(l1_pre.num_rf) +  "\n"
-                               + "CURRENT_RF_IDX\t " + QString::number(l1_pre.current_rf_index) +  "\n"
-                               + "T2_VERSION\t " + QString::number(l1_pre.t2_version) +  "\n"
-                               + "L1_POST_SCRAMBLED " + QString::number(l1_pre.l1_post_scrambled) +  "\n"
-                               + "T2_BASE_LITE\t " + QString::number(l1_pre.t2_base_lite) +  "\n"
-                               + "RESERVED\t\t " + QString::number(l1_pre.reserved) +  "\n");
+    // the text is made by the GUI, and only while it shows it
+    if(enabled_l1_display) emit view_l1_presignalling(l1_pre, true);
 
     return true;
 }
 //-------------------------------------------------------------------------------------------
 bool p2_symbol::l1_post_info()
 {
-    unsigned int crc = 0xffffffff;
     complex* p2_l1_post = &deinterleaved_cell[L1_PRE_CELL];
 
     float amp2 = 0;
     float amp4 = 0;
+    float norm = 1.0f;
     int n_bit = 0;
     unsigned char bit = 0;
     int n_post = 0;
@@ -535,6 +451,7 @@ bool p2_symbol::l1_post_info()
     switch (l1_pre.l1_post_mod) {
     case 0:
         n_bit = 0;
+        norm = 1.0f;
         n_post = l1_pre.l1_post_size;
         colums = 0;
         rows = 0;
@@ -542,6 +459,7 @@ bool p2_symbol::l1_post_info()
         break;
     case 1:
         n_bit = 1;
+        norm = NORM_FACTOR_QPSK;
         n_post = l1_pre.l1_post_size * 2;
         colums = 0;
         rows = 0;
@@ -549,6 +467,7 @@ bool p2_symbol::l1_post_info()
         break;
     case 2:
         amp4 = NORM_FACTOR_QAM16 * 2;
+        norm = NORM_FACTOR_QAM16;
         n_bit = 3;
         n_post = l1_pre.l1_post_size * 4;
         colums = 8;
@@ -558,6 +477,7 @@ bool p2_symbol::l1_post_info()
         break;
     case 3:
         amp2 = NORM_FACTOR_QAM64 * 2;
+        norm = NORM_FACTOR_QAM64;
         amp4 = NORM_FACTOR_QAM64 * 4;
         n_bit = 5;
         n_post = l1_pre.l1_post_size * 6;
@@ -572,32 +492,37 @@ bool p2_symbol::l1_post_info()
     int c_bit = n_bit;
     float real = (*p2_l1_post).real();
     float imag = (*p2_l1_post).imag();
+    float soft = 0.0f;
+    // max-log LLR of the nearest levels, twice the scale of the decoder
+    const float precision = 4.0f * norm / l1_noise_variance();
     for(int i = 0; i < n_post; ++i){
         //demodulate
         switch(n_bit - c_bit){
         case 0:            
-            bit = real > 0 ? 0 : 1;
+            soft = real;
             break;
         case 1:            
-            bit = imag > 0 ? 0 : 1;
+            soft = imag;
             break;
         case 2:            
-            bit = std::abs(real) > amp4 ? 0 : 1;
+            soft = std::abs(real) - amp4;
             break;
         case 3:            
-            bit = std::abs(imag) > amp4 ? 0 : 1;
+            soft = std::abs(imag) - amp4;
             break;
         case 4:
-            bit = std::abs(std::abs(real) - amp4) >  amp2 ? 0 : 1;
+            soft = std::abs(std::abs(real) - amp4) - amp2;
             break;
         case 5:
-            bit = std::abs(std::abs(imag) - amp4) >  amp2 ? 0 : 1;
+            soft = std::abs(std::abs(imag) - amp4) - amp2;
             break;
         default:
             break;
         }
+        bit = soft > 0 ? 0 : 1;
         //multiplexer
         l1_post_bit_interleaving[mux[idx_mux] + w] = bit;
+        l1_post_llr_interleaving[mux[idx_mux] + w] = quantize_llr(precision * soft);
         ++idx_mux;
         if(idx_mux == substreams) {
             idx_mux = 0;
@@ -614,6 +539,7 @@ bool p2_symbol::l1_post_info()
     //deinterleaving
     size_block = rows * colums;
     randomize = l1_pre.t2_version > 1 && l1_pre.l1_post_scrambled == TRUE;
+    if(randomize) init_l1_randomizer(std::max(n_post, l1_pre.l1_post_info_size + 32));
     for (int i = 0; i < n_post; ++i) {
         int j = l + step;
         l1_post_bit[j] = l1_post_bit_interleaving[i];
@@ -624,22 +550,15 @@ bool p2_symbol::l1_post_info()
             ++l;
         }
     }
-    //calculate CRC32
-    for (int i = 0; i < l1_pre.l1_post_info_size; ++i) {
-        unsigned int b = l1_post_bit[i] ^ ((crc >> 31) & 0x01);
-        crc <<= 1;
-        if (b) crc ^= CRC_POLY;
-    }
-    //get field CRC32
-    int idx = l1_pre.l1_post_info_size;
-    int field = 0;
-    for(int s = 31; s >= 0 ; --s){
-        field |= (l1_post_bit[idx++] << s);
-    }
-    //check CRC32
-    if(static_cast<unsigned int>(field) != crc){
-        emit view_l1_postsignalling("CRC_32 ERROR");
-        emit view_l1_dynamic("CRC_32 ERROR", true);
+    //check CRC32, the FEC only when the hard decisions fail
+    const int k_post_ex_pad = std::min(l1_pre.l1_post_info_size + 32, n_post);
+    l1_post_stream.pack(l1_post_bit.data(), k_post_ex_pad);
+    if(!l1_post_stream.check_crc32(l1_pre.l1_post_info_size) &&
+       !l1_post_decode(n_post, colums, randomize)){
+        if(enabled_l1_display) {
+            emit view_l1_postsignalling(l1_post, false);
+            emit view_l1_dynamic(l1_post, false, false);
+        }
         view_l1_post_update = true;
         chek_l1_post = false;
 
@@ -648,427 +567,186 @@ bool p2_symbol::l1_post_info()
     }
 
     chek_l1_post = true;
-    idx = 15;
-    l1_post.num_plp = 0;
-    for(int s = 7; s >= 0 ; --s){
-        l1_post.num_plp |= l1_post_bit[idx++] << s;
-    }
+    int idx = 15;
+    l1_post.num_plp = l1_post_stream.read(idx, 8);
     if(l1_post.plp.size() != size_t(l1_post.num_plp))
         l1_post.plp.resize(l1_post.num_plp);
     idx_l1_post_plp_shift = (l1_post.num_plp - 1) * 89;
     idx = 23;
-    l1_post.num_aux = 0;
-    for(int s = 3; s >= 0 ; --s){
-        l1_post.num_aux |= l1_post_bit[idx++] << s;
-    }
+    l1_post.num_aux = l1_post_stream.read(idx, 4);
     if(l1_post.aux.size() != size_t(l1_post.num_aux))
         l1_post.aux.resize(l1_post.num_aux);
     idx_l1_post_aux_shift = (l1_post.num_aux - 1) * 32;
     // TODO check l1_post.num_aux != 0
 //    if(l1_post.dyn.aux_private_dyn == nullptr) l1_post.dyn.aux_private_dyn = new int[l1_post.num_aux];
-    if(l1_post.dyn.aux_private_dyn.size() != size_t(l1_post.num_aux))
+    if(l1_post.dyn.aux_private_dyn.size() != size_t(l1_post.num_aux)) {
         l1_post.dyn.aux_private_dyn.resize(l1_post.num_aux);
+        l1_post.dyn_next.aux_private_dyn.resize(l1_post.num_aux);
+    }
     idx_l1_post_dyn_aux_shift = (l1_post.num_aux - 1) * 48;
     idx_l1_post_configurable_shift = idx_l1_post_rf_shift + idx_l1_post_fef_shift +
                                         idx_l1_post_plp_shift + idx_l1_post_aux_shift + 223;
-    if(l1_post.dyn.plp.size() != size_t(l1_post.num_plp))
+    if(l1_post.dyn.plp.size() != size_t(l1_post.num_plp)) {
         l1_post.dyn.plp.resize(l1_post.num_plp);
+        l1_post.dyn_next.plp.resize(l1_post.num_plp);
+    }
     idx_l1_post_dyn_plp_shift = (l1_post.num_plp - 1) * 48;
     idx_l1_post_dyn_shift = idx_l1_post_configurable_shift + idx_l1_post_dyn_plp_shift +
                             idx_l1_post_dyn_aux_shift + 71;
 
-    text_l1_post = "";
-    time_frequency_slicing_info(l1_post_bit, l1_post);
-    plp_info(l1_post_bit, l1_post);
-    rf_info(l1_post_bit, l1_post);
-    fef_info(l1_post_bit, l1_post);
-    aux_info(l1_post_bit, l1_post);
-    if(view_l1_post_update) {
-        emit view_l1_postsignalling(text_l1_post);
-        view_l1_post_update = false;
-    }
-    text_l1_dynamic = "";
-    dyn_info(l1_post_bit, l1_post);
-    dyn_plp_info(l1_post_bit, l1_post);
-    dyn_aux_info(l1_post_bit, l1_post);
+    time_frequency_slicing_info(l1_post_stream, l1_post);
+    plp_info(l1_post_stream, l1_post);
+    rf_info(l1_post_stream, l1_post);
+    fef_info(l1_post_stream, l1_post);
+    aux_info(l1_post_stream, l1_post);
+    dyn_info(l1_post_stream, l1_post);
+    dyn_plp_info(l1_post_stream, l1_post);
+    dyn_aux_info(l1_post_stream, l1_post);
     if(l1_pre.l1_repetition_flag){
-        dyn_next_info(l1_post_bit, l1_post);
-        dyn_next_plp_info(l1_post_bit, l1_post);
-        dyn_next_aux_info(l1_post_bit, l1_post);
+        dyn_next_info(l1_post_stream, l1_post);
+        dyn_next_plp_info(l1_post_stream, l1_post);
+        dyn_next_aux_info(l1_post_stream, l1_post);
+    }
+    if(enabled_l1_display) {
+        if(view_l1_post_update) {
+            emit view_l1_postsignalling(l1_post, true);
+            view_l1_post_update = false;
+        }
+        emit view_l1_dynamic(l1_post, l1_pre.l1_repetition_flag, true);
     }
-    emit view_l1_dynamic(text_l1_dynamic, false);
 
     return true;
 
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::time_frequency_slicing_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::time_frequency_slicing_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = 0;
-    l1.sub_slices_per_frame = 0;
-    for(int s = 14; s >= 0 ; --s){
-        l1.sub_slices_per_frame |= bit[idx++] << s;
-    }
-    text_l1_post += "SUB_SLISER_PER_FRAME  " +
-                                QString::number(l1_post.sub_slices_per_frame) + "\n";
+    l1.sub_slices_per_frame = bit.read(idx, 15);
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::plp_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::plp_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
-    text_l1_post += "NUM_PLP\t\t" + QString::number(l1_post.num_plp) + "\n";
     int idx = idx_l1_post_rf_shift + idx_l1_post_fef_shift + 70;
     for(int i = 0; i < l1.num_plp; i++){
-        l1.plp[i].id = 0;
-        for(int s = 7; s >= 0 ; --s){
-            l1.plp[i].id |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_type = 0;
-        for(int s = 2; s >= 0 ; --s){
-            l1.plp[i].plp_type |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_payload_type = 0;
-        for(int s = 4; s >= 0 ; --s){
-            l1.plp[i].plp_payload_type |= bit[idx++] << s;
-        }
-        l1.plp[i].ff_flag = bit[idx++];
-        l1.plp[i].first_rf_idx = 0;
-        for(int s = 2; s >= 0 ; --s){
-            l1.plp[i].first_rf_idx |= bit[idx++] << s;
-        }
-        l1.plp[i].first_frame_idx  = 0;
-        for(int s = 7; s >= 0 ; --s){
-            l1.plp[i].first_frame_idx |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_group_id = 0;
-        for(int s = 7; s >= 0 ; --s){
-            l1.plp[i].plp_group_id |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_cod  = 0;
-        for(int s = 2; s >= 0 ; --s){
-            l1.plp[i].plp_cod |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_mod  = 0;
-        for(int s = 2; s >= 0 ; --s){
-            l1.plp[i].plp_mod |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_rotation = bit[idx++];
-        l1.plp[i].plp_fec_type = 0;
-        for(int s = 1; s >= 0 ; --s){
-            l1.plp[i].plp_fec_type |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_num_blocks_max = 0;
-        for(int s = 9; s >= 0 ; --s){
-            l1.plp[i].plp_num_blocks_max |= bit[idx++] << s;
-        }
-        l1.plp[i].frame_interval = 0;
-        for(int s = 7; s >= 0 ; --s){
-            l1.plp[i].frame_interval |= bit[idx++] << s;
-        }
-        l1.plp[i].time_il_length = 0;
-        for(int s = 7; s >= 0 ; --s){
-            l1.plp[i].time_il_length |= bit[idx++] << s;
-        }
-        l1.plp[i].time_il_type = bit[idx++];
-        l1.plp[i].in_band_a_flag = bit[idx++];
-        l1.plp[i].in_band_b_flag = bit[idx++];
-        l1.plp[i].reserved_1 = 0;
-        for(int s = 10; s >= 0 ; --s){
-            l1.plp[i].reserved_1 |= bit[idx++] << s;
-        }
-        l1.plp[i].plp_mode = 0;
-        for(int s = 1; s >= 0 ; --s){
-            l1.plp[i].plp_mode |= bit[idx++] << s;
-        }
-        l1.plp[i].static_flag = bit[idx++];
-        l1.plp[i].static_padding_flag = bit[idx++];
-        text_l1_post += QString::number(i) +
-              "  PLP_ID\t\t" + QString::number(l1_post.plp[i].id) + "\n"
-              + QString::number(i) +
-              "  PLP_TYPE\t" + QString::number(l1_post.plp[i].plp_type) + "\n"
-              + QString::number(i) +
-              "  PLP_PAYLOAD_TYPE  " + QString::number(l1_post.plp[i].plp_payload_type) + "\n"
-              + QString::number(i) +
-              "  FF_FLAG\t\t" + QString::number(l1_post.plp[i].ff_flag) + "\n"
-              + QString::number(i) +
-              "  FIRST_RF_IDX\t" + QString::number(l1_post.plp[i].first_rf_idx) + "\n"
-              + QString::number(i) +
-              "  FIRST_FRAME_IDX\t" + QString::number(l1_post.plp[i].first_frame_idx) + "\n"
-              + QString::number(i) +
-              "  PLP_GROUP_ID\t" + QString::number(l1_post.plp[i].plp_group_id) + "\n"
-              + QString::number(i) +
-              "  PLP_COD\t" + QString::number(l1_post.plp[i].plp_cod) + "\n"
-              + QString::number(i) +
-              "  PLP_MOD\t" + QString::number(l1_post.plp[i].plp_mod) + "\n"
-              + QString::number(i) +
-              "  PLP_POTATION\t" + QString::number(l1_post.plp[i].plp_rotation) + "\n"
-              + QString::number(i) +
-              "  PLP_FEC_TYPE\t" + QString::number(l1_post.plp[i].plp_fec_type) + "\n"
-              + QString::number(i) +
-              "  PLP_NUM_BLOCKS_MAX " + QString::number(l1_post.plp[i].plp_num_blocks_max) + "\n"
-              + QString::number(i) +
-              "  FRAME_INTERVAL\t" + QString::number(l1_post.plp[i].frame_interval) + "\n"
-              + QString::number(i) +
-              "  TIME_IL_LENGTH\t" + QString::number(l1_post.plp[i].time_il_length) + "\n"
-              + QString::number(i) +
-              "  TIME_IL_TYPE\t" + QString::number(l1_post.plp[i].time_il_type) + "\n"
-              + QString::number(i) +
-              "  IN_BAND_A_FLAG\t" + QString::number(l1_post.plp[i].in_band_a_flag) + "\n"
-              + QString::number(i) +
-              "  IN_BAND_B_FLAG\t" + QString::number(l1_post.plp[i].in_band_b_flag) + "\n"
-              + QString::number(i) +
-              "  RESERVED_1\t" + QString::number(l1_post.plp[i].reserved_1) + "\n"
-              + QString::number(i) +
-              "  PLP_MODE\t" + QString::number(l1_post.plp[i].plp_mode) + "\n"
-              + QString::number(i) +
-              "  STATIC_FLAG\t" + QString::number(l1_post.plp[i].static_flag) + "\n"
-              + QString::number(i) +
-              "  STATIC_PADDING_FLAG " + QString::number(l1_post.plp[i].static_padding_flag) + "\n";
+        l1.plp[i].id = bit.read(idx, 8);
+        l1.plp[i].plp_type = bit.read(idx, 3);
+        l1.plp[i].plp_payload_type = bit.read(idx, 5);
+        l1.plp[i].ff_flag = bit.read(idx, 1);
+        l1.plp[i].first_rf_idx = bit.read(idx, 3);
+        l1.plp[i].first_frame_idx = bit.read(idx, 8);
+        l1.plp[i].plp_group_id = bit.read(idx, 8);
+        l1.plp[i].plp_cod = bit.read(idx, 3);
+        l1.plp[i].plp_mod = bit.read(idx, 3);
+        l1.plp[i].plp_rotation = bit.read(idx, 1);
+        l1.plp[i].plp_fec_type = bit.read(idx, 2);
+        l1.plp[i].plp_num_blocks_max = bit.read(idx, 10);
+        l1.plp[i].frame_interval = bit.read(idx, 8);
+        l1.plp[i].time_il_length = bit.read(idx, 8);
+        l1.plp[i].time_il_type = bit.read(idx, 1);
+        l1.plp[i].in_band_a_flag = bit.read(idx, 1);
+        l1.plp[i].in_band_b_flag = bit.read(idx, 1);
+        l1.plp[i].reserved_1 = bit.read(idx, 11);
+        l1.plp[i].plp_mode = bit.read(idx, 2);
+        l1.plp[i].static_flag = bit.read(idx, 1);
+        l1.plp[i].static_padding_flag = bit.read(idx, 1);
     }
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::rf_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::rf_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = 35;
     for(int i = 0; i < l1_pre.num_rf; i++){
-        l1.rf[i].rf_idx = 0;
-        for(int s = 2; s >= 0 ; --s){
-            l1.rf[i].rf_idx |= (bit[idx++] << s);
-        }
-        l1.rf[i].frequency = 0;
-        for(int s = 31; s >= 0 ; --s){
-            l1.rf[i].frequency |= (bit[idx++] << s);
-        }
-        text_l1_post += QString::number(i) +
-              "  RF_IDX\t\t" + QString::number(l1_post.rf[i].rf_idx) + "\n"
-              + QString::number(i) +
-              "  FREQUENCY\t" + QString::number(l1_post.rf[i].frequency) + "\n";
+        l1.rf[i].rf_idx = bit.read(idx, 3);
+        l1.rf[i].frequency = bit.read(idx, 32);
     }
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::fef_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::fef_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx;
     if(l1_pre.s2_field2 == TRUE){
         idx = idx_l1_post_rf_shift + 70;
-        l1.fef_type = 0;
-        for(int s = 4; s >= 0 ; --s){
-            l1.fef_type |= bit[idx++] << s;
-        }
-        l1.fef_length = 0;
-        for(int s = 21; s >= 0 ; --s){
-            l1.fef_length |= bit[idx++] << s;
-        }
-        l1.fef_interval = 0;
-        for(int s = 7; s >= 0 ; --s){
-            l1.fef_interval |= bit[idx++] << s;
-        }
+        l1.fef_type = bit.read(idx, 5);
+        l1.fef_length = bit.read(idx, 22);
+        l1.fef_interval = bit.read(idx, 8);
     }
     idx = idx_l1_post_rf_shift + idx_l1_post_fef_shift + idx_l1_post_plp_shift + 169;
-    l1.fef_length_msb = 0;
-    for(int s = 1; s >= 0 ; --s){
-        l1.fef_length_msb |= bit[idx++] << s;
-    }
-    l1.reserved_2 = 0;
-    for(int s = 1; s >= 0 ; --s){
-        l1.reserved_2 |= bit[idx++] << s;
-    }
-    text_l1_post += "FEF_TYPE\t\t" + QString::number(l1_post.fef_type) + "\n"
-          + "FEF_LENGHT\t" + QString::number(l1_post.fef_length) + "\n"
-          + "FEF_INTERVAL\t" + QString::number(l1_post.fef_interval) + "\n"
-          + "FEF_LENGHT_MSB\t" + QString::number(l1_post.fef_length_msb) + "\n"
-          + "RESERVED_2\t" + QString::number(l1_post.reserved_2) + "\n";
+    l1.fef_length_msb = bit.read(idx, 2);
+    l1.reserved_2 = bit.read(idx, 2);
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::aux_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::aux_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = 27;
-    l1.aux_config_rfu = 0;
-    for(int s = 7; s >= 0 ; --s){
-        l1.aux_config_rfu |= bit[idx++] << s;
-    }
-    text_l1_post += "NUM_AUX\t\t" + QString::number(l1_post.num_aux) + "\n"
-          + "AUX_CONFIG_RFU\t" + QString::number(l1_post.aux_config_rfu) + "\n";
+    l1.aux_config_rfu = bit.read(idx, 8);
 
     idx = idx_l1_post_rf_shift + idx_l1_post_fef_shift + idx_l1_post_plp_shift + 191;
     for(int i = 0; i < l1.num_aux; i++){
-        l1.aux[i].aux_stream_type = 0;
-        for(int s = 3; s >= 0 ; --s){
-            l1.aux[i].aux_stream_type |= bit[idx++] << s;
-        }
-        l1.aux[i].aux_private_config = 0;
-        for(int s = 27; s >= 0 ; --s){
-            l1.aux[i].aux_private_config |= bit[idx++] << s;
-        }
-        text_l1_post += QString::number(i) +
-              "  AUX_STREAM_TYPE  " + QString::number(l1_post.aux[i].aux_stream_type) + "\n"
-              + QString::number(i) +
-              "  AUX_PRIVATE_CONFIG " + QString::number(l1_post.aux[i].aux_private_config) + "\n";
+        l1.aux[i].aux_stream_type = bit.read(idx, 4);
+        l1.aux[i].aux_private_config = bit.read(idx, 28);
     }
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::dyn_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::dyn_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = idx_l1_post_configurable_shift;
-    l1.dyn.frame_idx = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn.frame_idx |= (bit[idx++] << s);
-    }
-    l1.dyn.sub_slice_interval = 0;
-    for(int s = 21; s >= 0; --s){
-        l1.dyn.sub_slice_interval |= (bit[idx++] << s);
-    }
-    l1.dyn.type_2_start = 0;
-    for(int s = 21; s >= 0; --s){
-        l1.dyn.type_2_start |= (bit[idx++] << s);
-    }
-    l1.dyn.l1_change_counter = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn.l1_change_counter |= (bit[idx++] << s);
-    }
-    l1.dyn.start_rf_idx = 0;
-    for(int s = 2; s >= 0; --s){
-        l1.dyn.start_rf_idx |= (bit[idx++] << s);
-    }
-    l1.dyn.reserved_1 = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn.reserved_1 |= (bit[idx++] << s);
-    }
-    text_l1_dynamic += "DYN_FRAME_IDX\t" + QString::number(l1_post.dyn.frame_idx) + "\n"
-          + "DYN_SUBSLICE_INTERVAL " + QString::number(l1_post.dyn.sub_slice_interval) + "\n"
-          + "DYN_TYPE_2_START\t" + QString::number(l1_post.dyn.type_2_start) + "\n"
-          + "DYN_L1_CHANGE_COUNTER " + QString::number(l1_post.dyn.l1_change_counter) + "\n"
-          + "DYN_START_RF_IDX\t" + QString::number(l1_post.dyn.start_rf_idx) + "\n"
-          + "DYN_RESERVED_1\t" + QString::number(l1_post.dyn.reserved_1) + "\n";
+    l1.dyn.frame_idx = bit.read(idx, 8);
+    l1.dyn.sub_slice_interval = bit.read(idx, 22);
+    l1.dyn.type_2_start = bit.read(idx, 22);
+    l1.dyn.l1_change_counter = bit.read(idx, 8);
+    l1.dyn.start_rf_idx = bit.read(idx, 3);
+    l1.dyn.reserved_1 = bit.read(idx, 8);
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::dyn_plp_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::dyn_plp_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = idx_l1_post_configurable_shift + 71;
     for(int i = 0; i < l1_post.num_plp; i++){
-        l1.dyn.plp[i].id = 0;
-        for(int s = 7; s >= 0; --s){
-            l1.dyn.plp[i].id |= (bit[idx++] << s);
-        }
-        l1.dyn.plp[i].start = 0;
-        for(int s = 21; s >= 0; --s){
-            l1.dyn.plp[i].start |= (bit[idx++] << s);
-        }
-        l1.dyn.plp[i].num_blocks = 0;
-        for(int s = 9; s >= 0; --s){
-            l1.dyn.plp[i].num_blocks |= (bit[idx++] << s);
-        }
-        l1.dyn.plp[i].reserved_2 = 0;
-        for(int s = 7; s >= 0; --s){
-            l1.dyn.plp[i].reserved_2 |= (bit[idx++] << s);
-        }
-        text_l1_dynamic +=QString::number(i) +
-              "  DYN_PLP_ID\t" + QString::number(l1_post.dyn.plp[i].id) + "\n"
-              + QString::number(i) +
-              "  DYN_PLP_START\t" + QString::number(l1_post.dyn.plp[i].start) + "\n"
-              + QString::number(i) +
-              "  DYN_PLP_NUM_BLOCKS " + QString::number(l1_post.dyn.plp[i].num_blocks) + "\n"
-              + QString::number(i) +
-              "  DYN_RESERVED_2\t" + QString::number(l1_post.dyn.plp[i].reserved_2) + "\n";
+        l1.dyn.plp[i].id = bit.read(idx, 8);
+        l1.dyn.plp[i].start = bit.read(idx, 22);
+        l1.dyn.plp[i].num_blocks = bit.read(idx, 10);
+        l1.dyn.plp[i].reserved_2 = bit.read(idx, 8);
     }
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::dyn_aux_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::dyn_aux_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = idx_l1_post_configurable_shift + idx_l1_post_dyn_plp_shift + 119;
-    l1.dyn_next.reserved_3 = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn.reserved_3 = (bit[idx++] << s);
-    }
+    l1.dyn.reserved_3 = bit.read(idx, 8);
     for(int i = 0; i < l1.num_aux; i++){
-        for(int s = 47; s >=0; --s){
-            l1.dyn.aux_private_dyn[i] |= (bit[idx++] << s);
-        }
-        text_l1_dynamic +=QString::number(i) +
-              "  DYN_AUX_PRIVATE_DYN " + QString::number(l1_post.dyn.aux_private_dyn[i]) + "\n";
+        l1.dyn.aux_private_dyn[i] = bit.read(idx, 48);
     }
-    text_l1_dynamic += "DYN_RESERVED_3\t" + QString::number(l1_post.dyn.reserved_3) + "\n";
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::dyn_next_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::dyn_next_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = idx_l1_post_dyn_shift;
-    l1.dyn_next.frame_idx = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn_next.frame_idx |= (bit[idx++] << s);
-    }
-    l1.dyn_next.sub_slice_interval = 0;
-    for(int s = 21; s >= 0; --s){
-        l1.dyn_next.sub_slice_interval |= (bit[idx++] << s);
-    }
-    l1.dyn_next.type_2_start = 0;
-    for(int s = 21; s >= 0; --s){
-        l1.dyn_next.type_2_start |= (bit[idx++] << s);
-    }
-    l1.dyn_next.l1_change_counter = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn_next.l1_change_counter |= (bit[idx++] << s);
-    }
-    l1.dyn_next.start_rf_idx = 0;
-    for(int s = 2; s >= 0; --s){
-        l1.dyn.start_rf_idx |= (bit[idx++] << s);
-    }
-    l1.dyn_next.reserved_1 = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn_next.reserved_1 |= (bit[idx++] << s);
-    }
-    text_l1_dynamic += "DYN_NEXT_FRAME_IDX  " + QString::number(l1_post.dyn_next.frame_idx) + "\n"
-          + "DYN_NEXT_SUBSLICE_INTERVAL " + QString::number(l1_post.dyn_next.sub_slice_interval) + "\n"
-          + "DYN_NEXT_TYPE_2_START " + QString::number(l1_post.dyn_next.type_2_start) + "\n"
-          + "DYN_NEXT_L1_CHANGE_COUNTER " + QString::number(l1_post.dyn_next.l1_change_counter) + "\n"
-          + "DYN_NEXT_START_RF_IDX " + QString::number(l1_post.dyn_next.start_rf_idx) + "\n"
-          + "DYN_NEXT_RESERVED_1 " + QString::number(l1_post.dyn_next.reserved_1) + "\n";
+    l1.dyn_next.frame_idx = bit.read(idx, 8);
+    l1.dyn_next.sub_slice_interval = bit.read(idx, 22);
+    l1.dyn_next.type_2_start = bit.read(idx, 22);
+    l1.dyn_next.l1_change_counter = bit.read(idx, 8);
+    l1.dyn_next.start_rf_idx = bit.read(idx, 3);
+    l1.dyn_next.reserved_1 = bit.read(idx, 8);
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::dyn_next_plp_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::dyn_next_plp_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = idx_l1_post_dyn_shift + 71;
     for(int i = 0; i < l1_post.num_plp; i++){
-        l1.dyn_next.plp[i].id = 0;
-        for(int s = 7; s >= 0; --s){
-            l1.dyn_next.plp[i].id |= (bit[idx++] << s);
-        }
-        l1.dyn_next.plp[i].start = 0;
-        for(int s = 21; s >= 0; --s){
-            l1.dyn_next.plp[i].start |= (bit[idx++] << s);
-        }
-        l1.dyn_next.plp[i].num_blocks = 0;
-        for(int s = 9; s >= 0; --s){
-            l1.dyn.plp[i].num_blocks |= (bit[idx++] << s);
-        }
-        l1.dyn_next.plp[i].reserved_2 = 0;
-        for(int s = 7; s >= 0; --s){
-            l1.dyn_next.plp[i].reserved_2 |= (bit[idx++] << s);
-        }
-        text_l1_dynamic += QString::number(i) +
-              "  DYN_NEXT_PLP_ID\t" + QString::number(l1_post.dyn_next.plp[i].id) + "\n"
-              + QString::number(i) +
-              "  DYN_NEXT_PLP_START " + QString::number(l1_post.dyn_next.plp[i].start) + "\n"
-              + QString::number(i) +
-              "  DYN_NEXT_PLP_NUM_BLOCKS " + QString::number(l1_post.dyn_next.plp[i].num_blocks) + "\n"
-              + QString::number(i) +
-              "  DYN_NEXT_RESERVED_2 " + QString::number(l1_post.dyn_next.plp[i].reserved_2) + "\n";
+        l1.dyn_next.plp[i].id = bit.read(idx, 8);
+        l1.dyn_next.plp[i].start = bit.read(idx, 22);
+        l1.dyn_next.plp[i].num_blocks = bit.read(idx, 10);
+        l1.dyn_next.plp[i].reserved_2 = bit.read(idx, 8);
     }
 }
 //-------------------------------------------------------------------------------------------
-void p2_symbol::dyn_next_aux_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1)
+void p2_symbol::dyn_next_aux_info(const l1_bitstream &bit, l1_postsignalling &l1)
 {
     int idx = idx_l1_post_dyn_shift + 119;
-    l1.dyn_next.reserved_3 = 0;
-    for(int s = 7; s >= 0; --s){
-        l1.dyn_next.reserved_3 = (bit[idx++] << s);
-    }
+    l1.dyn_next.reserved_3 = bit.read(idx, 8);
     for(int i = 0; i < l1.num_aux; i++){
-        for(int s = 47; s >=0; --s){
-            l1.dyn_next.aux_private_dyn[i] |= (bit[idx++] << s);
-        }
-        text_l1_dynamic += QString::number(i) +
-              "  DYN_NEXT_AUX_PRIVATE_DYN " + QString::number(l1_post.dyn_next.aux_private_dyn[i]) + "\n";
+        l1.dyn_next.aux_private_dyn[i] = bit.read(idx, 48);
     }
-    text_l1_dynamic += "DYN_NEXT_RESERVED_3 " + QString::number(l1_post.dyn_next.reserved_3) + "\n";
 }
 //-------------------------------------------------------------------------------------------
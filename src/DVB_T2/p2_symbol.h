@@ -18,17 +18,11 @@
 #include <QObject>
 
 #include "dvbt2_definition.h"
+#include "display_buffer.h"
 #include "pilot_generator.h"
 #include "address_freq_deinterleaver.h"
-
-#define KBCH_1_4 3072
-#define NBCH_1_4 3240
-#define KBCH_1_2 7032
-#define NBCH_1_2 7200
-#define KSIG_PRE 200
-#define KSIG_POST 350
-#define NBCH_PARITY 168
-#define CRC_POLY 0x04C11DB7
+#include "l1_fec_decoder.h"
+#include "l1_bitstream.h"
 
 class p2_symbol : public QObject
 {
@@ -46,6 +40,12 @@ public:
     {
         enabled_display = mode;
     }
+    // the parsed L1 goes out to the GUI only while it is shown
+    void enable_l1_display(bool mode)
+    {
+        if(mode) view_l1_post_update = true;
+        enabled_l1_display = mode;
+    }
 
     enum id_show{
         p2_l1_pre = 0,
@@ -55,12 +55,12 @@ public:
     volatile int id_show = p2_l1_pre;
 
 signals:
-    void replace_spectrograph(const int _len_data, complex* _data);
-    void replace_constelation(const int _len_data, complex* _data);
-    void replace_oscilloscope(const int _len_data, complex* _data);
-    void view_l1_presignalling(QString _text);
-    void view_l1_postsignalling(QString _text);
-    void view_l1_dynamic(QString _text, bool _force_update);
+    void replace_spectrograph(display_buffer* _buffer);
+    void replace_constelation(display_buffer* _buffer);
+    void replace_oscilloscope(display_buffer* _buffer);
+    void view_l1_presignalling(const l1_presignalling &_l1_pre, bool _crc_ok);
+    void view_l1_postsignalling(const l1_postsignalling &_l1_post, bool _crc_ok);
+    void view_l1_dynamic(const l1_postsignalling &_l1_post, bool _next, bool _crc_ok);
 
 private:
     int fft_size;
@@ -89,34 +89,45 @@ private:
     int idx_l1_post_dyn_plp_shift = 0;
     int idx_l1_post_dyn_aux_shift = 0;
     int idx_l1_post_dyn_shift = 0;
-    unsigned char l1_randomize[KBCH_1_2];
-    void init_l1_randomizer();
+    std::vector<unsigned char> l1_randomize{};
+    void init_l1_randomizer(int _len);
+    unsigned char l1_pre_bit[KSIG_PRE];
+    l1_bitstream l1_pre_stream;
     bool l1_pre_info(dvbt2_parameters &_dvbt2);
 
-    QString text_l1_post;
+    l1_fec_decoder l1_fec;
+    int8_t l1_pre_llr[L1_PRE_CELL];
+    float l1_noise_variance() const;
+    bool l1_pre_decode();
+    bool l1_post_decode(int _n_post, int _colums, bool _randomize);
+
     bool l1_post_info();
     std::vector<unsigned char> l1_post_bit{};
     std::vector<unsigned char> l1_post_bit_interleaving{};
+    std::vector<int8_t> l1_post_llr{};
+    std::vector<int8_t> l1_post_llr_interleaving{};
+    std::vector<unsigned char> l1_post_fec_bit{};
+    l1_bitstream l1_post_stream;
     bool chek_l1_post = false;
     bool view_l1_post_update = true;
     bool enabled_display = false;
-    void time_frequency_slicing_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void rf_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void plp_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void fef_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void aux_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
+    bool enabled_l1_display = false;
+    void time_frequency_slicing_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void rf_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void plp_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void fef_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void aux_info(const l1_bitstream &bit, l1_postsignalling &l1);
 
-    QString text_l1_dynamic;
-    void dyn_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void dyn_plp_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void dyn_aux_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void dyn_next_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void dyn_next_plp_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
-    void dyn_next_aux_info(const std::vector<unsigned char> &bit, l1_postsignalling &l1);
+    void dyn_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void dyn_plp_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void dyn_aux_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void dyn_next_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void dyn_next_plp_info(const l1_bitstream &bit, l1_postsignalling &l1);
+    void dyn_next_aux_info(const l1_bitstream &bit, l1_postsignalling &l1);
 
-    std::vector<complex> show_symbol{};
-    std::vector<complex> show_data{};
     std::vector<complex> est_data{};
-    std::vector<complex> show_est_data{};
+    display_buffer spectrograph_buffer{display_buffer::spectrum_len, display_buffer::peak};
+    display_buffer constelation_buffer{display_buffer::constelation_len};
+    display_buffer oscilloscope_buffer{display_buffer::curve_len};
 };
 #endif // P2_SYMBOL_H
@@ -15,6 +15,8 @@
 */
 #include "pilot_generator.h"
 
+#include <algorithm>
+
 //-------------------------------------------------------------------------------------------
 pilot_generator::pilot_generator()
 {
@@ -61,34 +63,49 @@ void pilot_generator::data_generator(dvbt2_parameters _dvbt2)
 {
     dvbt2 = _dvbt2;
 
-    data_carrier_map.resize(dvbt2.n_data);
-
-    data_carrier_map_temp.resize(dvbt2.k_total);
-
-    for(int i = 0; i < dvbt2.n_data; ++i) data_carrier_map[i].resize(dvbt2.k_total);
-    data_pilot_refer.resize(dvbt2.n_data);
-    for(int i = 0; i < dvbt2.n_data; ++i) data_pilot_refer[i].resize(dvbt2.k_total);
-    fc_carrier_map.resize(dvbt2.k_total);
-    fc_pilot_refer.resize(dvbt2.k_total);
     cp_amplitudes();
     sp_amplitudes();
-    //TODO:
-    int idx_data_symbol = 0;
-    for(int idx_symbol = dvbt2.n_p2; idx_symbol < dvbt2.len_frame - dvbt2.l_fc ; ++idx_symbol){
+    // scattered pilots repeat every dy symbols, continual pilots are fixed
+    int len_pattern = std::min(dy, dvbt2.n_data);
+    data_carrier_map.resize(len_pattern);
+    data_carrier_map_temp.resize(dvbt2.k_total);
+    for(int i = 0; i < len_pattern; ++i) {
+        int idx_symbol = dvbt2.n_p2 + i;
         data_carries_mapping();
         cp_mappinng();
         sp_mappinng(idx_symbol);
         tr_papr_carriers_mapping(idx_symbol);
-        for(int i = 0; i < dvbt2.k_total; ++i) {
-             data_carrier_map[idx_data_symbol][i] = data_carrier_map_temp[i];
+        data_carrier_map[i].resize(dvbt2.k_total);
+        for(int n = 0; n < dvbt2.k_total; ++n) {
+             data_carrier_map[i][n] = static_cast<int8_t>(data_carrier_map_temp[n]);
         }
-        ++idx_data_symbol;
     }
-    //...
+    data_prbs.assign((dvbt2.k_total + 7) / 8, 0);
+    for(int n = 0; n < dvbt2.k_total; ++n) {
+        data_prbs[n / 8] |= static_cast<uint8_t>(prbs[n + dvbt2.k_offset] << (7 - n % 8));
+    }
+    fc_carrier_map.resize(dvbt2.k_total);
+    fc_pilot_refer.resize(dvbt2.k_total);
     fc_carrier_mapping();
     modulation();
 }
 //-------------------------------------------------------------------------------------------
+float pilot_generator::data_pilot_amplitude(int _carrier_type) const
+{
+    switch (_carrier_type) {
+    case SCATTERED_CARRIER:
+        return sp_bpsk[0];
+    case SCATTERED_CARRIER_INVERTED:
+        return sp_bpsk_inverted[0];
+    case CONTINUAL_CARRIER:
+        return cp_bpsk[0];
+    case CONTINUAL_CARRIER_INVERTED:
+        return cp_bpsk_inverted[0];
+    default:
+        return 0.0f;
+    }
+}
+//-------------------------------------------------------------------------------------------
 void pilot_generator::p2_carrier_mapping()
 {
     int step, ki;
@@ -2071,54 +2088,24 @@ void pilot_generator::p2_modulation()
 //-------------------------------------------------------------------------------------------
 void pilot_generator::modulation()
 {
-    int idx_data = 0;
-    for (int j = dvbt2.n_p2; j < dvbt2.len_frame; j++) {
-        if (j == (dvbt2.len_frame - dvbt2.l_fc)){
-            for (int n = 0; n < dvbt2.k_total; n++) {
-                switch (fc_carrier_map[n]) {
-                case DATA_CARRIER:
-                    fc_pilot_refer[n] = 0.0;
-                    break;
-                case SCATTERED_CARRIER:
-                    fc_pilot_refer[n] = sp_bpsk[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
-                    break;
-                case SCATTERED_CARRIER_INVERTED:
-                    fc_pilot_refer[n] = sp_bpsk_inverted[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
-                    break;
-                case TRPAPR_CARRIER:
-                    fc_pilot_refer[n] = 0.0;
-                    break;
-                default:
-                    break;
-                }
-            }
-        }
-        else{
-            for (int n = 0; n < dvbt2.k_total; n++) {
-                switch (data_carrier_map[idx_data][n]) {
-                case DATA_CARRIER:
-                    data_pilot_refer[idx_data][n] = 0.0;
-                    break;
-                case SCATTERED_CARRIER:
-                    data_pilot_refer[idx_data][n] = sp_bpsk[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
-                    break;
-                case SCATTERED_CARRIER_INVERTED:
-                    data_pilot_refer[idx_data][n] = sp_bpsk_inverted[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
-                    break;
-                case CONTINUAL_CARRIER:
-                    data_pilot_refer[idx_data][n] = cp_bpsk[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
-                    break;
-                case CONTINUAL_CARRIER_INVERTED:
-                    data_pilot_refer[idx_data][n] = cp_bpsk_inverted[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
-                    break;
-                case TRPAPR_CARRIER:
-                    data_pilot_refer[idx_data][n] = 0.0;
-                    break;
-                default:
-                    break;
-                }
-            }
-            idx_data++;
+    if (dvbt2.l_fc == 0) return;
+    int j = dvbt2.len_frame - dvbt2.l_fc;
+    for (int n = 0; n < dvbt2.k_total; n++) {
+        switch (fc_carrier_map[n]) {
+        case DATA_CARRIER:
+            fc_pilot_refer[n] = 0.0;
+            break;
+        case SCATTERED_CARRIER:
+            fc_pilot_refer[n] = sp_bpsk[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
+            break;
+        case SCATTERED_CARRIER_INVERTED:
+            fc_pilot_refer[n] = sp_bpsk_inverted[prbs[n + dvbt2.k_offset] ^ pn_sequence[j]];
+            break;
+        case TRPAPR_CARRIER:
+            fc_pilot_refer[n] = 0.0;
+            break;
+        default:
+            break;
         }
     }
 }
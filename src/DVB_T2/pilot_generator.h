@@ -28,13 +28,25 @@ public:
     ~pilot_generator();
 
     std::vector<int> p2_carrier_map{};
-    std::vector<std::vector<int>> data_carrier_map{};
+    std::vector<std::vector<int8_t>> data_carrier_map{};    // one map per symbol of the pilot pattern, dy maps
+    std::vector<uint8_t> data_prbs{};                       // prbs of the carriers packed msb first
     std::vector<int> fc_carrier_map{};
     std::vector<std::vector<float>> p2_pilot_refer{};
-    std::vector<std::vector<float>> data_pilot_refer{};
     std::vector<float> fc_pilot_refer{};
     void p2_generator(dvbt2_parameters _dvbt2);
     void data_generator(dvbt2_parameters _dvbt2);
+    // data pilot reference = amplitude of the carrier type, sign flipped by prbs(carrier) ^ pn(symbol)
+    float data_pilot_amplitude(int _carrier_type) const;
+    inline int prbs_bit(int _carrier) const
+    {
+        return (data_prbs[static_cast<unsigned>(_carrier) >> 3] >> (7 - (_carrier & 7))) & 1;
+    }
+    inline int pn_bit(int _idx_symbol) const
+    {
+        return pn_sequence[_idx_symbol];
+    }
+    int dx;
+    int dy;
 
 private:
     dvbt2_parameters dvbt2;
@@ -45,8 +57,6 @@ private:
     float p2_bpsk_inverted[2];
     float sp_bpsk_inverted[2];
     float cp_bpsk_inverted[2];
-    int dx;
-    int dy;
     std::vector<int> prbs{};
     int pn_sequence[CHIPS];
     void init_prbs(dvbt2_parameters _dvbt2);
@@ -0,0 +1,120 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "receiver_metrics.h"
+
+#include <cstdio>
+
+struct metric_name
+{
+    const char* name;
+    const char* help;
+};
+
+static const metric_name counter_name[METRIC_COUNTERS] =
+{
+    {"dvbt2_samples_in_total", "IQ samples received from the device."},
+    {"dvbt2_samples_out_total", "IQ samples handed to the demodulator."},
+    {"dvbt2_rx_dropped_batches_total", "Device buffers dropped because the demodulator was busy."},
+    {"dvbt2_ofdm_symbols_total", "OFDM symbols transformed."},
+    {"dvbt2_frames_total", "T2 frames, P2 symbols demodulated."},
+    {"dvbt2_l1_errors_total", "P2 symbols with an L1 CRC error."},
+    {"dvbt2_ti_blocks_total", "TI blocks out of the time deinterleaver."},
+    {"dvbt2_demapper_dropped_blocks_total", "TI blocks dropped because the LDPC queue was full."},
+    {"dvbt2_ldpc_batches_total", "FEC batches, one codeword per SIMD lane, through the LDPC decoder."},
+    {"dvbt2_ldpc_failures_total", "FEC batches the LDPC decoder could not recover."},
+    {"dvbt2_bb_header_crc_errors_total", "Baseband headers with a CRC-8 error."},
+    {"dvbt2_ts_crc_errors_total", "TS packets with a CRC-8 error."},
+};
+
+static const metric_name gauge_name[METRIC_GAUGES] =
+{
+    {"dvbt2_rx_buffered_batches", "Device buffers waiting for the demodulator."},
+    {"dvbt2_ti_queue_depth", "TI blocks waiting for the LLR demapper."},
+    {"dvbt2_demapper_queue_depth", "FEC batches waiting for the LDPC decoder."},
+    {"dvbt2_ldpc_queue_depth", "FEC batches waiting for the BCH decoder."},
+    {"dvbt2_snr_db", "Signal to noise ratio estimated by the LLR demapper, dB."},
+};
+//-------------------------------------------------------------------------------------------
+receiver_metrics::receiver_metrics()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+receiver_metrics& receiver_metrics::instance()
+{
+    static receiver_metrics metrics;
+    return metrics;
+}
+//-------------------------------------------------------------------------------------------
+static void append_header(std::string &_out, const metric_name &_metric, const char* _type)
+{
+    _out += "# HELP ";
+    _out += _metric.name;
+    _out += ' ';
+    _out += _metric.help;
+    _out += "\n# TYPE ";
+    _out += _metric.name;
+    _out += ' ';
+    _out += _type;
+    _out += '\n';
+}
+//-------------------------------------------------------------------------------------------
+std::string receiver_metrics::prometheus_text() const
+{
+    std::string out;
+    char line[160];
+    for(int i = 0; i < METRIC_COUNTERS; ++i) {
+        append_header(out, counter_name[i], "counter");
+        snprintf(line, sizeof(line), "%s %llu\n", counter_name[i].name,
+                 static_cast<unsigned long long>(counter[i].value.load(std::memory_order_relaxed)));
+        out += line;
+    }
+    for(int i = 0; i < METRIC_GAUGES; ++i) {
+        append_header(out, gauge_name[i], "gauge");
+        snprintf(line, sizeof(line), "%s %.6g\n", gauge_name[i].name,
+                 gauge[i].value.load(std::memory_order_relaxed));
+        out += line;
+    }
+    const metric_name iterations_name = {"dvbt2_ldpc_iterations", "LDPC iterations of the recovered FEC batches."};
+    append_header(out, iterations_name, "histogram");
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    for(int i = 0; i <= max_iterations; ++i) {
+        const uint64_t n = iterations[i].value.load(std::memory_order_relaxed);
+        count += n;
+        sum += n * static_cast<uint64_t>(i);
+        snprintf(line, sizeof(line), "%s_bucket{le=\"%d\"} %llu\n", iterations_name.name, i,
+                 static_cast<unsigned long long>(count));
+        out += line;
+    }
+    snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %llu\n%s_count %llu\n",
+             iterations_name.name, static_cast<unsigned long long>(count),
+             iterations_name.name, static_cast<unsigned long long>(sum),
+             iterations_name.name, static_cast<unsigned long long>(count));
+    out += line;
+    // only the PLPs seen so far
+    const metric_name ts_name = {"dvbt2_ts_packets_total", "TS packets out, by PLP."};
+    append_header(out, ts_name, "counter");
+    for(int i = 0; i < max_plp; ++i) {
+        uint64_t n = ts_plp[i].value.load(std::memory_order_relaxed);
+        if(n == 0) continue;
+        snprintf(line, sizeof(line), "%s{plp=\"%d\"} %llu\n", ts_name.name, i, static_cast<unsigned long long>(n));
+        out += line;
+    }
+
+    return out;
+
+}
+//-------------------------------------------------------------------------------------------
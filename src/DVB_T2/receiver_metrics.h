@@ -0,0 +1,98 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef RECEIVER_METRICS_H
+#define RECEIVER_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum metric_counter_t
+{
+    METRIC_SAMPLES_IN = 0,              // IQ samples from the device
+    METRIC_SAMPLES_OUT,                 // IQ samples handed to the demodulator
+    METRIC_RX_DROPPED,                  // device buffers thrown away, the demodulator too slow
+    METRIC_SYMBOLS,                     // OFDM symbols transformed
+    METRIC_T2_FRAMES,                   // P2 symbols demodulated
+    METRIC_L1_ERRORS,                   // P2 symbols with a bad L1 CRC
+    METRIC_TI_BLOCKS,                   // TI blocks out of the time deinterleaver
+    METRIC_DEMAPPER_DROPPED,            // TI blocks skipped, the LDPC queue full
+    METRIC_LDPC_BATCHES,                // FEC batches, one codeword per lane, through the LDPC decoder
+    METRIC_LDPC_FAILURES,               // FEC batches the LDPC decoder did not recover
+    METRIC_BB_HEADER_ERRORS,            // baseband headers with a bad CRC-8
+    METRIC_TS_CRC_ERRORS,               // TS packets with a bad CRC-8 of the user packet
+    METRIC_COUNTERS
+};
+
+enum metric_gauge_t
+{
+    METRIC_RX_BUFFERED = 0,             // device buffers waiting for the demodulator
+    METRIC_TI_QUEUE,                    // TI blocks waiting for the demapper
+    METRIC_DEMAPPER_QUEUE,              // FEC batches waiting for the LDPC decoder
+    METRIC_LDPC_QUEUE,                  // FEC batches waiting for the BCH decoder
+    METRIC_SNR,                         // dB, estimated by the demapper
+    METRIC_GAUGES
+};
+
+// Counters, gauges and the LDPC iteration histogram of the receiver chain. Every stage
+// updates its own relaxed atomics on its own cache line, nothing is locked; any thread
+// reads a snapshot in the Prometheus text format.
+class receiver_metrics
+{
+public:
+    static receiver_metrics& instance();
+
+    void add(metric_counter_t _counter, uint64_t _n = 1)
+    {
+        counter[_counter].value.fetch_add(_n, std::memory_order_relaxed);
+    }
+    void set(metric_gauge_t _gauge, double _value)
+    {
+        gauge[_gauge].value.store(_value, std::memory_order_relaxed);
+    }
+    // iterations of a recovered FEC batch
+    void ldpc_iterations(int _n)
+    {
+        if(_n < 0) _n = 0;
+        if(_n > max_iterations) _n = max_iterations;
+        iterations[_n].value.fetch_add(1, std::memory_order_relaxed);
+    }
+    void ts_packets(int _plp_id, uint64_t _n)
+    {
+        ts_plp[_plp_id & (max_plp - 1)].value.fetch_add(_n, std::memory_order_relaxed);
+    }
+    std::string prometheus_text() const;
+
+    constexpr static int max_iterations = 32;
+    constexpr static int max_plp = 256;
+
+private:
+    receiver_metrics();
+
+    struct alignas(64) atomic_counter
+    {
+        std::atomic<uint64_t> value{0};
+    };
+    struct alignas(64) atomic_gauge
+    {
+        std::atomic<double> value{0.0};
+    };
+    atomic_counter counter[METRIC_COUNTERS];
+    atomic_gauge gauge[METRIC_GAUGES];
+    atomic_counter iterations[max_iterations + 1];
+    atomic_counter ts_plp[max_plp];
+};
+
+#endif // RECEIVER_METRICS_H
@@ -0,0 +1,150 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "stage_tracer.h"
+
+#ifdef USE_TRACE
+
+#include <QThread>
+#include <chrono>
+#include <cstdio>
+
+static const char* stage_name[TRACE_STAGES] =
+{
+    "demodulator",
+    "time deinterleaver",
+    "LLR demapper",
+    "FEC batch",
+    "LDPC decoder",
+    "BCH decoder",
+    "BB de-header",
+};
+// the stage handing its items to this one, -1 when none
+static const int upstream[TRACE_STAGES] =
+{
+    -1,
+    -1,
+    TRACE_TIME_DEINTERLEAVER,
+    -1,
+    TRACE_FEC_BATCH,
+    TRACE_LDPC_DECODER,
+    TRACE_BCH_DECODER,
+};
+static const bool downstream[TRACE_STAGES] =
+{
+    false, true, false, true, true, true, false
+};
+//-------------------------------------------------------------------------------------------
+stage_tracer::stage_tracer()
+{
+    tsc_start = now();
+    us_start = now_us();
+}
+//-------------------------------------------------------------------------------------------
+stage_tracer& stage_tracer::instance()
+{
+    static stage_tracer tracer;
+    return tracer;
+}
+//-------------------------------------------------------------------------------------------
+int64_t stage_tracer::now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//-------------------------------------------------------------------------------------------
+stage_tracer::ring* stage_tracer::thread_ring()
+{
+    thread_local ring* local = nullptr;
+    if(local) return local;
+
+    std::unique_ptr<ring> r(new ring);
+    r->events.resize(ring_size);
+    QThread* thread = QThread::currentThread();
+    r->thread_name = thread ? thread->objectName().toStdString() : std::string();
+    std::lock_guard<std::mutex> lock(mutex_rings);
+    if(r->thread_name.empty()) r->thread_name = "thread " + std::to_string(rings.size());
+    local = r.get();
+    rings.push_back(std::move(r));
+
+    return local;
+
+}
+//-------------------------------------------------------------------------------------------
+void stage_tracer::record(trace_stage_t _stage, uint64_t _begin, uint64_t _end, int64_t _item)
+{
+    ring* r = thread_ring();
+    const uint64_t head = r->head.load(std::memory_order_relaxed);
+    r->events[head % ring_size] = event{_begin, _end, _item, _stage};
+    r->head.store(head + 1, std::memory_order_release);
+}
+//-------------------------------------------------------------------------------------------
+// an arrow per hop, its id unique over the hops of the same item
+static long long flow_id(int _stage, int64_t _item)
+{
+    return static_cast<long long>(_item) * TRACE_STAGES + _stage;
+}
+//-------------------------------------------------------------------------------------------
+bool stage_tracer::dump(const std::string &_filename)
+{
+    FILE* file = fopen(_filename.c_str(), "w");
+    if(!file) {
+        fprintf(stderr, "trace %s: can not open\n", _filename.c_str());
+
+        return false;
+
+    }
+    const double tick_us = static_cast<double>(now_us() - us_start) /
+                           static_cast<double>(now() - tsc_start);
+    std::lock_guard<std::mutex> lock(mutex_rings);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for(size_t tid = 0; tid < rings.size(); ++tid) {
+        const ring &r = *rings[tid];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", tid, r.thread_name.c_str());
+        first = false;
+        // the writer goes on: the oldest slots of a full ring may be overwritten meanwhile
+        const uint64_t head = r.head.load(std::memory_order_acquire);
+        const uint64_t tail = head > static_cast<uint64_t>(ring_size) ? head - ring_size + ring_size / 16 : 0;
+        for(uint64_t i = tail; i < head; ++i) {
+            const event &e = r.events[i % ring_size];
+            const double ts = static_cast<double>(static_cast<int64_t>(e.begin - tsc_start)) * tick_us;
+            const double dur = static_cast<double>(e.end - e.begin) * tick_us;
+            const long long item = static_cast<long long>(e.item);
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                          "\"pid\":1,\"tid\":%zu,\"args\":{\"item\":%lld}}",
+                    stage_name[e.stage], ts, dur, tid, item);
+            if(upstream[e.stage] >= 0) {
+                fprintf(file, ",\n{\"name\":\"item\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%lld,"
+                              "\"ts\":%.3f,\"pid\":1,\"tid\":%zu}",
+                        flow_id(upstream[e.stage], e.item), ts, tid);
+            }
+            if(downstream[e.stage]) {
+                fprintf(file, ",\n{\"name\":\"item\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":%lld,"
+                              "\"ts\":%.3f,\"pid\":1,\"tid\":%zu}",
+                        flow_id(e.stage, e.item), ts, tid);
+            }
+        }
+    }
+    fprintf(file, "\n]}\n");
+    const bool ok = ferror(file) == 0;
+    fclose(file);
+
+    return ok;
+
+}
+//-------------------------------------------------------------------------------------------
+
+#endif // USE_TRACE
@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef STAGE_TRACER_H
+#define STAGE_TRACER_H
+
+enum trace_stage_t
+{
+    TRACE_DEMODULATOR = 0,              // item: input buffer
+    TRACE_TIME_DEINTERLEAVER,           // item: TI block handed to the demapper
+    TRACE_LLR_DEMAPPER,                 // item: TI block
+    TRACE_FEC_BATCH,                    // item: FEC batch out of the demapper
+    TRACE_LDPC_DECODER,                 // item: FEC batch
+    TRACE_BCH_DECODER,                  // item: FEC batch
+    TRACE_BB_DE_HEADER,                 // item: FEC batch
+    TRACE_STAGES
+};
+
+#ifdef USE_TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <x86intrin.h>
+
+// Spans of the chain stages in a ring per thread, written without a lock by the thread
+// that owns it. dump() writes the Chrome trace event format, the one Perfetto loads too:
+// a track per thread and an arrow from each stage to the next one of the same item. The
+// stages pass TI blocks and FEC batches on in order, so each counts its own items.
+class stage_tracer
+{
+public:
+    static stage_tracer& instance();
+
+    static uint64_t now()
+    {
+        return __rdtsc();
+    }
+    void record(trace_stage_t _stage, uint64_t _begin, uint64_t _end, int64_t _item);
+    // the last ring_size spans of every thread
+    bool dump(const std::string &_filename);
+
+    constexpr static int ring_size = 1 << 16;
+
+private:
+    stage_tracer();
+
+    struct event
+    {
+        uint64_t begin;
+        uint64_t end;
+        int64_t item;
+        trace_stage_t stage;
+    };
+    struct ring
+    {
+        std::string thread_name;
+        std::atomic<uint64_t> head{0};
+        std::vector<event> events;
+    };
+    std::mutex mutex_rings;
+    std::vector<std::unique_ptr<ring>> rings;
+    uint64_t tsc_start;
+    int64_t us_start;
+
+    ring* thread_ring();
+    static int64_t now_us();
+};
+
+class trace_scope
+{
+public:
+    trace_scope(trace_stage_t _stage, int64_t _item) :
+        stage(_stage),
+        item(_item),
+        begin(stage_tracer::now())
+    {
+    }
+    ~trace_scope()
+    {
+        stage_tracer::instance().record(stage, begin, stage_tracer::now(), item);
+    }
+
+private:
+    trace_stage_t stage;
+    int64_t item;
+    uint64_t begin;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(_stage, _item) trace_scope TRACE_CONCAT(trace_scope_, __LINE__)(_stage, _item)
+
+#else
+
+#define TRACE_SCOPE(_stage, _item) do {} while(0)
+
+#endif // USE_TRACE
+
+#endif // STAGE_TRACER_H
@@ -14,19 +14,21 @@
 */
 #include "time_deinterleaver.h"
 #include "aligned_ptr.h"
+#include "acquisition_timeline.h"
+#include "receiver_metrics.h"
+#include "stage_tracer.h"
 
 #include <immintrin.h>
 
 //-------------------------------------------------------------------------------------------
-time_deinterleaver::time_deinterleaver(QWaitCondition* _signal_in, QMutex *_mutex, QObject *parent) :
-    QObject(parent),
-    signal_in(_signal_in),
-    mutex_in(_mutex)
+time_deinterleaver::time_deinterleaver(QObject *parent) :
+    QObject(parent)
 {
     mutex_out = new QMutex;
     signal_out = new QWaitCondition;
     qam = new llr_demapper(signal_out, mutex_out);
     qam->fifo.take(buffer_ua);
+    qam->fifo_csi.take(buffer_csi);
     time_deint_cell = get_aligned(buffer_ua.data(), alignment);
     thread = new QThread;
     thread->setObjectName("llr_demapper");
@@ -42,6 +44,7 @@ time_deinterleaver::time_deinterleaver(QWaitCondition* _signal_in, QMutex *_mute
 void time_deinterleaver::start(dvbt2_parameters _dvbt2, l1_presignalling _l1_pre, l1_postsignalling _l1_post)
 
 {
+    acquisition_timeline::instance().mark(ACQUISITION_DEINTERLEAVER);
     dvbt2 = _dvbt2;
     l1_pre = _l1_pre;
     l1_post = _l1_post;
@@ -59,6 +62,9 @@ void time_deinterleaver::start(dvbt2_parameters _dvbt2, l1_presignalling _l1_pre
     num_rows.resize(num_plp);
     num_cols.resize(num_plp);
     permutations.resize(num_plp);
+    write_i_address.resize(num_plp);
+    write_q_address.resize(num_plp);
+    write_num_cols.assign(num_plp, 0);
     last_frame_idx.resize(num_plp);
     for(int i = 0; i < num_plp; ++i){
         switch (static_cast<dvbt2_fectype_t>(l1_post.plp[i].plp_fec_type)) {
@@ -140,8 +146,8 @@ void time_deinterleaver::start(dvbt2_parameters _dvbt2, l1_presignalling _l1_pre
         if(len_max < len_buffer) len_max = len_buffer;
     }
 
-    show_data.resize(len_max);
     buffer_ua.resize(len_max+alignment/sizeof(complex));
+    buffer_csi.resize(2 * len_max);
     time_deint_cell = get_aligned(&buffer_ua[0], alignment);
     flag_start = true;
 }
@@ -245,7 +251,7 @@ void time_deinterleaver::address_cell_deinterleaving(int _num_fec_block_max, int
     }
 }
 //-------------------------------------------------------------------------------------------
-void time_deinterleaver::l1_dyn_execute(l1_postsignalling _l1_post)
+void time_deinterleaver::l1_dyn_execute(l1_postsignalling _l1_post, int _len_cell, complex* _cell)
 {
     // dynamic l1 post signaling
     l1_post = _l1_post;
@@ -261,105 +267,124 @@ void time_deinterleaver::l1_dyn_execute(l1_postsignalling _l1_post)
             num_cols[i][j] = f * n_split;
         }
     }
-    start_t2_frame = true;
-    execute();
+    // start of T2 frame
+    idx_cell = 0;
+    for (int i = 0; i < num_plp; ++i) {
+        if(l1_post.dyn.plp[i].start == 0) plp_id = i;
+    }
+    idx_time_il = 0;
+    idx_ti = 0;
+    set_block();
+    int len_cell = _len_cell - p2_start_idx_cell;
+    complex* cell = &_cell[p2_start_idx_cell];
+    begin_symbol(len_cell);
+    for (int i = 0; i < len_cell; ++i) write_cell(i, cell[i]);
+    end_symbol();
 }
 //-------------------------------------------------------------------------------------------
-void time_deinterleaver::execute()
+void time_deinterleaver::set_block()
 {
-    mutex_in->lock();
-//    signal_in->wakeOne();
-
-//            mutex_in->unlock();
-//            return;
-
-    std::vector<complex> in;
-    const bool shifted=fifo.shift(in);
-    mutex_in->unlock();
-    if(!shifted)
-        return;
-    int num_cells = in.size();
-    complex* ofdm_cell = &in[0];
-    if(start_t2_frame == true) {
-        start_t2_frame = false;
-        idx_cell = 0;
-        num_cells = in.size() - p2_start_idx_cell;
-        ofdm_cell = &in[p2_start_idx_cell];
-        for (int i = 0; i < num_plp; ++i) {
-            if(l1_post.dyn.plp[i].start == 0) plp_id = i;
+    // a TI block without FEC blocks takes no cells, the next one of the interleaving frame does
+    while(num_cols[plp_id][idx_time_il] == 0 && idx_time_il + 1 < n_ti[plp_id]) ++idx_time_il;
+    const int num_cols_ti = num_cols[plp_id][idx_time_il];
+    num_rows_plp = num_rows[plp_id];
+    cells_per_fec_block_plp = cells_per_fec_block[plp_id];
+    ti_block_size = num_cols_ti * num_rows_plp;
+    std::vector<int> &w_i = write_i_address[plp_id];
+    std::vector<int> &w_q = write_q_address[plp_id];
+    if(write_num_cols[plp_id] != num_cols_ti) {
+        // cells arrive row by row, each row is read column-wise from the permutation
+        write_num_cols[plp_id] = num_cols_ti;
+        w_i.resize(ti_block_size);
+        w_q.resize(ti_block_size);
+        const int* cell_deint = permutations[plp_id].data();
+        int k = 0;
+        for (int r = 0; r < num_rows_plp; ++r) {
+            for (int d = r; d < ti_block_size; d += num_rows_plp) {
+                int a = cell_deint[d];
+                w_i[k] = a;
+                // the Q component of the first cell of a FEC block belongs to its last cell
+                if(a % cells_per_fec_block_plp == 0) w_q[k] = a - 1 + cells_per_fec_block_plp;
+                else w_q[k] = a - 1;
+                ++k;
+            }
         }
-        num_rows_plp = num_rows[plp_id];
-        cells_per_fec_block_plp = cells_per_fec_block[plp_id];
-        idx_time_il = 0;
-        ti_block_size = num_cols[plp_id][idx_time_il] * num_rows_plp;
-        cell_deint = &permutations[plp_id][0];
-        idx_step_ti = 0;
-        idx_row_ti = 0;
     }
-    for (int i = 0; i < num_cells; ++i) {
-        int d = idx_step_ti + idx_row_ti;
-        int i_address = cell_deint[d];
-        int q_address = i_address - 1;
-        if(i_address % cells_per_fec_block_plp == 0) {
-            if(i_address != 0) time_deint_cell[end_cell_fec_block].imag(q_first_cell_fec_block);
-            q_first_cell_fec_block = ofdm_cell->imag();
-            end_cell_fec_block = q_address + cells_per_fec_block_plp;
-        }
-        else {
-            time_deint_cell[q_address].imag(ofdm_cell->imag());
+    i_address = w_i.data();
+    q_address = w_q.data();
+}
+//-------------------------------------------------------------------------------------------
+void time_deinterleaver::next_block()
+{
+    ready.push_back(ready_block{std::move(buffer_ua), std::move(buffer_csi), ti_block_size, plp_id,
+                                cells_per_fec_block_plp});
+    mutex_out->lock();
+    qam->fifo.take(buffer_ua);
+    qam->fifo_csi.take(buffer_csi);
+    mutex_out->unlock();
+    buffer_ua.resize(len_max+alignment/sizeof(complex));
+    buffer_csi.resize(2 * len_max);
+    time_deint_cell = get_aligned(&buffer_ua[0], alignment);
+    idx_ti = 0;
+    int last_cell = idx_cell - 1;
+    if(++idx_time_il == l1_post.plp[plp_id].time_il_length) {
+        idx_time_il = 0;
+        if(last_cell == slice_end[plp_id]) {
+            for (int i = 0; i < num_plp; ++i) {
+                if(last_cell == l1_post.dyn.plp[i].start - 1) plp_id = l1_post.dyn.plp[i].id;
+            }
         }
-        time_deint_cell[i_address].real(ofdm_cell->real());
-        ++ofdm_cell;
-        idx_step_ti += num_rows_plp;
+    }
+    set_block();
+}
+//-------------------------------------------------------------------------------------------
+void time_deinterleaver::begin_symbol(int _len_cell)
+{
+    segment.clear();
+    int n = 0;
+    while(n < _len_cell) {
+        int len = ti_block_size - idx_ti;
+        if(len <= 0) {
+            // the PLP has no FEC block in this frame: drop the rest of the symbol
+            if(static_cast<int>(discard_address.size()) < _len_cell) discard_address.resize(_len_cell, 0);
+            segment.push_back(ti_segment{_len_cell, -n, discard_address.data(), discard_address.data(),
+                                         &discard_cell, discard_csi});
+
+            break;
 
-        if(idx_step_ti == ti_block_size) {
-            time_deint_cell[end_cell_fec_block].imag(q_first_cell_fec_block);
-            idx_step_ti = 0;
-            if(++idx_row_ti == num_rows_plp) {
-                idx_row_ti = 0;
-                if(idx_show_plp == plp_id) {
-                    int len = cells_per_fec_block_plp;
-                    if(enabled_display)
-                    {
-                        memcpy(&show_data[0], &time_deint_cell[0], sizeof(complex) * static_cast<unsigned long>(len));
-                        emit replace_constelation(len, &show_data[0]);
-                    }
-                }
-                mutex_out->lock();
-                qam->fifo.push(buffer_ua);
-                qam->fifo.take(buffer_ua);
-                buffer_ua.resize(len_max+alignment/sizeof(complex));
-                time_deint_cell = get_aligned(&buffer_ua[0], alignment);
-                mutex_out->unlock();
-                emit ti_block(ti_block_size, plp_id, l1_post);
-                if(++idx_time_il == l1_post.plp[plp_id].time_il_length) {
-                    idx_time_il = 0;
-                    if(idx_cell == slice_end[plp_id]) {
-                        for (int i = 0; i < num_plp; ++i) {
-                            if(idx_cell == l1_post.dyn.plp[i].start - 1) {
-                                plp_id = l1_post.dyn.plp[i].id;
-                                num_rows_plp = num_rows[plp_id];
-                                ti_block_size = num_cols[plp_id][idx_time_il] * num_rows_plp;
-                                cell_deint = &permutations[plp_id][0];
-                                cells_per_fec_block_plp = cells_per_fec_block[plp_id];
-                            }
-                        }
-                    }
-                }
-                else {
-                    ti_block_size = num_cols[plp_id][idx_time_il] * num_rows_plp;
-                }
-            }
         }
-        ++idx_cell;
+        if(len > _len_cell - n) len = _len_cell - n;
+        segment.push_back(ti_segment{n + len, idx_ti - n, i_address, q_address, time_deint_cell,
+                                     buffer_csi.data()});
+        n += len;
+        idx_ti += len;
+        idx_cell += len;
+        if(idx_ti == ti_block_size) next_block();
     }
-    mutex_in->lock();
-    fifo.release(in);
-    mutex_in->unlock();
 }
 //-------------------------------------------------------------------------------------------
-void time_deinterleaver::stop()
+void time_deinterleaver::end_symbol()
 {
-    emit finished();
+    for(ready_block &b : ready) {
+        TRACE_SCOPE(TRACE_TIME_DEINTERLEAVER, trace_item);
+        ++trace_item;
+        if(idx_show_plp == b.plp_id) {
+            if(enabled_display && constelation_buffer.due())
+            {
+                constelation_buffer.publish(get_aligned(&b.buffer[0], alignment), b.cells_per_fec_block);
+                emit replace_constelation(&constelation_buffer);
+            }
+        }
+        mutex_out->lock();
+        qam->fifo.push(b.buffer);
+        qam->fifo_csi.push(b.csi);
+        const size_t queued = qam->fifo.size();
+        mutex_out->unlock();
+        receiver_metrics &metrics = receiver_metrics::instance();
+        metrics.add(METRIC_TI_BLOCKS);
+        metrics.set(METRIC_TI_QUEUE, static_cast<double>(queued));
+        emit ti_block(b.size, b.plp_id, l1_post);
+    }
+    ready.clear();
 }
 //-------------------------------------------------------------------------------------------
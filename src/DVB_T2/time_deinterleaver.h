@@ -22,20 +22,47 @@
 
 #include "DSP/fast_fourier_transform.h"
 #include "dvbt2_definition.h"
+#include "display_buffer.h"
 #include "llr_demapper.h"
 #include "DSP/buffers.hh"
 
+// Part of a symbol that falls into one TI block.
+struct ti_segment{
+    int end;                // first cell of the symbol past this segment
+    int offset;             // position in the TI block of the cell 0 of the symbol
+    const int* i_address;   // position in the TI block -> address of the real part
+    const int* q_address;   // position in the TI block -> address of the imag part (cyclic Q-delay removed)
+    complex* cell;          // TI block memory
+    uint8_t* csi;           // channel state weights of the real and imag parts, two per cell
+};
+
+// The time deinterleaver is driven from the demodulator thread: the equalizer writes each cell
+// straight to its time deinterleaved address between begin_symbol() and end_symbol().
 class time_deinterleaver : public QObject
 {
     Q_OBJECT
 public:
-    explicit time_deinterleaver(QWaitCondition* _signal_in, QMutex* _mutex, QObject *parent = nullptr);
+    explicit time_deinterleaver(QObject *parent = nullptr);
     ~time_deinterleaver();
 
     void start(dvbt2_parameters _dvbt2, l1_presignalling _l1_pre, l1_postsignalling _l1_post);
+    void l1_dyn_execute(l1_postsignalling _l1_post, int _len_cell, complex* _cell);
+    void begin_symbol(int _len_cell);
+    inline void write_cell(int _idx_cell, const complex &_cell, uint8_t _csi = CSI_UNITY)
+    {
+        const ti_segment* s = &segment[0];
+        while(_idx_cell >= s->end) ++s;
+        const int k = _idx_cell + s->offset;
+        const int i = s->i_address[k];
+        const int q = s->q_address[k];
+        s->cell[i].real(_cell.real());
+        s->cell[q].imag(_cell.imag());
+        s->csi[2 * i] = _csi;
+        s->csi[2 * q + 1] = _csi;
+    }
+    void end_symbol();
     llr_demapper* qam;
     volatile int idx_show_plp = 0;
-    vector_fifo<complex> fifo{};
     void enable_display(bool mode)
     {
         enabled_display = mode;
@@ -43,20 +70,12 @@ public:
 
 signals:
     void ti_block(int _ti_block_size, int _plp_id, l1_postsignalling _l1_post);
-    void replace_constelation(const int _len_data, complex* _data);
+    void replace_constelation(display_buffer* _buffer);
     void stop_qam();
-    void finished();
-
-public slots:
-    void l1_dyn_execute(l1_postsignalling _l1_post);
-    void execute();
-    void stop();
 
 private:
-    QWaitCondition* signal_in;
     QThread* thread;
     QWaitCondition* signal_out;
-    QMutex* mutex_in;
     QMutex* mutex_out;
 
     dvbt2_parameters dvbt2;
@@ -86,30 +105,44 @@ private:
 
     int frame_idx;
     int sub_slice_interval;
-    bool start_t2_frame = true;
     constexpr static int alignment = 64;
     std::vector<complex> buffer_ua{};
-    int* cell_deint = nullptr;
     complex* time_deint_cell = nullptr;
-    bool start_swap_buffers = true;
-    bool swap_buffers = true;
+    std::vector<uint8_t> buffer_csi{};
+    std::vector<std::vector<int>> write_i_address{};  // per PLP, cell address by arrival order in TI block
+    std::vector<std::vector<int>> write_q_address{};
+    std::vector<int> write_num_cols{};                // num_cols the write tables are built for
+    const int* i_address = nullptr;
+    const int* q_address = nullptr;
+    std::vector<ti_segment> segment{};
+    // cells with no TI block left in the frame all land here
+    std::vector<int> discard_address{};
+    complex discard_cell{};
+    uint8_t discard_csi[2]{};
+    struct ready_block{
+        std::vector<complex> buffer;
+        std::vector<uint8_t> csi;
+        int size;
+        int plp_id;
+        int cells_per_fec_block;
+    };
+    std::vector<ready_block> ready{};
 
     int len_max = 0;
     int idx_cell = 0;
     int plp_id = 0;
     int idx_time_il = 0;
     int num_rows_plp = 0;
-    int idx_row_ti = 0;
     int cells_per_fec_block_plp;
-    int end_cell_fec_block;
-    float q_first_cell_fec_block;
     int ti_block_size = 0;
-    int idx_step_ti = 0;
-    int idx_time_deint_cell = 0;
+    int idx_ti = 0;                               // next cell position in the current TI block
     bool enabled_display = false;
+    int64_t trace_item = 0;                       // TI blocks handed on
     void address_cell_deinterleaving(int _num_fec_block_max, int _cell_per_fec_block,
                                      int *_permutations);
-    std::vector<complex> show_data{};
+    void set_block();
+    void next_block();
+    display_buffer constelation_buffer{display_buffer::constelation_len};
 };
 
 #endif // TIME_DEINTERLEAVER_H
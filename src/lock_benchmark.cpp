@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "lock_benchmark.h"
+
+#include <QThread>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "rx_raw.h"
+#include "DVB_T2/acquisition_timeline.h"
+
+//-------------------------------------------------------------------------------------------
+// nearest rank
+static double percentile(std::vector<int64_t> &_us, double _p)
+{
+    std::sort(_us.begin(), _us.end());
+    size_t rank = static_cast<size_t>(std::ceil(_p * static_cast<double>(_us.size())));
+    if(rank > 0) --rank;
+    return static_cast<double>(_us[rank]) * 1.0e-3;
+}
+//-------------------------------------------------------------------------------------------
+int lock_benchmark(const QString &_filename, int _runs, int _timeout_s)
+{
+    acquisition_timeline &timeline = acquisition_timeline::instance();
+    std::vector<int64_t> us[ACQUISITION_EVENTS];
+    int locked = 0;
+    for(int run = 0; run < _runs; ++run) {
+        rx_raw* dev = new rx_raw;
+        int err = dev->open(_filename);
+        if(err == 0) err = dev->init(0, 0);
+        if(err != 0) {
+            fprintf(stderr, "lock benchmark %s: %s\n", qPrintable(_filename), dev->error(err).c_str());
+            delete dev;
+
+            return 1;
+
+        }
+        QPointer<rx_raw> ptr_dev = dev;
+        QThread* thread = new QThread;
+        thread->setObjectName(dev->thread_name());
+        dev->moveToThread(thread);
+        QEventLoop loop;
+        QObject::connect(thread, &QThread::started, dev, &rx_interface::start);
+        QObject::connect(dev, &rx_interface::finished, thread, &QThread::quit, Qt::DirectConnection);
+        QObject::connect(thread, &QThread::finished, dev, &QObject::deleteLater);
+        QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+        QObject::connect(thread, &QThread::finished, &loop, &QEventLoop::quit);
+        QTimer poll;
+        QElapsedTimer elapsed;
+        QObject::connect(&poll, &QTimer::timeout, [&]() {
+            if(!timeline.locked() && elapsed.elapsed() < _timeout_s * 1000) return;
+            poll.stop();
+            if(ptr_dev) ptr_dev->stop();
+        });
+        timeline.start();
+        elapsed.start();
+        thread->start(QThread::TimeCriticalPriority);
+        poll.start(10);
+        loop.exec();
+
+        if(timeline.locked()) ++locked;
+        fprintf(stderr, "run %d:", run + 1);
+        for(int i = 0; i < ACQUISITION_EVENTS; ++i) {
+            int64_t t = timeline.time_us(static_cast<acquisition_event_t>(i));
+            if(t < 0) continue;
+            us[i].push_back(t);
+            fprintf(stderr, " %s %.1f ms,", acquisition_timeline::name(static_cast<acquisition_event_t>(i)),
+                    static_cast<double>(t) * 1.0e-3);
+        }
+        fprintf(stderr, "%s\n", timeline.locked() ? "" : " no lock");
+    }
+    printf("%s: %d of %d runs locked\n", qPrintable(_filename), locked, _runs);
+    printf("%-20s %6s %10s %10s\n", "event", "runs", "p50 ms", "p99 ms");
+    for(int i = 0; i < ACQUISITION_EVENTS; ++i) {
+        const char* name = acquisition_timeline::name(static_cast<acquisition_event_t>(i));
+        if(us[i].empty()) {
+            printf("%-20s %6d %10s %10s\n", name, 0, "-", "-");
+            continue;
+        }
+        printf("%-20s %6d %10.1f %10.1f\n", name, static_cast<int>(us[i].size()),
+               percentile(us[i], 0.5), percentile(us[i], 0.99));
+    }
+
+    return locked == _runs ? 0 : 2;
+
+}
+//-------------------------------------------------------------------------------------------
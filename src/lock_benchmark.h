@@ -0,0 +1,24 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef LOCK_BENCHMARK_H
+#define LOCK_BENCHMARK_H
+
+#include <QString>
+
+// Replays the RAW IQ file _runs times, each run from the start of the receiver to the first
+// TS packet or _timeout_s, and prints p50 and p99 of every acquisition event to stdout.
+int lock_benchmark(const QString &_filename, int _runs, int _timeout_s = 30);
+
+#endif // LOCK_BENCHMARK_H
@@ -15,11 +15,88 @@
 #include "main_window.h"
 
 #include <QApplication>
+#include <QStandardPaths>
+#include <QDir>
+
+#include "DSP/fft_wisdom.h"
+#include "DVB_T2/bb_de_header.h"
+#include "lock_benchmark.h"
+#include "metrics_server.h"
+#include "DVB_T2/display_buffer.h"
+#include "DVB_T2/stage_tracer.h"
+
+//-------------------------------------------------------------------------------------------
+static void dump_trace(const QString &_filename)
+{
+    if(_filename.isEmpty()) return;
+#ifdef USE_TRACE
+    if(stage_tracer::instance().dump(_filename.toStdString())) {
+        fprintf(stderr, "trace written to %s\n", qPrintable(_filename));
+    }
+#else
+    fprintf(stderr, "--trace %s: built without USE_TRACE\n", qPrintable(_filename));
+#endif
+}
+//-------------------------------------------------------------------------------------------
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    qRegisterMetaType<fec_frame>();
+    qRegisterMetaType<idx_plp_simd_t>();
+    qRegisterMetaType<bch_decoder::in_t>();
+    qRegisterMetaType<l1_presignalling>();
+    qRegisterMetaType<l1_postsignalling>();
+
+    //qRegisterMetaType<bb_de_header::id_out>();
+    //qRegisterMetaType<bb_de_header::plp_out_params>();
+
+    qRegisterMetaType<std::map<int, bb_de_header::plp_out_params>>();
+
+    // measured FFT plans are kept once per machine
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if(!path.isEmpty() && QDir().mkpath(path)){
+        fft_wisdom::instance().init(QDir(path).filePath("fftw_wisdom").toStdString());
+    }
+    // the P1 and 1K .. 32K symbol lengths, for any alignment while the planner is measuring
+    fft_wisdom::instance().prepare(1024, FFT_32K);
+    QStringList args = a.arguments();
+    // --metrics-port <n>: Prometheus metrics on http://127.0.0.1:<n>/, with or without the window
+    metrics_server metrics;
+    int idx_metrics = static_cast<int>(args.indexOf("--metrics-port"));
+    if(idx_metrics >= 0 && idx_metrics + 1 < args.size()) {
+        int port = args.at(idx_metrics + 1).toInt();
+        if(port <= 0 || port > 65535 || !metrics.listen(static_cast<quint16>(port))) return 1;
+    }
+    // --trace <file.json>: the last spans of every stage, Chrome trace format, written at exit
+    QString trace_file;
+    int idx_trace = static_cast<int>(args.indexOf("--trace"));
+    if(idx_trace >= 0 && idx_trace + 1 < args.size()) trace_file = args.at(idx_trace + 1);
+    // --lock-benchmark <file.raw> [runs]: time to lock without the window
+    int idx_benchmark = static_cast<int>(args.indexOf("--lock-benchmark"));
+    if(idx_benchmark >= 0) {
+        if(idx_benchmark + 1 >= args.size()) {
+            fprintf(stderr, "usage: %s --lock-benchmark <file.raw> [runs]\n", argv[0]);
+
+            return 1;
+
+        }
+        int runs = idx_benchmark + 2 < args.size() ? args.at(idx_benchmark + 2).toInt() : 10;
+        int ret = lock_benchmark(args.at(idx_benchmark + 1), runs > 0 ? runs : 1);
+        fft_wisdom::instance().stop();
+        dump_trace(trace_file);
+
+        return ret;
+
+    }
+    // --display-fps <n>: snapshots per second of every plot
+    int idx_fps = static_cast<int>(args.indexOf("--display-fps"));
+    if(idx_fps >= 0 && idx_fps + 1 < args.size()) display_buffer::set_fps(args.at(idx_fps + 1).toInt());
     main_window w;
     w.show();
-    return a.exec();
+    int ret = a.exec();
+    fft_wisdom::instance().stop();
+    dump_trace(trace_file);
+    return ret;
 }
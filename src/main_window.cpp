@@ -14,6 +14,7 @@
 */
 #include "main_window.h"
 #include "DVB_T2/bb_de_header.h"
+#include "DVB_T2/l1_signalling_text.h"
 #include "ui_main_window.h"
 #include <QAction>
 #include <qhostaddress.h>
@@ -53,15 +54,6 @@ main_window::main_window(QWidget *parent)
 {
     ui->setupUi(this);
 
-    qRegisterMetaType<fec_frame>();
-    qRegisterMetaType<idx_plp_simd_t>();
-    qRegisterMetaType<bch_decoder::in_t>();
-
-    //qRegisterMetaType<bb_de_header::id_out>();
-    //qRegisterMetaType<bb_de_header::plp_out_params>();
-
-    qRegisterMetaType<std::map<int, bb_de_header::plp_out_params>>();
-
 #ifdef USE_SDRPLAY
     ui->action_sdrplay->setEnabled(true);
     connect(ui->action_sdrplay, SIGNAL(triggered()), this, SLOT(open_sdrplay()));
@@ -257,6 +249,10 @@ int main_window::start_dev()
     if(err !=0) return err;
     ptr_dev->set_biastee(ui->checkBox_biastee->isChecked());
     ptr_dev->demodulator->set_fir(ui->comboBoxFIR->currentIndex());
+    ptr_dev->demodulator->set_channel_2d(ui->checkBox_channel_2d->isChecked());
+    ptr_dev->demodulator->set_p1_search(ui->spinBox_p1_search->value());
+    ptr_dev->demodulator->set_l1_tolerance(ui->spinBox_l1_tolerance->value());
+    ptr_dev->demodulator->deinterleaver->qam->set_demap_2d(ui->checkBox_demap_2d->isChecked());
 
     thread = new QThread;
     thread->setObjectName(ptr_dev->thread_name());
@@ -276,6 +272,10 @@ int main_window::start_dev()
     connect(ptr_dev, &rx_interface::buffered, this, &main_window::update_buffered, Qt::QueuedConnection);
     connect(ui->spinBoxGain,SIGNAL(valueChanged(int)),ptr_dev,SLOT(set_gain_db(int)),Qt::DirectConnection);
     connect(ui->comboBoxFIR,SIGNAL(currentIndexChanged(int)),ptr_dev->demodulator,SLOT(set_fir(int)));
+    connect(ui->checkBox_channel_2d,SIGNAL(toggled(bool)),ptr_dev->demodulator,SLOT(set_channel_2d(bool)));
+    connect(ui->spinBox_p1_search,SIGNAL(valueChanged(int)),ptr_dev->demodulator,SLOT(set_p1_search(int)));
+    connect(ui->spinBox_l1_tolerance,SIGNAL(valueChanged(int)),ptr_dev->demodulator,SLOT(set_l1_tolerance(int)));
+    connect(ui->checkBox_demap_2d,SIGNAL(toggled(bool)),ptr_dev->demodulator->deinterleaver->qam,SLOT(set_demap_2d(bool)));
 
     return 0;
 }
@@ -342,9 +342,6 @@ void main_window::on_push_button_start_clicked()
 void main_window::connect_info()
 {
     connect(&dvbt2->p1_demodulator, &p1_symbol::bad_signal, this, &main_window::bad_signal);
-    connect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_presignalling, this, &main_window::view_l1_presignalling);
-    connect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_postsignalling, this, &main_window::view_l1_postsignalling);
-    connect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_dynamic, this, &main_window::view_l1_dynamic);
     connect(dvbt2, &dvbt2_demodulator::amount_plp, this, &main_window::amount_plp);
     connect(dvbt2->deinterleaver->qam, &llr_demapper::signal_noise_ratio,
             this, &main_window::signal_noise_ratio);
@@ -389,9 +386,6 @@ void main_window::on_push_button_stop_clicked()
 void main_window::disconnect_info()
 {
     disconnect(&dvbt2->p1_demodulator, &p1_symbol::bad_signal, this, &main_window::bad_signal);
-    disconnect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_presignalling, this, &main_window::view_l1_presignalling);
-    disconnect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_postsignalling, this, &main_window::view_l1_postsignalling);
-    disconnect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_dynamic, this, &main_window::view_l1_dynamic);
     disconnect(dvbt2, &dvbt2_demodulator::amount_plp, this, &main_window::amount_plp);
     disconnect(dvbt2->deinterleaver->qam, &llr_demapper::signal_noise_ratio,
                this, &main_window::signal_noise_ratio);
@@ -456,6 +450,16 @@ void main_window::on_tab_widget_currentChanged(int index)
                 ldpc_stats, &plot::replace_oscilloscope);
         dvbt2->deinterleaver->enable_display(true);
         break;
+    case 6:
+        disconnect_signals();
+        connect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_presignalling,
+                this, &main_window::view_l1_presignalling);
+        connect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_postsignalling,
+                this, &main_window::view_l1_postsignalling);
+        connect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_dynamic,
+                this, &main_window::view_l1_dynamic);
+        dvbt2->p2_demodulator.enable_l1_display(true);
+        break;
     case 8:
         disconnect_signals();
         connect(&dvbt2->p1_demodulator, &p1_symbol::replace_oscilloscope,
@@ -483,6 +487,7 @@ void main_window::disconnect_signals()
     dvbt2->fc_demod.enable_display(false);
     dvbt2->data_demodulator.enable_display(false);
     dvbt2->p2_demodulator.enable_display(false);
+    dvbt2->p2_demodulator.enable_l1_display(false);
     dvbt2->deinterleaver->enable_display(false);
     dvbt2->enable_display(false);
     disconnect(&dvbt2->p1_demodulator, &p1_symbol::replace_spectrograph,
@@ -513,6 +518,12 @@ void main_window::disconnect_signals()
             frequency_offset, &plot::replace_null_indicator);
     disconnect(dvbt2->deinterleaver->qam->decoder, &ldpc_decoder::replace_oscilloscope,
             ldpc_stats, &plot::replace_oscilloscope);
+    disconnect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_presignalling,
+            this, &main_window::view_l1_presignalling);
+    disconnect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_postsignalling,
+            this, &main_window::view_l1_postsignalling);
+    disconnect(&dvbt2->p2_demodulator, &p2_symbol::view_l1_dynamic,
+            this, &main_window::view_l1_dynamic);
 }
 //------------------------------------------------------------------------------------------------
 void main_window::set_show_p2_symbol(int _id)
@@ -564,27 +575,28 @@ void main_window::signal_noise_ratio(float _snr)
     ui->label_snr->setText("SNR : " + QString::number(static_cast<double>(_snr),'f',2) + "dB");
 }
 //------------------------------------------------------------------------------------------------
-void main_window::view_l1_presignalling(QString _text)
+void main_window::view_l1_presignalling(const l1_presignalling &_l1_pre, bool _crc_ok)
 {
     ui->text_edit_l1_presignalling->clear();
-    ui->text_edit_l1_presignalling->append(_text);
+    ui->text_edit_l1_presignalling->append(_crc_ok ? l1_presignalling_text(_l1_pre) : "CRC_32 ERROR");
 }
 //------------------------------------------------------------------------------------------------
-void main_window::view_l1_postsignalling(QString _text)
+void main_window::view_l1_postsignalling(const l1_postsignalling &_l1_post, bool _crc_ok)
 {
     ui->text_edit_l1_postsignalling->clear();
-    ui->text_edit_l1_postsignalling->append(_text);
+    ui->text_edit_l1_postsignalling->append(_crc_ok ? l1_postsignalling_text(_l1_post) : "CRC_32 ERROR");
 }
 //------------------------------------------------------------------------------------------------
-void main_window::view_l1_dynamic(QString _text, bool _force_update)
+void main_window::view_l1_dynamic(const l1_postsignalling &_l1_post, bool _next, bool _crc_ok)
 {
     static bool update = true;
     if(update || ui->check_box_auto_update_l1_dynamic->isChecked()) {
         update = false;
         ui->text_edit_l1_postsignalling_dynamic->clear();
-        ui->text_edit_l1_postsignalling_dynamic->append(_text);
+        ui->text_edit_l1_postsignalling_dynamic->append(_crc_ok ? l1_dynamic_text(_l1_post, _next) :
+                                                                  "CRC_32 ERROR");
     }
-    if(_force_update) update = true;
+    if(!_crc_ok) update = true;
 }
 //------------------------------------------------------------------------------------------------
 void main_window::ts_stage(QString _info)
@@ -84,9 +84,9 @@ private slots:
     void amount_plp(int _num_plp);
     void signal_noise_ratio(float _snr);
     void on_combo_box_plp_id_currentIndexChanged(int index);
-    void view_l1_presignalling(QString _text);
-    void view_l1_postsignalling(QString _text);
-    void view_l1_dynamic(QString _text, bool _force_update);
+    void view_l1_presignalling(const l1_presignalling &_l1_pre, bool _crc_ok);
+    void view_l1_postsignalling(const l1_postsignalling &_l1_post, bool _crc_ok);
+    void view_l1_dynamic(const l1_postsignalling &_l1_post, bool _next, bool _crc_ok);
     void ts_stage(QString _info);
     void on_push_button_ts_apply_clicked();
     void on_checkBox_biastee_toggled(bool checked);
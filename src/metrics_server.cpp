@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "metrics_server.h"
+
+#include <QHostAddress>
+#include <cstdio>
+#include <string>
+
+#include "DVB_T2/receiver_metrics.h"
+
+//-------------------------------------------------------------------------------------------
+metrics_server::metrics_server(QObject *parent) :
+    QObject(parent),
+    server(new QTcpServer(this))
+{
+    connect(server, &QTcpServer::newConnection, this, &metrics_server::new_connection);
+}
+//-------------------------------------------------------------------------------------------
+metrics_server::~metrics_server()
+{
+
+}
+//-------------------------------------------------------------------------------------------
+bool metrics_server::listen(quint16 _port)
+{
+    if(!server->listen(QHostAddress::LocalHost, _port)) {
+        fprintf(stderr, "metrics server, port %u: %s\n", static_cast<unsigned>(_port), qPrintable(server->errorString()));
+
+        return false;
+
+    }
+
+    return true;
+
+}
+//-------------------------------------------------------------------------------------------
+void metrics_server::new_connection()
+{
+    while(server->hasPendingConnections()) {
+        QTcpSocket* socket = server->nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { ready_read(socket); });
+    }
+}
+//-------------------------------------------------------------------------------------------
+void metrics_server::ready_read(QTcpSocket* _socket)
+{
+    // the request line and headers only, the body of a GET is empty
+    QByteArray request = _socket->peek(max_request);
+    if(!request.contains("\r\n\r\n") && request.size() < max_request) return;
+
+    _socket->readAll();
+    QByteArray response;
+    if(request.startsWith("GET ")) {
+        const std::string body = receiver_metrics::instance().prometheus_text();
+        response = "HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                   "Content-Length: " + QByteArray::number(static_cast<qulonglong>(body.size())) + "\r\n"
+                   "Connection: close\r\n\r\n";
+        response.append(body.data(), static_cast<qsizetype>(body.size()));
+    }
+    else {
+        response = "HTTP/1.1 405 Method Not Allowed\r\n"
+                   "Allow: GET\r\n"
+                   "Content-Length: 0\r\n"
+                   "Connection: close\r\n\r\n";
+    }
+    _socket->write(response);
+    _socket->disconnectFromHost();
+}
+//-------------------------------------------------------------------------------------------
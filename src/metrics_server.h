@@ -0,0 +1,43 @@
+/*
+ *  Copyright 2020 Oleg Malyutin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// Plain HTTP on the loopback: any GET is answered with the receiver metrics in the
+// Prometheus text format and the connection is closed. Runs in the thread that owns it.
+class metrics_server : public QObject
+{
+    Q_OBJECT
+public:
+    explicit metrics_server(QObject *parent = nullptr);
+    ~metrics_server();
+
+    bool listen(quint16 _port);
+
+private slots:
+    void new_connection();
+
+private:
+    QTcpServer* server;
+    constexpr static int max_request = 8192;
+
+    void ready_read(QTcpSocket* _socket);
+};
+
+#endif // METRICS_SERVER_H
@@ -14,6 +14,9 @@
 */
 #include "plot.h"
 
+#include <cmath>
+#include <limits>
+
 //#include <QDebug>
 
 //-------------------------------------------------------------------------------------------
@@ -92,55 +95,87 @@ plot::~plot()
 
 }
 //-------------------------------------------------------------------------------------------
-void plot::replace_spectrograph(const int _len_data, complex *_data)
+void plot::replace_spectrograph(display_buffer* _buffer)
 {
-    const int len_data = _len_data;
-    greate_graph(len_data);
-    for (int i = 0; i < len_data; i++){
-        float y = 10.0f * log10f(norm(_data[i]) / len_data);
-        y_data[i] = static_cast<double>(y);
-        x_data[i]= i;
+    int len_data, len_source;
+    const complex* data = _buffer->acquire(len_data, len_source);
+    if(!data) return;
+    greate_graph(len_source);
+    // the maximum and the minimum of each pixel column, whatever the FFT size
+    const int n_column = std::max(std::min(current_plot->axisRect()->width(), len_data), 1);
+    const double step = static_cast<double>(len_source) / len_data;
+    x_data.resize(n_column);
+    y_data.resize(n_column);
+    x_data_2.resize(n_column);
+    y_data_2.resize(n_column);
+    for (int c = 0; c < n_column; ++c){
+        const int begin = c * len_data / n_column;
+        const int end = (c + 1) * len_data / n_column;
+        float max = -std::numeric_limits<float>::infinity();
+        float min = std::numeric_limits<float>::infinity();
+        for (int i = begin; i < end; ++i){
+            const float y = 10.0f * log10f(norm(data[i]) / len_source);
+            if(y > max) max = y;
+            if(y < min) min = y;
+        }
+        x_data[c] = x_data_2[c] = begin * step;
+        y_data[c] = static_cast<double>(max);
+        y_data_2[c] = static_cast<double>(min);
     }
-    current_plot->graph(0)->data()->clear();
-    current_plot->graph(0)->setData(x_data, y_data);
+    current_plot->graph(0)->setData(x_data, y_data, true);
+    current_plot->graph(1)->setData(x_data_2, y_data_2, true);
 
 //    calc_frame_per_sec();
 
     emit  repaint_plot();
 }
 //-------------------------------------------------------------------------------------------
-void plot::replace_constelation(const int _len_data, complex *_data)
+void plot::replace_constelation(display_buffer* _buffer)
 {
-    int len_data = _len_data;
+    int len_data, len_source;
+    const complex* data = _buffer->acquire(len_data, len_source);
+    if(!data) return;
     greate_graph(len_data);
-    static int v = 0;
-    if (v == 1){
-        current_plot->graph(0)->data()->clear();
-        v = 0;
-    }
-    v++;
+    // a fixed grid whatever the number of cells, the older snapshots fade out
+    for (float &d : density) d *= density_decay;
+    const float scale = density_size / (2.0f * density_range);
     for (int j = 0; j < len_data; j++){
-        x_data[j] = static_cast<double>(_data[j].real());
-        y_data[j] = static_cast<double>(_data[j].imag());
+        const float re = data[j].real();
+        const float im = data[j].imag();
+        if(!(std::abs(re) < density_range && std::abs(im) < density_range)) continue;
+        const int x = std::min(static_cast<int>((re + density_range) * scale), density_size - 1);
+        const int y = std::min(static_cast<int>((im + density_range) * scale), density_size - 1);
+        density[static_cast<size_t>(y * density_size + x)] += 1.0f;
+    }
+    QCPColorMapData* map = color_map->data();
+    float max = 0.0f;
+    for (int y = 0; y < density_size; ++y){
+        for (int x = 0; x < density_size; ++x){
+            const float d = std::log1p(density[static_cast<size_t>(y * density_size + x)]);
+            if(d > max) max = d;
+            map->setCell(x, y, static_cast<double>(d));
+        }
     }
-    current_plot->graph(0)->addData(x_data, y_data);
+    color_map->setDataRange(QCPRange(0.0, max > 0.0f ? static_cast<double>(max) : 1.0));
 
     emit  repaint_plot();
 }
 //-------------------------------------------------------------------------------------------
-void plot::replace_oscilloscope(const int _len_data, complex *_data)
+void plot::replace_oscilloscope(display_buffer* _buffer)
 {
-    const int len_data = _len_data;
-    greate_graph(len_data, _data);
+    int len_data, len_source;
+    const complex* data = _buffer->acquire(len_data, len_source);
+    if(!data) return;
+    greate_graph(len_data, data);
     for (int i = 0; i < len_data; i++){
-        y_data[i] = static_cast<double>(_data[i].real());
+        y_data[i] = static_cast<double>(data[i].real());
         x_data[i] = i;
     }
     current_plot->graph(0)->data()->clear();
     current_plot->graph(0)->setData(x_data, y_data);
     if(type == type_oscilloscope_2){
         for (int i = 0; i < len_data; i++){
-            y_data_2[i] = static_cast<double>(10.f*log10f(_data[i].imag()));
+            y_data_2[i] = static_cast<double>(10.f*log10f(data[i].imag()));
             x_data_2[i] = i;
         }
         current_plot->graph(1)->data()->clear();
@@ -178,7 +213,7 @@ void plot::replace_null_indicator(const float _b1, const float _b2, const float
     emit  repaint_plot();
 }
 //-------------------------------------------------------------------------------------------
-void plot::greate_graph(int _len_data, complex *_data)
+void plot::greate_graph(int _len_data, const complex *_data)
 {
     const int len_data = _len_data;
     double max = 0, min = 0;
@@ -226,8 +261,16 @@ void plot::greate_graph(int _len_data, complex *_data)
         pen.setWidth(1);
         pen.setColor(Qt::blue);
         current_plot->graph(0)->setPen(pen);
-        current_plot->graph(0)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssPlusCircle, 3));
-        current_plot->graph(0)->setLineStyle(QCPGraph::lsStepCenter); 
+        current_plot->graph(0)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssNone));
+        current_plot->graph(0)->setLineStyle(QCPGraph::lsLine);
+        // the envelope: the minimum below, the band between filled
+        if(current_plot->graphCount()<2)
+            current_plot->addGraph();
+        current_plot->graph(1)->setPen(pen);
+        current_plot->graph(1)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssNone));
+        current_plot->graph(1)->setLineStyle(QCPGraph::lsLine);
+        current_plot->graph(0)->setBrush(QBrush(QColor(0, 0, 255, 80)));
+        current_plot->graph(0)->setChannelFillGraph(current_plot->graph(1));
         break;
     case type_constelation:
         current_plot->xAxis->setLabel("Inphase");
@@ -235,10 +278,19 @@ void plot::greate_graph(int _len_data, complex *_data)
         current_plot->xAxis->setRange(-2.0, 2.0);
         current_plot->yAxis->setRange(-2.0, 2.0);
         current_plot->graph(0)->setLineStyle(QCPGraph::lsNone);
-        pen.setWidth(5);
-        pen.setColor(Qt::blue);
-        current_plot->graph(0)->setPen(pen);
-        current_plot->graph(0)->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssDot, 0));
+        if(!color_map) {
+            QCPColorGradient gradient;
+            gradient.setColorStopAt(0.0, Qt::white);
+            gradient.setColorStopAt(0.05, QColor(170, 200, 255));
+            gradient.setColorStopAt(1.0, Qt::darkBlue);
+            color_map = new QCPColorMap(current_plot->xAxis, current_plot->yAxis);
+            color_map->data()->setSize(density_size, density_size);
+            color_map->data()->setRange(QCPRange(-density_range, density_range),
+                                        QCPRange(-density_range, density_range));
+            color_map->setGradient(gradient);
+            color_map->setInterpolate(false);
+            density.assign(static_cast<size_t>(density_size * density_size), 0.0f);
+        }
         break;
     case type_oscilloscope:
         for(int i = 0; i < len_data; ++i){
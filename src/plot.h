@@ -19,10 +19,11 @@
 #include <QApplication>
 
 #include <complex>
+#include <vector>
 
 #include "qcustomplot.h"
+#include "DVB_T2/display_buffer.h"
 
-typedef std::complex<float> complex;
 enum type_graph{
     type_spectrograph = 0,
     type_constelation,
@@ -42,15 +43,22 @@ signals:
     void repaint_plot();
 
 public slots:
-    void replace_spectrograph(const int _len_data, complex* _data);
-    void replace_constelation(const int _len_data, complex* _data);
-    void replace_oscilloscope(const int _len_data, complex* _data);
+    // the newest snapshot of the buffer, nothing to do when it was taken already
+    void replace_spectrograph(display_buffer* _buffer);
+    void replace_constelation(display_buffer* _buffer);
+    void replace_oscilloscope(display_buffer* _buffer);
     void replace_null_indicator(const float _b1, const float _b2, const float _b3);
 
 private:
     QCustomPlot* current_plot;
     QCPBars *bars1;
     QCPBars *bars2;
+    // constellation: a histogram of the cells, one color map whatever their number
+    constexpr static int density_size = 256;
+    constexpr static float density_range = 2.0f;
+    constexpr static float density_decay = 0.6f;
+    QCPColorMap* color_map = nullptr;
+    std::vector<float> density{};
     QVector<double> x_data;
     QVector<double> y_data;
     QVector<double> x_data_2;
@@ -59,7 +67,7 @@ private:
     type_graph type;
     QString name;
     float ref_y2 = 0.f;
-    void greate_graph(int _len_data, complex *_data = nullptr);
+    void greate_graph(int _len_data, const complex *_data = nullptr);
 
     void calc_frame_per_sec();
 };
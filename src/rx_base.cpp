@@ -2,6 +2,8 @@
 #define RX_BASE_CPP
 
 #include "rx_base.h"
+#include "DVB_T2/acquisition_timeline.h"
+#include "DVB_T2/receiver_metrics.h"
 
 //-------------------------------------------------------------------------------------------
 template<typename T>int rx_base<T>::init(uint32_t _rf_frequency_hz, int _gain)
@@ -155,6 +157,8 @@ template<typename T>void rx_base<T>::rx_execute(int nsamples, float level_detect
 {
     if(nsamples == 0)
         return;
+    receiver_metrics &metrics = receiver_metrics::instance();
+    metrics.add(METRIC_SAMPLES_IN, static_cast<uint64_t>(nsamples));
     len_buffer += nsamples;
     ptr_buffer += nsamples;
 
@@ -166,6 +170,8 @@ template<typename T>void rx_base<T>::rx_execute(int nsamples, float level_detect
             return;
         }
         emit buffered(len_buffer/nsamples, max_blocks);
+        metrics.set(METRIC_RX_BUFFERED, len_buffer/nsamples);
+        metrics.add(METRIC_SAMPLES_OUT, static_cast<uint64_t>(len_buffer));
         update_gain_frequency();
 
         if(swap_buffer) {
@@ -186,6 +192,7 @@ template<typename T>void rx_base<T>::rx_execute(int nsamples, float level_detect
         ++blocks;
         if(blocks > max_blocks){
             fprintf(stderr, "reset buffer blocks: %d\n", blocks);
+            metrics.add(METRIC_RX_DROPPED);
             blocks = 1;
             len_buffer = 0;
             if(swap_buffer) {
@@ -205,6 +212,7 @@ template<typename T>void rx_base<T>::fail()
 //-------------------------------------------------------------------------------------------
 template<typename T>void rx_base<T>::start()
 {
+    acquisition_timeline::instance().start();
     reset();
     int err;
     err = hw_start();
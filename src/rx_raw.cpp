@@ -57,8 +57,19 @@ int rx_raw::get(std::string &_ser_no, std::string &_hw_ver)
 
     devices.resize(0);
     hw_ver.resize(0);
-    filename = QFileDialog::getOpenFileName(QApplication::activeWindow(), "Open RAW IQ file","",
-                                            "RAW (*.raw)");
+    QString name = QFileDialog::getOpenFileName(QApplication::activeWindow(), "Open RAW IQ file","",
+                                                "RAW (*.raw)");
+    int err = open(name);
+    if(err < 0)
+        return err;
+    _ser_no = filename.toStdString();
+    _hw_ver = "0";
+    return 0;
+}
+//----------------------------------------------------------------------------------------------------------------------------
+int rx_raw::open(const QString &_filename)
+{
+    filename = _filename;
     if(filename.isEmpty())
         return -1;
     QFileInfo info(filename);
@@ -86,8 +97,6 @@ int rx_raw::get(std::string &_ser_no, std::string &_hw_ver)
     fd.setFileName(filename);
     if(!fd.open(QIODevice::ReadOnly))
         return -5;
-    _ser_no = filename.toStdString();
-    _hw_ver = "0";
     return 0;
 }
 
@@ -32,6 +32,8 @@ public:
 
     std::string error (int err) override;
     int get(std::string &_ser_no, std::string &_hw_ver) override;
+    // name_..._<sample rate>_<8|16|fc>.raw
+    int open(const QString &_filename);
     void update_gain_frequency_direct() override;
     const QString dev_name() override
     {
@@ -53,24 +53,34 @@ QMAKE_CXXFLAGS += /arch:AVX2
 
 SOURCES += \
     DVB_T2/LDPC/tables_handler.cc \
+    DVB_T2/acquisition_timeline.cpp \
     DVB_T2/address_freq_deinterleaver.cpp \
     DVB_T2/bb_de_header.cpp \
     DVB_T2/bch_decoder.cpp \
     DVB_T2/data_symbol.cpp \
+    DVB_T2/display_buffer.cpp \
     DVB_T2/dvbt2_definition.cpp \
     DVB_T2/dvbt2_demodulator.cpp \
     DVB_T2/fc_symbol.cpp \
+    DVB_T2/guard_interval_detector.cpp \
+    DVB_T2/l1_bitstream.cpp \
+    DVB_T2/l1_fec_decoder.cpp \
+    DVB_T2/l1_signalling_text.cpp \
     DVB_T2/ldpc_decoder.cpp \
     DVB_T2/llr_demapper.cpp \
     DVB_T2/p1_symbol.cpp \
     DVB_T2/p2_symbol.cpp \
     DVB_T2/pilot_generator.cpp \
+    DVB_T2/receiver_metrics.cpp \
+    DVB_T2/stage_tracer.cpp \
     DVB_T2/time_deinterleaver.cpp \
     libairspy/src/airspy.c \
     libairspy/src/iqconverter_float.c \
     libairspy/src/iqconverter_int16.c \
+    lock_benchmark.cpp \
     main.cpp \
     main_window.cpp \
+    metrics_server.cpp \
     plot.cpp \
     rx_raw.cpp \
     rx_airspy.cpp
@@ -89,10 +99,11 @@ SOURCES += \
 HEADERS += \
     DSP/buffers.hh \
     DSP/fast_fourier_transform.h \
+    DSP/fft_wisdom.h \
     DSP/fast_math.h \
     DSP/filter_decimator.h \
-    DSP/interpolator_farrow.hh \
     DSP/loop_filters.hh \
+    DSP/resampler_polyphase.hh \
     DVB_T2/LDPC/algorithms.hh \
     # DVB_T2/LDPC/avx2.hh \
     DVB_T2/LDPC/dvb_t2_tables.hh \
@@ -104,18 +115,26 @@ HEADERS += \
     # DVB_T2/LDPC/neon.hh \
     # DVB_T2/LDPC/simd.hh \
     # DVB_T2/LDPC/sse4_1.hh \
+    DVB_T2/acquisition_timeline.h \
     DVB_T2/address_freq_deinterleaver.h \
     DVB_T2/bb_de_header.h \
     DVB_T2/bch_decoder.h \
     DVB_T2/data_symbol.h \
+    DVB_T2/display_buffer.h \
     DVB_T2/dvbt2_definition.h \
     DVB_T2/dvbt2_demodulator.h \
     DVB_T2/fc_symbol.h \
+    DVB_T2/guard_interval_detector.h \
+    DVB_T2/l1_bitstream.h \
+    DVB_T2/l1_fec_decoder.h \
+    DVB_T2/l1_signalling_text.h \
     DVB_T2/ldpc_decoder.h \
     DVB_T2/llr_demapper.h \
     DVB_T2/p1_symbol.h \
     DVB_T2/p2_symbol.h \
     DVB_T2/pilot_generator.h \
+    DVB_T2/receiver_metrics.h \
+    DVB_T2/stage_tracer.h \
     DVB_T2/time_deinterleaver.h \
     libairspy/src/airspy.h \
     libairspy/src/airspy_commands.h \
@@ -123,7 +142,9 @@ HEADERS += \
     libairspy/src/iqconverter_float.h \
     libairspy/src/iqconverter_int16.h \
     rx_sdrplay.h\
+    lock_benchmark.h \
     main_window.h \
+    metrics_server.h \
     plot.h \
     aligned_ptr.h \
     rx_interface.h \
@@ -167,6 +188,7 @@ equals(usrp,1): LIBS += -luhd
 !isEmpty(USRP_LIB_DIR): LIBS += -L$${USRP_LIB_DIR}
 equals(usrp,1): LIBS += -lboost_system
 equals(usrp,1): QMAKE_CXXFLAGS += -DUSE_USRP
+equals(trace,1): QMAKE_CXXFLAGS += -DUSE_TRACE
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin